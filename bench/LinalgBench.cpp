@@ -0,0 +1,60 @@
+#include "benchmark/benchmark.h"
+#include "numcpp.h"
+
+//square matrices from 4 x 4 (16 elements) to 4096 x 4096 (16M elements)
+#define SQUARE_SIZES ->RangeMultiplier(4)->Range(4, 4096)->Unit(benchmark::kMillisecond)
+
+static void BM_matmul(benchmark::State& state) {
+
+    size_t n = state.range(0);
+    auto a = numcpp::Matrix(n, n, 100);
+    auto b = numcpp::Matrix(n, n, 100);
+
+    for (auto _ : state) {
+
+        auto result = numcpp::matmul(a, b);
+        benchmark::DoNotOptimize(result.get_matrix());
+        result.clean_up();
+    }
+
+    state.SetBytesProcessed((int64_t)state.iterations() * 3 * n * n * sizeof(float));
+    state.counters["FLOPS"] = benchmark::Counter(2.0 * n * n * n, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void BM_transpose(benchmark::State& state) {
+
+    size_t n = state.range(0);
+    auto a = numcpp::Matrix(n, n, 100);
+
+    for (auto _ : state) {
+
+        auto result = numcpp::transpose(a);
+        benchmark::DoNotOptimize(result.get_matrix());
+        result.clean_up();
+    }
+
+    state.SetBytesProcessed((int64_t)state.iterations() * 2 * n * n * sizeof(float));
+}
+
+//a fixed number of power iterations, so that the time per iteration does not depend on convergence
+static void BM_dominant_eigen(benchmark::State& state) {
+
+    const size_t iterations = 20;
+    size_t n = state.range(0);
+    auto a = numcpp::Matrix(n, n, 100);
+    auto vector = numcpp::Matrix(n, 1);
+
+    for (auto _ : state) {
+
+        float value = numcpp::dominant_eigen(a, vector, 0, iterations);
+        benchmark::DoNotOptimize(value);
+    }
+
+    state.SetBytesProcessed((int64_t)state.iterations() * iterations * n * n * sizeof(float));
+    state.counters["FLOPS"] = benchmark::Counter(2.0 * iterations * n * n,
+                                                 benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_matmul) SQUARE_SIZES;
+BENCHMARK(BM_transpose) SQUARE_SIZES;
+BENCHMARK(BM_dominant_eigen) SQUARE_SIZES;
@@ -0,0 +1,90 @@
+#include "benchmark/benchmark.h"
+#include "numcpp.h"
+
+#include <algorithm>
+
+//rows of at most 4096 columns, so that `elements` spans 16 to 16M without degenerate shapes
+static numcpp::Matrix random_matrix(size_t elements) {
+
+    size_t columns = std::min<size_t>(elements, 4096);
+
+    return numcpp::Matrix(elements / columns, columns, 100);
+}
+
+//bytes moved per iteration: the inputs written to the device and the result read back
+static void report(benchmark::State& state, size_t elements, size_t bytes_per_element) {
+
+    state.SetBytesProcessed((int64_t)state.iterations() * elements * bytes_per_element);
+    state.counters["FLOPS"] = benchmark::Counter((double)elements, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+template<class Operation>
+static void BM_matrix_on_matrix(benchmark::State& state, Operation operation, size_t result_bytes) {
+
+    size_t elements = state.range(0);
+    auto a = random_matrix(elements);
+    auto b = random_matrix(elements);
+
+    for (auto _ : state) {
+
+        auto result = operation(a, b);
+        benchmark::DoNotOptimize(result.get_matrix());
+        result.clean_up();
+    }
+
+    report(state, elements, 2 * sizeof(float) + result_bytes);
+}
+
+template<class Operation>
+static void BM_matrix_on_scalar(benchmark::State& state, Operation operation, size_t result_bytes) {
+
+    size_t elements = state.range(0);
+    auto a = random_matrix(elements);
+
+    for (auto _ : state) {
+
+        auto result = operation(a, 0.5f);
+        benchmark::DoNotOptimize(result.get_matrix());
+        result.clean_up();
+    }
+
+    report(state, elements, sizeof(float) + result_bytes);
+}
+
+#define ELEMENT_SIZES ->RangeMultiplier(16)->Range(16, 16 << 20)->Unit(benchmark::kMicrosecond)
+
+BENCHMARK_CAPTURE(BM_matrix_on_matrix, add, [](numcpp::Matrix& a, numcpp::Matrix& b) { return a + b; },
+                  sizeof(float)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_matrix, subtract, [](numcpp::Matrix& a, numcpp::Matrix& b) { return a - b; },
+                  sizeof(float)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_matrix, multiply, [](numcpp::Matrix& a, numcpp::Matrix& b) { return a * b; },
+                  sizeof(float)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_matrix, gt, [](numcpp::Matrix& a, numcpp::Matrix& b) { return a > b; },
+                  sizeof(uint8_t)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_matrix, lt, [](numcpp::Matrix& a, numcpp::Matrix& b) { return a < b; },
+                  sizeof(uint8_t)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_matrix, equals, [](numcpp::Matrix& a, numcpp::Matrix& b) { return a == b; },
+                  sizeof(uint8_t)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_matrix, gte, [](numcpp::Matrix& a, numcpp::Matrix& b) { return a >= b; },
+                  sizeof(uint8_t)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_matrix, lte, [](numcpp::Matrix& a, numcpp::Matrix& b) { return a <= b; },
+                  sizeof(uint8_t)) ELEMENT_SIZES;
+
+BENCHMARK_CAPTURE(BM_matrix_on_scalar, multiply, [](numcpp::Matrix& a, float b) { return a * b; },
+                  sizeof(float)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_scalar, power, [](numcpp::Matrix& a, float b) { return a ^ b; },
+                  sizeof(float)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_scalar, add, [](numcpp::Matrix& a, float b) { return a + b; },
+                  sizeof(float)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_scalar, subtract, [](numcpp::Matrix& a, float b) { return a - b; },
+                  sizeof(float)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_scalar, gt, [](numcpp::Matrix& a, float b) { return a > b; },
+                  sizeof(uint8_t)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_scalar, lt, [](numcpp::Matrix& a, float b) { return a < b; },
+                  sizeof(uint8_t)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_scalar, equals, [](numcpp::Matrix& a, float b) { return a == b; },
+                  sizeof(uint8_t)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_scalar, gte, [](numcpp::Matrix& a, float b) { return a >= b; },
+                  sizeof(uint8_t)) ELEMENT_SIZES;
+BENCHMARK_CAPTURE(BM_matrix_on_scalar, lte, [](numcpp::Matrix& a, float b) { return a <= b; },
+                  sizeof(uint8_t)) ELEMENT_SIZES;
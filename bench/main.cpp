@@ -0,0 +1,49 @@
+#include "benchmark/benchmark.h"
+#include "numcpp.h"
+
+#include <string>
+#include <vector>
+#include <CL/cl2.hpp>
+
+//the devices of the platform the library runs on, reported as the backend of every result
+std::string device_names() {
+
+    cl_platform_id platform;
+    cl_uint count = 0;
+
+    if (clGetPlatformIDs(1, &platform, nullptr) != 0 ||
+        clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 0, nullptr, &count) != 0)
+        return "unknown";
+
+    std::vector<cl_device_id> devices(count);
+    clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, count, devices.data(), nullptr);
+
+    std::string names;
+
+    for (cl_device_id device : devices) {
+
+        char name[256] = "";
+        clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name), name, nullptr);
+
+        names += (names.empty() ? "" : ", ") + std::string(name);
+    }
+
+    return names;
+}
+
+int main(int argc, char **argv) {
+
+    benchmark::Initialize(&argc, argv);
+
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    numcpp::init_parallel();
+    benchmark::AddCustomContext("opencl_devices", device_names());
+
+    benchmark::RunSpecifiedBenchmarks();
+
+    numcpp::finish_parallel();
+    benchmark::Shutdown();
+    return 0;
+}
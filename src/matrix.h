@@ -2,8 +2,11 @@
 #define NUMCPP_MATRIX_H
 
 #include <cstring>
+#include <cstdint>
 #include <cmath>
 #include <iostream>
+#include <vector>
+#include <utility>
 
 namespace numcpp {
 
@@ -17,6 +20,62 @@ namespace numcpp {
         virtual float read() = 0;
     };
 
+    /**
+     * Allocator is an abstract class that will be extended and overridden to provide the storage of matrices
+     * allocate must return memory aligned to at least 64 bytes, deallocate gets back the pointer and the size asked for
+     */
+    class Allocator {
+
+    public:
+        virtual void* allocate(size_t size) = 0;
+
+        virtual void deallocate(void* data, size_t size) = 0;
+    };
+
+    //the storage of the matrices created on the calling thread comes from allocator, nullptr restores the default
+    //(64-byte aligned, page aligned from a page on, huge pages from 2 MB on, pinned when set_pinned_memory is on)
+    void set_allocator(Allocator* allocator);
+
+    //the allocator set on the calling thread, nullptr for the default
+    Allocator* get_allocator();
+
+    /**
+     * Arena hands out storage from large blocks, and frees all of it at once when it goes out of scope.
+     * While it lives it is the allocator of its thread, so every matrix a computation creates, temporaries
+     * included, comes from it. Those matrices remember that their storage is the arena's, so clean_up() on them does
+     * nothing, before or after the arena ends, and they must not be used otherwise after the arena ends.
+     */
+    class Arena: public Allocator {
+
+    private:
+
+        //blocks of aligned memory the storage is carved from, with their sizes
+        std::vector<std::pair<void*, size_t>> blocks;
+
+        size_t block_size;
+        size_t used;
+
+        Allocator* previous;
+
+    public:
+
+        explicit Arena(size_t block_size = 16 << 20);
+
+        ~Arena();
+
+        Arena(const Arena&) = delete;
+
+        Arena& operator=(const Arena&) = delete;
+
+        void* allocate(size_t size) override;
+
+        //storage is only given back when the arena ends or is reset
+        void deallocate(void* data, size_t size) override;
+
+        //frees everything handed out so far, the matrices using it must not be used afterwards
+        void reset();
+    };
+
     /**
      * MatrixStatus is the class that holds the status of every operation.
      * Success/Failure message and their respective codes are enclosed in this class.
@@ -41,13 +100,58 @@ namespace numcpp {
     };
 
     /**
-     * Matrix class allows all matrix operations to be performed on its objects.
-     * It only supports float type matrices.
+     * EigenStatus reports how an iterative eigensolver finished.
+     * It is filled in on request, the solvers return their best estimates either way.
+     */
+    struct EigenStatus {
+
+        //Whether every requested eigenpair met the tolerance within the iteration bound
+        bool converged;
+
+        //Count of the iterations (matrix-vector products) performed
+        size_t iterations;
+
+        //Largest residual norm ||A*x - lambda*x|| among the returned eigenpairs
+        float residual;
+    };
+
+    /**
+     * half is the host side storage of a 16 bit IEEE floating point element.
+     * It converts to and from float, rounding to the nearest even value, and all arithmetic on it happens in float.
+     */
+    struct half {
+
+        uint16_t bits;
+
+        half() = default;
+
+        half(float value);
+
+        operator float() const;
+    };
+
+    /**
+     * DType tags the element type of a matrix, it selects the kernel program its operations run on.
+     */
+    enum class DType { Float32, Float64, Int32, Int8, Float16 };
+
+    template<typename T> struct DTypeOf;
+    template<> struct DTypeOf<float> { static const DType value = DType::Float32; };
+    template<> struct DTypeOf<double> { static const DType value = DType::Float64; };
+    template<> struct DTypeOf<int32_t> { static const DType value = DType::Int32; };
+    template<> struct DTypeOf<int8_t> { static const DType value = DType::Int8; };
+    template<> struct DTypeOf<half> { static const DType value = DType::Float16; };
+
+    /**
+     * BasicMatrix class allows all matrix operations to be performed on its objects.
+     * The element type T is one of float, double, int32_t, int8_t, half or uint8_t (Mask). Matrix is the float instance and supports
+     * every operation of the library, the other element types support the typed operations declared in numcpp.h.
      *
      * Supported Element-wise operations: [+, -, *, <, <=, >, >=, ==, ^]
      * Supported Matrix on Scalar operations: [+, -, *, <, <=, >, >=, ==, ^]
      */
-    class Matrix {
+    template<typename T>
+    class BasicMatrix {
 
     private:
 
@@ -58,7 +162,18 @@ namespace numcpp {
         size_t rows;
 
         //The matrix itself, flattened to 1D array to reduce computational complexity.
-        float* matrix{};
+        T* matrix{};
+
+        //Elements from the start of one row to the next, and from one element of a row to the next.
+        //A matrix holds its elements contiguously, a view walks the storage of the matrix it was taken from
+        size_t row_stride = 0;
+        size_t column_step = 1;
+
+        //Views share the storage of their matrix, so clean_up() leaves it alone
+        bool view = false;
+
+        //Storage carved from an Arena goes back when the arena ends, so clean_up() leaves it alone too
+        bool arena = false;
 
         //Initialize a matrix (with random values below the limit)
         MatrixStatus initialize_matrix(int limit);
@@ -67,41 +182,160 @@ namespace numcpp {
         //reader is any object that extends Reader and implements it's own version of 'read' operation
         MatrixStatus initialize_matrix(Reader* reader);
 
+        //Tag of the constructor behind empty(), which allocates the storage and leaves it uninitialized
+        struct Uninitialized {};
+
+        BasicMatrix(size_t rows, size_t columns, Uninitialized);
+
     public:
 
         //initialize the matrix with random values upto `limit`
         //customize limit here if necessary
-        Matrix(size_t rows, size_t columns, int limit = 10000);
+        BasicMatrix(size_t rows, size_t columns, int limit = 10000);
 
         //call the initialize_matrix with a Reader object
-        Matrix(size_t rows, size_t columns, Reader* reader);
+        BasicMatrix(size_t rows, size_t columns, Reader* reader);
+
+        //storage allocated and left uninitialized, for results that are about to be written over
+        static BasicMatrix<T> empty(size_t rows, size_t columns);
 
         //Initialize a matrix (with all 1s)
         //multiple: defines the number to multiply to 1 during initialization
-        MatrixStatus ones(float multiple);
+        MatrixStatus ones(float multiple = 1);
 
         //Initialize a matrix (with all 0s)
         MatrixStatus zeroes();
 
         //Initialize a matrix (with identity matrix)
         //multiple: defines the number to multiply to 1 during initialization
-        MatrixStatus identity(float multiple);
+        MatrixStatus identity(float multiple = 1);
 
         //Respective getters and setters
-        float get_element(size_t row, size_t column) const;
+        T get_element(size_t row, size_t column) const;
 
-        void set_element(size_t row, size_t column, float value);
+        void set_element(size_t row, size_t column, T value);
 
-        float* get_matrix() const;
+        T* get_matrix() const;
 
         size_t get_rows() const;
 
         size_t get_columns() const;
 
-        void set_matrix(float* mat);
+        void set_matrix(T* mat);
 
         //this function must be called at the end to ensure that the matrices are safely discarded from the memory
         void clean_up();
+
+        //Views refer to part of the matrix without copying it, and are accepted wherever a matrix is.
+        //Writes through a view land in the matrix, and a view must not outlive the storage of its matrix
+        //rows [begin, end) of the matrix
+        BasicMatrix<T> row_range(size_t begin, size_t end) const;
+
+        //columns [begin, end) of the matrix
+        BasicMatrix<T> column_range(size_t begin, size_t end) const;
+
+        //the (rows x columns) sub-matrix starting at (row, column)
+        BasicMatrix<T> block(size_t row, size_t column, size_t rows, size_t columns) const;
+
+        //every row_step-th row and every column_step-th column, starting from the first
+        BasicMatrix<T> strided(size_t row_step, size_t column_step) const;
+
+        bool is_view() const;
+
+        //whether the elements lie one after the other in row-major order, as in a matrix that owns them
+        bool is_contiguous() const;
+
+        size_t get_row_stride() const;
+
+        size_t get_column_step() const;
+
+        //the same elements in row-major order as a (rows x columns) matrix
+        //a view of the storage when the elements are contiguous, a new matrix holding a copy otherwise
+        BasicMatrix<T> reshape(size_t rows, size_t columns) const;
+    };
+
+    typedef BasicMatrix<float> Matrix;
+
+    //comparison results, one byte per element holding 1 where the comparison holds and 0 elsewhere
+    typedef BasicMatrix<uint8_t> Mask;
+
+    /**
+     * SparseMatrix holds a float matrix in compressed sparse row (CSR) form.
+     * Only the non-zero entries are stored, row after row, with their column indices in ascending order.
+     *
+     * Supported Element-wise operations: [+, -, *]
+     * Supported Matrix on Scalar operations: [*]
+     */
+    class SparseMatrix {
+
+    private:
+
+        //Count of the no. of columns.
+        size_t columns;
+
+        //Count of the no. of rows.
+        size_t rows;
+
+        //Offset of the first entry of every row in column_indices and values, followed by the no. of entries
+        std::vector<int> row_pointers;
+
+        //Column of every stored entry
+        std::vector<int> column_indices;
+
+        //Value of every stored entry
+        std::vector<float> values;
+
+    public:
+
+        //an empty sparse matrix, all of its elements are zero
+        SparseMatrix(size_t rows, size_t columns);
+
+        //adopt existing CSR arrays, row_pointers must hold rows + 1 offsets
+        SparseMatrix(size_t rows, size_t columns, std::vector<int> row_pointers, std::vector<int> column_indices,
+                     std::vector<float> values);
+
+        //Respective getters, elements that are not stored read as zero
+        float get_element(size_t row, size_t column) const;
+
+        size_t get_rows() const;
+
+        size_t get_columns() const;
+
+        size_t get_nonzeros() const;
+
+        const std::vector<int>& get_row_pointers() const;
+
+        const std::vector<int>& get_column_indices() const;
+
+        const std::vector<float>& get_values() const;
+    };
+
+    /**
+     * CooBuilder collects (row, column, value) triplets in any order and compresses them to a SparseMatrix.
+     * Entries added more than once for the same position are summed.
+     */
+    class CooBuilder {
+
+    private:
+
+        size_t columns;
+
+        size_t rows;
+
+        //The triplets in the order they were added
+        std::vector<int> row_indices;
+
+        std::vector<int> column_indices;
+
+        std::vector<float> values;
+
+    public:
+
+        CooBuilder(size_t rows, size_t columns);
+
+        void add(size_t row, size_t column, float value);
+
+        SparseMatrix build() const;
     };
 }
 
@@ -2,6 +2,26 @@
 #include "parallel.h"
 
 #include <iostream>
+#include <vector>
+#include <cfloat>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+#include <cstdlib>
+#include <new>
+#include <limits>
+#include <type_traits>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 #include <CL/cl2.hpp>
 
 namespace numcpp {
@@ -16,33 +36,207 @@ namespace numcpp {
     cl_uint ret_num_devices;
     cl_uint ret_num_platforms;
     cl_context context;
-    cl_command_queue queue;
     cl_program program;
 
+    //The context and the program are shared by every host thread, init_parallel() and finish_parallel() count the threads using them
+    std::mutex parallel_mutex;
+    int parallel_threads = 0;
+
+    //Each host thread owns its queue and its kernel objects, so concurrent operations never race on kernel arguments
+    thread_local bool thread_initialized = false;
+    thread_local cl_command_queue queue;
+
+    //Profiling queues of the operations split across devices, queues_per_device of them for every device.
+    //queue_devices holds the index in devices of the device each queue runs on
+    thread_local std::vector<cl_command_queue> device_queues;
+    thread_local std::vector<size_t> queue_devices;
+    thread_local size_t queues_per_device = 1;
+
+    //Every device of the platform the program builds for, the default device first, and the share of the rows each one is given when an
+    //operation is split across them. The shares start from the compute capacity and follow the measured kernel times
+    std::vector<cl_device_id> devices;
+    std::vector<double> device_weights;
+
+    //Capacity of the device, used to size the row blocks of out-of-core routines
+    cl_ulong device_memory_size;
+    cl_ulong device_max_allocation;
+
+    //Set when the default device shares host memory (CPU and integrated devices), buffers then wrap the matrix storage
+    //through CL_MEM_USE_HOST_PTR and results are mapped in place instead of copied
+    cl_bool unified_memory = CL_FALSE;
+
+    //Pinned matrix storage (set_pinned_memory), each block is a mapped CL_MEM_ALLOC_HOST_PTR buffer found by its address.
+    //A block keeps the queue it was mapped on, so it can be unmapped after the context is gone
+    struct PinnedBlock {
+
+        cl_mem buffer;
+        size_t size;
+        cl_command_queue queue;
+    };
+
+    std::atomic<bool> pinned_enabled(false);
+    std::mutex pinned_mutex;
+    std::map<const char*, PinnedBlock> pinned_blocks;
+    cl_command_queue pinned_queue = nullptr;
+
+    //Ring of pinned buffers that large transfers of pageable memory are staged through, copying one chunk on the
+    //host while the previous one is transferred
+    struct StagingSlot {
+
+        cl_mem buffer;
+        void* mapped;
+        cl_event pending;
+    };
+
+    const size_t staging_slots = 4;
+    const size_t staging_chunk = 4 << 20;
+    const size_t staging_threshold = 1 << 20;
+    thread_local std::vector<StagingSlot> staging_ring;
+
     //These kernels have been overloaded on operators (Matrix-on-Matrix)
-    cl_kernel kernel_add;
-    cl_kernel kernel_subtract;
-    cl_kernel kernel_multiply;
-    cl_kernel kernel_gt;
-    cl_kernel kernel_lt;
-    cl_kernel kernel_equals;
-    cl_kernel kernel_gte;
-    cl_kernel kernel_lte;
+    thread_local cl_kernel kernel_add;
+    thread_local cl_kernel kernel_subtract;
+    thread_local cl_kernel kernel_multiply;
+    thread_local cl_kernel kernel_gt;
+    thread_local cl_kernel kernel_lt;
+    thread_local cl_kernel kernel_equals;
+    thread_local cl_kernel kernel_gte;
+    thread_local cl_kernel kernel_lte;
 
     //These kernels have been overloaded on operators (Matrix-on-Scalar)
-    cl_kernel scalar_kernel_multiply;
-    cl_kernel scalar_kernel_gt;
-    cl_kernel scalar_kernel_lt;
-    cl_kernel scalar_kernel_equals;
-    cl_kernel scalar_kernel_gte;
-    cl_kernel scalar_kernel_lte;
-    cl_kernel scalar_kernel_power;
-    cl_kernel scalar_kernel_adder;
-    cl_kernel scalar_kernel_subtracter;
+    thread_local cl_kernel scalar_kernel_multiply;
+    thread_local cl_kernel scalar_kernel_gt;
+    thread_local cl_kernel scalar_kernel_lt;
+    thread_local cl_kernel scalar_kernel_equals;
+    thread_local cl_kernel scalar_kernel_gte;
+    thread_local cl_kernel scalar_kernel_lte;
+    thread_local cl_kernel scalar_kernel_power;
+    thread_local cl_kernel scalar_kernel_adder;
+    thread_local cl_kernel scalar_kernel_subtracter;
 
     //These kernels have been implemented as functions
-    cl_kernel matrix_kernel_multiply;
-    cl_kernel matrix_kernel_transpose;
+    thread_local cl_kernel matrix_kernel_multiply;
+    thread_local cl_kernel matrix_kernel_transpose;
+    thread_local cl_kernel matrix_kernel_gemm;
+
+    //These kernels are the building blocks of the blocked linear algebra routines
+    thread_local cl_kernel block_kernel_update;
+    thread_local cl_kernel block_kernel_swap_rows;
+    thread_local cl_kernel block_kernel_lower_solve;
+    thread_local cl_kernel block_kernel_upper_solve;
+    thread_local cl_kernel block_kernel_right_lower_solve;
+    thread_local cl_kernel block_kernel_symmetric_update;
+    thread_local cl_kernel batched_kernel_lstsq;
+
+    //These kernels serve the eigensolvers
+    thread_local cl_kernel matrix_kernel_gemv;
+    thread_local cl_kernel block_kernel_rank2_update;
+
+    //Many small products in one launch
+    thread_local cl_kernel batched_kernel_multiply;
+
+    //These kernels operate on sparse (CSR) matrices, one work-item per row
+    thread_local cl_kernel sparse_kernel_spmv;
+    thread_local cl_kernel sparse_kernel_spmm;
+    thread_local cl_kernel sparse_kernel_count;
+    thread_local cl_kernel sparse_kernel_merge;
+    thread_local cl_kernel sparse_kernel_dense_count;
+    thread_local cl_kernel sparse_kernel_compress;
+    thread_local cl_kernel sparse_kernel_expand;
+
+    //These kernels consume the masks produced by the comparisons
+    thread_local cl_kernel mask_kernel_count;
+    thread_local cl_kernel mask_kernel_select;
+
+    //These kernels gather elements by an index list and add rows into the places an index list names
+    thread_local cl_kernel gather_kernel;
+    thread_local cl_kernel scatter_kernel_add;
+
+    //Kernels of the non-float element types, their programs are generated and built on first use
+    struct TypedProgram {
+
+        cl_program program;
+        cl_kernel add;
+        cl_kernel subtract;
+        cl_kernel multiply;
+        cl_kernel multiply_matrix;
+        cl_kernel transpose;
+    };
+
+    thread_local std::map<DType, TypedProgram> typed_programs;
+
+    //Kernels of the element-wise math functions, one program per fast math setting, built on first use
+    struct MathProgram {
+
+        cl_program program;
+        std::map<std::string, cl_kernel> kernels;
+    };
+
+    thread_local std::map<bool, MathProgram> math_programs;
+    std::atomic<bool> fast_math_enabled(false);
+
+    //Device buffers reused by the output-parameter operations, so that steady-state loops allocate nothing
+    thread_local cl_mem workspace_buffers[3];
+    thread_local size_t workspace_sizes[3];
+
+    //When profiling is on every command the library enqueues carries an event. Once the commands have finished their
+    //timestamps are summed per command ("create buffer", "write", "read", "fill" or the kernel's name)
+    std::atomic<bool> profiling_enabled(false);
+
+    struct ProfileRecord {
+
+        std::string command;
+        size_t bytes;
+        cl_event event;
+    };
+
+    thread_local std::deque<ProfileRecord> profile_pending;
+    std::map<std::string, ProfileStats> profile_totals;
+    std::mutex profile_mutex;
+
+    //When tracing is on, host spans and the profiled device commands are kept as Chrome trace events.
+    //Device timestamps are moved onto the host clock by the offset measured when tracing started
+    struct TraceEvent {
+
+        std::string name;
+        bool device;
+        size_t thread;
+        cl_ulong start;
+        cl_ulong end;
+    };
+
+    std::atomic<bool> tracing_enabled(false);
+    std::vector<TraceEvent> trace_events;
+    cl_ulong trace_start = 0;
+
+    //offset of each device's clock from the host clock, devices of a platform need not share a clock
+    std::map<cl_device_id, cl_long> trace_device_offsets;
+
+    std::atomic<size_t> trace_threads(0);
+    thread_local size_t trace_thread = trace_threads++;
+
+    //Memory accounting: bytes of host matrix storage and of device buffers, with the allocations of each public
+    //operation counted under the outermost operation running on the thread
+    MemoryStats memory_stats;
+    std::map<std::string, OperationMemory> operation_memory;
+    std::mutex memory_mutex;
+
+    thread_local const char* current_operation = nullptr;
+
+    //Width of the column panels the blocked factorizations work on
+    const size_t linalg_block_size = 64;
+
+    //work-items cooperating on one row of a matrix-vector product, must be a power of two
+    const size_t gemv_group_size = 64;
+
+    //gemv_group_size clamped to the work-group limits of the device and the kernel, set by init_thread
+    thread_local size_t gemv_lanes = gemv_group_size;
+
+    //mask elements handled by one work-item when counting or compacting a mask
+    const size_t mask_chunk_size = 256;
+
+    //rows each queue must get on average before an operation is split across the device queues
+    const size_t partition_min_rows = 32;
 
     MatrixStatus::MatrixStatus(std::string error, int code) {
 
@@ -58,1963 +252,7135 @@ namespace numcpp {
         return this->error_code;
     }
 
-    Matrix::Matrix(size_t rows, size_t columns, int limit) {
-
-        this->rows = rows;
-        this->columns = columns;
-
-        set_matrix(new float[get_rows() * get_columns()]);
-        initialize_matrix(limit);
-    }
+    OperationMemory& operation_entry() {
 
-    Matrix::Matrix(size_t rows, size_t columns, Reader* reader) {
+        const char* name = current_operation != nullptr ? current_operation : "(outside operations)";
 
-        this->rows = rows;
-        this->columns = columns;
+        OperationMemory& entry = operation_memory[name];
+        entry.operation = name;
 
-        set_matrix(new float[get_rows() * get_columns()]);
-        initialize_matrix(reader);
+        return entry;
     }
 
-    MatrixStatus Matrix::initialize_matrix(int limit) {
-
-        try {
+    void account_host(size_t bytes, bool allocated) {
 
-            for (long long int i = 0; i < rows; i++) {
+        std::lock_guard<std::mutex> lock(memory_mutex);
 
-                for (long long int j = 0; j < columns; j++) {
+        if (allocated) {
 
-                    set_element(i, j, rand() % limit);
-                }
-            }
+            memory_stats.host_bytes += bytes;
+            memory_stats.host_peak = std::max(memory_stats.host_peak, memory_stats.host_bytes);
+            memory_stats.host_allocations++;
 
-            return MatrixStatus("Success", 0);
+            OperationMemory& entry = operation_entry();
+            entry.host_allocations++;
+            entry.host_bytes += bytes;
         }
-        catch (errno_t e) {
+        else {
 
-            return MatrixStatus("Error Reading Values. Only float Values Supported.", 1);
+            memory_stats.host_bytes -= std::min(bytes, memory_stats.host_bytes);
+            memory_stats.host_frees++;
         }
     }
 
-    MatrixStatus Matrix::initialize_matrix(Reader* reader) {
-
-        try {
+    void account_device(size_t bytes, bool allocated) {
 
-            for (long long int i = 0; i < rows; i++) {
+        std::lock_guard<std::mutex> lock(memory_mutex);
 
-                for (long long int j = 0; j < columns; j++) {
+        if (allocated) {
 
-                    float element = reader->read();
-                    set_element(i, j, element);
-                }
-            }
+            memory_stats.device_bytes += bytes;
+            memory_stats.device_peak = std::max(memory_stats.device_peak, memory_stats.device_bytes);
+            memory_stats.device_allocations++;
 
-            return MatrixStatus("Success", 0);
+            OperationMemory& entry = operation_entry();
+            entry.device_allocations++;
+            entry.device_bytes += bytes;
         }
-        catch (errno_t e) {
+        else {
 
-            return MatrixStatus("Error Reading Values. Only float Values Supported.", 1);
+            memory_stats.device_bytes -= std::min(bytes, memory_stats.device_bytes);
+            memory_stats.device_frees++;
         }
     }
 
-    float Matrix::get_element(size_t row, size_t column) const {
-        return this->matrix[row * (this->columns) + column];
-    }
+    MemoryStats get_memory_stats() {
 
-    void Matrix::set_element(size_t row, size_t column, float value) {
-        this->matrix[row * (this->columns) + column] = value;
+        std::lock_guard<std::mutex> lock(memory_mutex);
+        return memory_stats;
     }
 
-    float* Matrix::get_matrix() const {
-        return this->matrix;
-    }
+    std::vector<OperationMemory> get_operation_memory() {
 
-    size_t Matrix::get_rows() const {
+        std::lock_guard<std::mutex> lock(memory_mutex);
 
-        return this->rows;
-    }
+        std::vector<OperationMemory> entries;
 
-    size_t Matrix::get_columns() const {
+        for (auto& entry : operation_memory)
+            entries.push_back(entry.second);
 
-        return this->columns;
+        return entries;
     }
 
-    void Matrix::set_matrix(float* mat) {
-        this->matrix = mat;
-    }
+    void reset_memory_stats() {
 
-    void Matrix::clean_up() {
+        std::lock_guard<std::mutex> lock(memory_mutex);
 
-        delete[] this->matrix;
+        memory_stats.host_peak = memory_stats.host_bytes;
+        memory_stats.device_peak = memory_stats.device_bytes;
+        memory_stats.host_allocations = memory_stats.host_frees = 0;
+        memory_stats.device_allocations = memory_stats.device_frees = 0;
+        operation_memory.clear();
     }
 
-    MatrixStatus Matrix::ones(float multiple = 1) {
+    //Matrix storage is aligned so that runtimes can wrap it without copying, to the page when it spans pages and to
+    //the cache line otherwise. Storage from 2 MB on is aligned to and backed by huge pages where the system has them
+    const size_t storage_huge_page = 2 << 20;
+    const size_t storage_page = 4096;
+    const size_t storage_line = 64;
 
-        try {
-            set_matrix(new float[get_rows() * get_columns()]);
+    //nullptr when pinned memory cannot be had, the caller then falls back to pageable memory
+    void* allocate_pinned(size_t size) {
 
-            for (long long int i = 0; i < rows; i++) {
+        std::lock_guard<std::mutex> lock(pinned_mutex);
 
-                for (long long int j = 0; j < columns; j++) {
+        if (pinned_queue == nullptr)
+            return nullptr;
 
-                    set_element(i, j, 1 * multiple);
-                }
-            }
+        cl_int ret;
+        cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, size, nullptr, &ret);
 
-            return MatrixStatus("Success", 0);
-        }
-        catch (errno_t e) {
+        if (ret != 0)
+            return nullptr;
 
-            return MatrixStatus("Error Reading Values. Only float Values Supported.", 1);
+        void* data = clEnqueueMapBuffer(pinned_queue, buffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, size, 0, nullptr,
+                                        nullptr, &ret);
+
+        if (ret != 0) {
+
+            clReleaseMemObject(buffer);
+            return nullptr;
         }
+
+        clRetainCommandQueue(pinned_queue);
+        pinned_blocks[static_cast<const char*>(data)] = { buffer, size, pinned_queue };
+
+        return data;
     }
 
-    MatrixStatus Matrix::zeroes() {
+    bool free_pinned(void* data) {
 
-        try {
-            set_matrix(new float[get_rows() * get_columns()]);
+        std::lock_guard<std::mutex> lock(pinned_mutex);
 
-            for (long long int i = 0; i < rows; i++) {
+        auto block = pinned_blocks.find(static_cast<const char*>(data));
 
-                for (long long int j = 0; j < columns; j++) {
+        if (block == pinned_blocks.end())
+            return false;
 
-                    set_element(i, j, 0);
-                }
-            }
+        cl_int ret = clEnqueueUnmapMemObject(block->second.queue, block->second.buffer, data, 0, nullptr, nullptr);
+        ret |= clReleaseMemObject(block->second.buffer);
+        ret |= clReleaseCommandQueue(block->second.queue);
 
-            return MatrixStatus("Success", 0);
-        }
-        catch (errno_t e) {
+        if (ret != 0) {
 
-            return MatrixStatus("Error Reading Values. Only float Values Supported.", 1);
+            std::cerr << "98: WARNING: Error clearing kernel space. Memory leaks may happen.\n";
         }
-    }
 
-    MatrixStatus Matrix::identity(float multiple = 1) {
+        pinned_blocks.erase(block);
 
-        try {
-            set_matrix(new float[get_rows() * get_columns()]);
+        return true;
+    }
 
-            for (long long int i = 0; i < rows; i++) {
+    //whether the bytes at data lie in pinned storage, transfers from there need no staging
+    bool is_pinned(const void* data) {
 
-                for (long long int j = 0; j < columns; j++) {
+        std::lock_guard<std::mutex> lock(pinned_mutex);
 
-                    if (i != j)
-                        set_element(i, j, 0);
-                    else
-                        set_element(i, j, 1 * multiple);
-                }
-            }
+        auto block = pinned_blocks.upper_bound(static_cast<const char*>(data));
 
-            return MatrixStatus("Success", 0);
-        }
-        catch (errno_t e) {
+        if (block == pinned_blocks.begin())
+            return false;
 
-            return MatrixStatus("Error Reading Values. Only float Values Supported.", 1);
-        }
-    }
+        block--;
 
-    std::ostream& operator<<(std::ostream& os, Matrix const& v) {
-        for (long long int i = 0; i < v.get_rows(); i++) {
-            for (long long int j = 0; j < v.get_columns(); j++) {
-                os << v.get_element(i, j) << "\t";
-            }
-            os << "\n";
-        }
-        return os;
+        return static_cast<const char*>(data) < block->first + block->second.size;
     }
 
-    int is_broadcast_possible(const Matrix* valid_a, const Matrix* valid_b, long long int* highest_cols,
-                              long long int* highest_rows) {
-        int flag = 0;
+    //the default source of matrix storage
+    class AlignedAllocator: public Allocator {
 
-        if ((valid_a->get_rows() >= valid_b->get_rows() && valid_a->get_rows() % valid_b->get_rows() == 0
-             && valid_a->get_columns() >= valid_b->get_columns() &&
-             valid_a->get_columns() % valid_b->get_columns() == 0)) {
+    public:
 
-            flag = 2;
+        void* allocate(size_t size) override {
 
-            *highest_cols = valid_a->get_columns();
-            *highest_rows = valid_a->get_rows();
-        }
-        else if ((valid_a->get_rows() <= valid_b->get_rows() && valid_b->get_rows() % valid_a->get_rows() == 0
-                  && valid_a->get_columns() <= valid_b->get_columns() &&
-                  valid_b->get_columns() % valid_a->get_columns() == 0)) {
+            size_t alignment = size >= storage_huge_page ? storage_huge_page :
+                               size >= storage_page ? storage_page : storage_line;
+            size_t padded = std::max<size_t>((size + alignment - 1) / alignment * alignment, storage_line);
+            void* data = nullptr;
 
-            flag = 1;
+#ifdef _WIN32
+            data = _aligned_malloc(padded, alignment);
+#else
+            if (posix_memalign(&data, alignment, padded) != 0)
+                data = nullptr;
+#endif
 
-            *highest_cols = valid_b->get_columns();
-            *highest_rows = valid_b->get_rows();
-        }
-        else {
-            flag = 0;
+            if (data == nullptr)
+                throw std::bad_alloc();
 
-            *highest_cols = -1;
-            *highest_rows = -1;
+#ifdef __linux__
+            //large matrices are streamed through, huge pages spare most of their TLB misses
+            if (alignment == storage_huge_page)
+                madvise(data, padded, MADV_HUGEPAGE);
+#endif
+
+            return data;
         }
 
-        return flag;
-    }
+        void deallocate(void* data, size_t) override {
 
-    int broadcast2(const Matrix* valid_a, const Matrix* valid_b, float* output_a, float* output_b, int flag) {
+#ifdef _WIN32
+            _aligned_free(data);
+#else
+            free(data);
+#endif
+        }
+    };
 
-        if (flag == 0)
-            return flag;
-        else {
+    AlignedAllocator aligned_allocator;
 
-            if (flag == 2) {
+    //pinned storage while set_pinned_memory is on, pageable storage when pinned memory cannot be had
+    class PinnedAllocator: public Allocator {
 
-                for (long long int i = 0; i < valid_a->get_rows(); i++) {
+    public:
 
-                    for (long long int j = 0; j < valid_a->get_columns(); j++) {
+        void* allocate(size_t size) override {
 
-                        output_a[i * valid_a->get_columns() + j] = valid_a->get_element(i, j);
-                    }
-                }
+            //runtimes map pinned buffers at least at their base address alignment
+            void* data = allocate_pinned(std::max<size_t>((size + storage_line - 1) / storage_line * storage_line,
+                                                          storage_line));
 
-                long long int index = 0;
+            return data != nullptr ? data : aligned_allocator.allocate(size);
+        }
 
-                for (long long int i = 0; i < valid_b->get_rows(); i++) {
+        void deallocate(void* data, size_t size) override {
 
-                    for (long long int j = 0; j < valid_b->get_columns(); j++) {
+            if (!free_pinned(data))
+                aligned_allocator.deallocate(data, size);
+        }
+    };
 
-                        output_b[index] = valid_b->get_matrix()[i * valid_b->get_columns() + j];
-                        index++;
-                    }
+    PinnedAllocator pinned_allocator;
 
-                    index -= valid_b->get_columns();
-                    index += valid_a->get_columns();
-                }
+    //set_allocator() of the calling thread, nullptr for the defaults above
+    thread_local Allocator* storage_allocator = nullptr;
 
-                long long int rows_rep = valid_a->get_rows() / valid_b->get_rows();
-                long long int jump = valid_b->get_rows() * valid_a->get_columns();
+    //Every block of storage remembers the allocator it came from, so it goes back there whichever allocator is set
+    //when it is freed
+    struct StorageBlock {
 
-                for (long long int i = 0; i < rows_rep - 1; i++) {
+        Allocator* allocator;
+        size_t size;
+    };
 
-                    long long int k = 0;
+    std::mutex storage_mutex;
+    std::map<const void*, StorageBlock> storage_blocks;
 
-                    for (long long int j = i * jump; j < i * jump + jump; j++) {
+    //whether data was handed out by an arena, asked while the arena still lives, when storage is given to a matrix
+    bool is_arena_storage(const void* data) {
 
-                        output_b[j + jump] = output_b[j];
+        std::lock_guard<std::mutex> lock(storage_mutex);
 
-                        k++;
+        auto entry = storage_blocks.find(data);
 
-                        if (k >= valid_b->get_columns()) {
+        return entry != storage_blocks.end() && dynamic_cast<Arena*>(entry->second.allocator) != nullptr;
+    }
 
-                            k = 0;
-                            j -= valid_b->get_columns();
-                            j += valid_a->get_columns();
-                        }
-                    }
-                }
+    void* allocate_bytes(size_t size) {
 
-                for (long long int i = 0; i < valid_a->get_rows(); i++) {
+        Allocator* allocator = storage_allocator;
 
-                    long long int curr_position = i * valid_a->get_columns();
+        if (allocator == nullptr)
+            allocator = pinned_enabled ? static_cast<Allocator*>(&pinned_allocator) : &aligned_allocator;
 
-                    for (long long int j = curr_position;
-                         j <= curr_position + (valid_a->get_columns() - 1 - valid_b->get_columns()); j++) {
+        void* data = allocator->allocate(size);
 
-                        output_b[j + valid_b->get_columns()] = output_b[j];
-                    }
-                }
+        if (data == nullptr)
+            throw std::bad_alloc();
 
-            }
-            else if (flag == 1) {
+        //every block is counted here once, matrix storage and operator temporaries alike
+        account_host(size, true);
 
-                for (long long int i = 0; i < valid_b->get_rows(); i++) {
+        std::lock_guard<std::mutex> lock(storage_mutex);
+        storage_blocks[data] = { allocator, size };
 
-                    for (long long int j = 0; j < valid_b->get_columns(); j++) {
+        return data;
+    }
 
-                        output_b[i * valid_b->get_columns() + j] = valid_b->get_element(i, j);
-                    }
-                }
+    template<typename T>
+    T* allocate_storage(size_t count) {
 
-                long long int index = 0;
+        return static_cast<T*>(allocate_bytes(count * sizeof(T)));
+    }
 
-                for (long long int i = 0; i < valid_a->get_rows(); i++) {
+    //false for storage that did not come from allocate_storage()
+    bool free_bytes(void* data) {
 
-                    for (long long int j = 0; j < valid_a->get_columns(); j++) {
+        StorageBlock block;
 
-                        output_a[index] = valid_a->get_matrix()[i * valid_a->get_columns() + j];
-                        index++;
-                    }
+        {
+            std::lock_guard<std::mutex> lock(storage_mutex);
 
-                    index -= valid_a->get_columns();
-                    index += valid_b->get_columns();
-                }
+            auto entry = storage_blocks.find(data);
 
-                long long int rows_rep = valid_b->get_rows() / valid_a->get_rows();
-                long long int jump = valid_a->get_rows() * valid_b->get_columns();
+            if (entry == storage_blocks.end())
+                return false;
 
-                for (long long int i = 0; i < rows_rep - 1; i++) {
+            block = entry->second;
+            storage_blocks.erase(entry);
+        }
 
-                    long long int k = 0;
+        block.allocator->deallocate(data, block.size);
+        account_host(block.size, false);
 
-                    for (long long int j = i * jump; j < i * jump + jump; j++) {
+        return true;
+    }
 
-                        output_a[j + jump] = output_a[j];
+    void free_storage(void* data) {
 
-                        k++;
+        if (data != nullptr)
+            free_bytes(data);
+    }
 
-                        if (k >= valid_a->get_columns()) {
+    //storage the caller handed over through set_matrix() was allocated with new[]
+    template<typename T>
+    void release_storage(T* data) {
 
-                            k = 0;
-                            j -= valid_a->get_columns();
-                            j += valid_b->get_columns();
-                        }
-                    }
-                }
+        if (data != nullptr && !free_bytes(data))
+            delete[] data;
+    }
 
-                for (long long int i = 0; i < valid_b->get_rows(); i++) {
+    //drops the blocks of an allocator that frees them all at once, matrices still holding them stop being counted
+    void forget_storage(Allocator* allocator) {
 
-                    long long int curr_position = i * valid_b->get_columns();
+        std::lock_guard<std::mutex> lock(storage_mutex);
 
-                    for (long long int j = curr_position;
-                         j <= curr_position + (valid_b->get_columns() - 1 - valid_a->get_columns()); j++) {
+        for (auto entry = storage_blocks.begin(); entry != storage_blocks.end();) {
 
-                        output_a[j + valid_a->get_columns()] = output_a[j];
-                    }
-                }
-            }
+            if (entry->second.allocator == allocator) {
 
-            return flag;
+                account_host(entry->second.size, false);
+                entry = storage_blocks.erase(entry);
+            }
+            else
+                entry++;
         }
     }
 
-    cl_mem get_memory_buffer(size_t size, int buffer_type = CL_MEM_READ_ONLY) {
-
-        cl_int ret;
+    void set_allocator(Allocator* allocator) {
 
-        cl_mem buffer = clCreateBuffer(context, buffer_type,
-                                       size, nullptr, &ret);
+        storage_allocator = allocator;
+    }
 
-        if (ret != 0) {
-            throw MatrixStatus("Memory buffer could not be created.", 92);
-        }
+    Allocator* get_allocator() {
 
-        return buffer;
+        return storage_allocator;
     }
 
-    void enqueue_write(cl_mem buffer, Matrix matrix) {
+    Arena::Arena(size_t block_size) {
 
-        cl_int ret = clEnqueueWriteBuffer(queue, buffer, CL_TRUE, 0,
-                                          matrix.get_rows() * matrix.get_columns() * sizeof(float), matrix.get_matrix(),
-                                          0, nullptr, nullptr);
+        this->block_size = block_size;
+        this->used = 0;
+        this->previous = get_allocator();
 
-        if (ret != 0) {
+        set_allocator(this);
+    }
 
-            throw MatrixStatus("Memory buffer value could not be set.", 93);
-        }
+    Arena::~Arena() {
+
+        reset();
+        set_allocator(previous);
     }
 
-    void enqueue_write(cl_mem buffer, float item) {
+    void* Arena::allocate(size_t size) {
 
-        cl_int ret = clEnqueueWriteBuffer(queue, buffer, CL_TRUE, 0,
-                                          sizeof(float), &item,
-                                          0, nullptr, nullptr);
+        //storage from a page on stays page aligned, so it can still be wrapped without copying
+        size_t alignment = size >= storage_page ? storage_page : storage_line;
+        size_t padded = std::max<size_t>((size + storage_line - 1) / storage_line * storage_line, storage_line);
+        size_t offset = (used + alignment - 1) / alignment * alignment;
 
-        if (ret != 0) {
+        if (blocks.empty() || offset + padded > blocks.back().second) {
 
-            throw MatrixStatus("Memory buffer value could not be set.", 93);
+            size_t size_block = std::max(block_size, padded);
+
+            blocks.emplace_back(aligned_allocator.allocate(size_block), size_block);
+            offset = 0;
         }
-    }
 
-    void enqueue_write(cl_mem buffer, size_t size, float* matrix) {
+        used = offset + padded;
 
-        cl_int ret = clEnqueueWriteBuffer(queue, buffer, CL_TRUE, 0,
-                                          size, matrix,
-                                          0, nullptr, nullptr);
+        return static_cast<char*>(blocks.back().first) + offset;
+    }
+
+    void Arena::deallocate(void*, size_t) {
+    }
+
+    void Arena::reset() {
+
+        forget_storage(this);
+
+        for (auto& block : blocks)
+            aligned_allocator.deallocate(block.first, block.second);
+
+        blocks.clear();
+        used = 0;
+    }
+
+    template<typename T>
+    BasicMatrix<T>::BasicMatrix(size_t rows, size_t columns, int limit) {
+
+        this->rows = rows;
+        this->columns = columns;
+        this->row_stride = columns;
+
+        set_matrix(allocate_storage<T>(get_rows() * get_columns()));
+        initialize_matrix(limit);
+    }
+
+    template<typename T>
+    BasicMatrix<T>::BasicMatrix(size_t rows, size_t columns, Reader* reader) {
+
+        this->rows = rows;
+        this->columns = columns;
+        this->row_stride = columns;
+
+        set_matrix(allocate_storage<T>(get_rows() * get_columns()));
+        initialize_matrix(reader);
+    }
+
+    template<typename T>
+    BasicMatrix<T>::BasicMatrix(size_t rows, size_t columns, Uninitialized) {
+
+        this->rows = rows;
+        this->columns = columns;
+        this->row_stride = columns;
+
+        set_matrix(allocate_storage<T>(get_rows() * get_columns()));
+    }
+
+    template<typename T>
+    BasicMatrix<T> BasicMatrix<T>::empty(size_t rows, size_t columns) {
+
+        return BasicMatrix<T>(rows, columns, Uninitialized());
+    }
+
+    template<typename T>
+    MatrixStatus BasicMatrix<T>::initialize_matrix(int limit) {
+
+        try {
+
+            for (long long int i = 0; i < rows; i++) {
+
+                for (long long int j = 0; j < columns; j++) {
+
+                    set_element(i, j, rand() % limit);
+                }
+            }
+
+            return MatrixStatus("Success", 0);
+        }
+        catch (errno_t e) {
+
+            return MatrixStatus("Error Reading Values. Only float Values Supported.", 1);
+        }
+    }
+
+    template<typename T>
+    MatrixStatus BasicMatrix<T>::initialize_matrix(Reader* reader) {
+
+        try {
+
+            for (long long int i = 0; i < rows; i++) {
+
+                for (long long int j = 0; j < columns; j++) {
+
+                    float element = reader->read();
+                    set_element(i, j, element);
+                }
+            }
+
+            return MatrixStatus("Success", 0);
+        }
+        catch (errno_t e) {
+
+            return MatrixStatus("Error Reading Values. Only float Values Supported.", 1);
+        }
+    }
+
+    template<typename T>
+    T BasicMatrix<T>::get_element(size_t row, size_t column) const {
+        return this->matrix[row * (this->row_stride) + column * (this->column_step)];
+    }
+
+    template<typename T>
+    void BasicMatrix<T>::set_element(size_t row, size_t column, T value) {
+        this->matrix[row * (this->row_stride) + column * (this->column_step)] = value;
+    }
+
+    template<typename T>
+    T* BasicMatrix<T>::get_matrix() const {
+        return this->matrix;
+    }
+
+    template<typename T>
+    size_t BasicMatrix<T>::get_rows() const {
+
+        return this->rows;
+    }
+
+    template<typename T>
+    size_t BasicMatrix<T>::get_columns() const {
+
+        return this->columns;
+    }
+
+    template<typename T>
+    void BasicMatrix<T>::set_matrix(T* mat) {
+        this->matrix = mat;
+
+        //the storage it replaces is not freed, whether the new storage is the arena's is settled now, while it lives
+        this->arena = mat != nullptr && is_arena_storage(mat);
+    }
+
+    template<typename T>
+    void BasicMatrix<T>::clean_up() {
+
+        //arena storage is given back, and stops being counted, all at once when the arena ends
+        if (this->view || this->arena)
+            return;
+
+        release_storage(this->matrix);
+    }
+
+    template<typename T>
+    BasicMatrix<T> BasicMatrix<T>::block(size_t row, size_t column, size_t rows, size_t columns) const {
+
+        if (row + rows > this->rows || column + columns > this->columns) {
+
+            throw MatrixStatus("View is out of the bounds of the matrix.", 24);
+        }
+
+        BasicMatrix<T> result = *this;
+
+        result.rows = rows;
+        result.columns = columns;
+        result.matrix = this->matrix + row * this->row_stride + column * this->column_step;
+        result.view = true;
+
+        return result;
+    }
+
+    template<typename T>
+    BasicMatrix<T> BasicMatrix<T>::row_range(size_t begin, size_t end) const {
+
+        return block(begin, 0, end > begin ? end - begin : 0, this->columns);
+    }
+
+    template<typename T>
+    BasicMatrix<T> BasicMatrix<T>::column_range(size_t begin, size_t end) const {
+
+        return block(0, begin, this->rows, end > begin ? end - begin : 0);
+    }
+
+    template<typename T>
+    BasicMatrix<T> BasicMatrix<T>::strided(size_t row_step, size_t column_step) const {
+
+        if (row_step == 0 || column_step == 0) {
+
+            throw MatrixStatus("View is out of the bounds of the matrix.", 24);
+        }
+
+        BasicMatrix<T> result = *this;
+
+        result.rows = (this->rows + row_step - 1) / row_step;
+        result.columns = (this->columns + column_step - 1) / column_step;
+        result.row_stride = this->row_stride * row_step;
+        result.column_step = this->column_step * column_step;
+        result.view = true;
+
+        return result;
+    }
+
+    template<typename T>
+    BasicMatrix<T> BasicMatrix<T>::reshape(size_t rows, size_t columns) const {
+
+        if (rows * columns != this->rows * this->columns) {
+
+            throw MatrixStatus("Matrix cannot be reshaped to the requested dimensions.", 25);
+        }
+
+        if (!is_contiguous()) {
+
+            BasicMatrix<T> result = empty(rows, columns);
+
+            for (size_t i = 0; i < rows * columns; i++)
+                result.matrix[i] = get_element(i / this->columns, i % this->columns);
+
+            return result;
+        }
+
+        BasicMatrix<T> result = *this;
+
+        result.rows = rows;
+        result.columns = columns;
+        result.row_stride = columns;
+        result.view = true;
+
+        return result;
+    }
+
+    template<typename T>
+    bool BasicMatrix<T>::is_view() const {
+
+        return this->view;
+    }
+
+    template<typename T>
+    bool BasicMatrix<T>::is_contiguous() const {
+
+        return this->column_step == 1 && (this->row_stride == this->columns || this->rows <= 1);
+    }
+
+    template<typename T>
+    size_t BasicMatrix<T>::get_row_stride() const {
+
+        return this->row_stride;
+    }
+
+    template<typename T>
+    size_t BasicMatrix<T>::get_column_step() const {
+
+        return this->column_step;
+    }
+
+    template<typename T>
+    MatrixStatus BasicMatrix<T>::ones(float multiple) {
+
+        try {
+            //a view is filled in place
+            if (!this->view)
+                set_matrix(allocate_storage<T>(get_rows() * get_columns()));
+
+            for (long long int i = 0; i < rows; i++) {
+
+                for (long long int j = 0; j < columns; j++) {
+
+                    set_element(i, j, 1 * multiple);
+                }
+            }
+
+            return MatrixStatus("Success", 0);
+        }
+        catch (errno_t e) {
+
+            return MatrixStatus("Error Reading Values. Only float Values Supported.", 1);
+        }
+    }
+
+    template<typename T>
+    MatrixStatus BasicMatrix<T>::zeroes() {
+
+        try {
+            //a view is filled in place
+            if (!this->view)
+                set_matrix(allocate_storage<T>(get_rows() * get_columns()));
+
+            for (long long int i = 0; i < rows; i++) {
+
+                for (long long int j = 0; j < columns; j++) {
+
+                    set_element(i, j, 0);
+                }
+            }
+
+            return MatrixStatus("Success", 0);
+        }
+        catch (errno_t e) {
+
+            return MatrixStatus("Error Reading Values. Only float Values Supported.", 1);
+        }
+    }
+
+    template<typename T>
+    MatrixStatus BasicMatrix<T>::identity(float multiple) {
+
+        try {
+            //a view is filled in place
+            if (!this->view)
+                set_matrix(allocate_storage<T>(get_rows() * get_columns()));
+
+            for (long long int i = 0; i < rows; i++) {
+
+                for (long long int j = 0; j < columns; j++) {
+
+                    if (i != j)
+                        set_element(i, j, 0);
+                    else
+                        set_element(i, j, 1 * multiple);
+                }
+            }
+
+            return MatrixStatus("Success", 0);
+        }
+        catch (errno_t e) {
+
+            return MatrixStatus("Error Reading Values. Only float Values Supported.", 1);
+        }
+    }
+
+    template class BasicMatrix<float>;
+    template class BasicMatrix<double>;
+    template class BasicMatrix<int32_t>;
+    template class BasicMatrix<int8_t>;
+    template class BasicMatrix<half>;
+    template class BasicMatrix<uint8_t>;
+
+    half::half(float value) {
+
+        uint32_t f;
+        memcpy(&f, &value, sizeof(float));
+
+        uint32_t sign = (f >> 16) & 0x8000;
+        int exponent = (int)((f >> 23) & 0xff) - 127 + 15;
+        uint32_t mantissa = f & 0x7fffff;
+
+        if (((f >> 23) & 0xff) == 0xff) {
+
+            //infinities stay infinite, NaNs stay quiet NaNs
+            bits = (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+        }
+        else if (exponent >= 31) {
+
+            bits = (uint16_t)(sign | 0x7c00);
+        }
+        else if (exponent <= 0) {
+
+            //subnormal half, the implicit leading bit joins the shifted mantissa
+            if (exponent < -10) {
+
+                bits = (uint16_t)sign;
+                return;
+            }
+
+            mantissa |= 0x800000;
+            uint32_t shift = 14 - exponent;
+            uint32_t rounded = mantissa >> shift;
+            uint32_t remainder = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+
+            if (remainder > halfway || (remainder == halfway && (rounded & 1)))
+                rounded++;
+
+            bits = (uint16_t)(sign | rounded);
+        }
+        else {
+
+            uint32_t rounded = ((uint32_t)exponent << 10) | (mantissa >> 13);
+            uint32_t remainder = mantissa & 0x1fff;
+
+            //a carry out of the mantissa correctly bumps the exponent
+            if (remainder > 0x1000 || (remainder == 0x1000 && (rounded & 1)))
+                rounded++;
+
+            bits = (uint16_t)(sign | rounded);
+        }
+    }
+
+    half::operator float() const {
+
+        uint32_t sign = (uint32_t)(bits & 0x8000) << 16;
+        uint32_t exponent = (bits >> 10) & 0x1f;
+        uint32_t mantissa = bits & 0x3ff;
+        uint32_t f;
+
+        if (exponent == 0) {
+
+            if (mantissa == 0)
+                f = sign;
+            else {
+
+                //normalize the subnormal
+                exponent = 127 - 15 + 1;
+
+                while (!(mantissa & 0x400)) {
+
+                    mantissa <<= 1;
+                    exponent--;
+                }
+
+                f = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+            }
+        }
+        else if (exponent == 31)
+            f = sign | 0x7f800000 | (mantissa << 13);
+        else
+            f = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+
+        float value;
+        memcpy(&value, &f, sizeof(float));
+        return value;
+    }
+
+    SparseMatrix::SparseMatrix(size_t rows, size_t columns) {
+
+        this->rows = rows;
+        this->columns = columns;
+        this->row_pointers.assign(rows + 1, 0);
+    }
+
+    SparseMatrix::SparseMatrix(size_t rows, size_t columns, std::vector<int> row_pointers,
+                               std::vector<int> column_indices, std::vector<float> values) {
+
+        this->rows = rows;
+        this->columns = columns;
+
+        if (row_pointers.size() != rows + 1 || row_pointers[0] != 0 || column_indices.size() != values.size()
+            || (size_t)row_pointers[rows] != values.size()) {
+
+            throw MatrixStatus("Sparse matrix structure is invalid.", 22);
+        }
+
+        //every row pointer must lie in [0, nnz] and never decrease before any column index is looked up
+        for (size_t i = 0; i < rows; i++) {
+
+            if (row_pointers[i] < 0 || row_pointers[i] > row_pointers[i + 1]
+                || (size_t)row_pointers[i + 1] > values.size()) {
+
+                throw MatrixStatus("Sparse matrix structure is invalid.", 22);
+            }
+        }
+
+        for (size_t i = 0; i < rows; i++) {
+
+            for (int j = row_pointers[i]; j < row_pointers[i + 1]; j++) {
+
+                if (column_indices[j] < 0 || (size_t)column_indices[j] >= columns
+                    || (j > row_pointers[i] && column_indices[j] <= column_indices[j - 1])) {
+
+                    throw MatrixStatus("Sparse matrix structure is invalid.", 22);
+                }
+            }
+        }
+
+        this->row_pointers = std::move(row_pointers);
+        this->column_indices = std::move(column_indices);
+        this->values = std::move(values);
+    }
+
+    float SparseMatrix::get_element(size_t row, size_t column) const {
+
+        auto first = this->column_indices.begin() + this->row_pointers[row];
+        auto last = this->column_indices.begin() + this->row_pointers[row + 1];
+        auto position = std::lower_bound(first, last, (int)column);
+
+        if (position == last || *position != (int)column)
+            return 0.0f;
+
+        return this->values[position - this->column_indices.begin()];
+    }
+
+    size_t SparseMatrix::get_rows() const {
+
+        return this->rows;
+    }
+
+    size_t SparseMatrix::get_columns() const {
+
+        return this->columns;
+    }
+
+    size_t SparseMatrix::get_nonzeros() const {
+
+        return this->values.size();
+    }
+
+    const std::vector<int>& SparseMatrix::get_row_pointers() const {
+        return this->row_pointers;
+    }
+
+    const std::vector<int>& SparseMatrix::get_column_indices() const {
+        return this->column_indices;
+    }
+
+    const std::vector<float>& SparseMatrix::get_values() const {
+        return this->values;
+    }
+
+    CooBuilder::CooBuilder(size_t rows, size_t columns) {
+
+        this->rows = rows;
+        this->columns = columns;
+    }
+
+    void CooBuilder::add(size_t row, size_t column, float value) {
+
+        if (row >= rows || column >= columns) {
+
+            throw MatrixStatus("Sparse matrix structure is invalid.", 22);
+        }
+
+        this->row_indices.push_back((int)row);
+        this->column_indices.push_back((int)column);
+        this->values.push_back(value);
+    }
+
+    SparseMatrix CooBuilder::build() const {
+
+        //bucket the triplets by row, then order every row by column and fold the duplicates together
+        std::vector<int> row_pointers(rows + 1, 0), order(values.size());
+
+        for (int row : row_indices)
+            row_pointers[row + 1]++;
+
+        for (size_t i = 0; i < rows; i++)
+            row_pointers[i + 1] += row_pointers[i];
+
+        std::vector<int> next(row_pointers.begin(), row_pointers.end() - 1);
+
+        for (size_t i = 0; i < values.size(); i++)
+            order[next[row_indices[i]]++] = (int)i;
+
+        std::vector<int> compressed_pointers(rows + 1, 0), compressed_columns;
+        std::vector<float> compressed_values;
+
+        compressed_columns.reserve(values.size());
+        compressed_values.reserve(values.size());
+
+        for (size_t i = 0; i < rows; i++) {
+
+            std::stable_sort(order.begin() + row_pointers[i], order.begin() + row_pointers[i + 1],
+                             [this](int x, int y) { return column_indices[x] < column_indices[y]; });
+
+            for (int j = row_pointers[i]; j < row_pointers[i + 1]; j++) {
+
+                int entry = order[j];
+
+                if (j > row_pointers[i] && compressed_columns.back() == column_indices[entry])
+                    compressed_values.back() += values[entry];
+                else {
+
+                    compressed_columns.push_back(column_indices[entry]);
+                    compressed_values.push_back(values[entry]);
+                }
+            }
+
+            compressed_pointers[i + 1] = (int)compressed_values.size();
+        }
+
+        return SparseMatrix(rows, columns, compressed_pointers, compressed_columns, compressed_values);
+    }
+
+    std::ostream& operator<<(std::ostream& os, Matrix const& v) {
+        for (long long int i = 0; i < v.get_rows(); i++) {
+            for (long long int j = 0; j < v.get_columns(); j++) {
+                os << v.get_element(i, j) << "\t";
+            }
+            os << "\n";
+        }
+        return os;
+    }
+
+    int is_broadcast_possible(const Matrix* valid_a, const Matrix* valid_b, long long int* highest_cols,
+                              long long int* highest_rows) {
+        int flag = 0;
+
+        if ((valid_a->get_rows() >= valid_b->get_rows() && valid_a->get_rows() % valid_b->get_rows() == 0
+             && valid_a->get_columns() >= valid_b->get_columns() &&
+             valid_a->get_columns() % valid_b->get_columns() == 0)) {
+
+            flag = 2;
+
+            *highest_cols = valid_a->get_columns();
+            *highest_rows = valid_a->get_rows();
+        }
+        else if ((valid_a->get_rows() <= valid_b->get_rows() && valid_b->get_rows() % valid_a->get_rows() == 0
+                  && valid_a->get_columns() <= valid_b->get_columns() &&
+                  valid_b->get_columns() % valid_a->get_columns() == 0)) {
+
+            flag = 1;
+
+            *highest_cols = valid_b->get_columns();
+            *highest_rows = valid_b->get_rows();
+        }
+        else {
+            flag = 0;
+
+            *highest_cols = -1;
+            *highest_rows = -1;
+        }
+
+        return flag;
+    }
+
+    int broadcast2(const Matrix* valid_a, const Matrix* valid_b, float* output_a, float* output_b, int flag) {
+
+        if (flag == 0)
+            return flag;
+        else {
+
+            if (flag == 2) {
+
+                for (long long int i = 0; i < valid_a->get_rows(); i++) {
+
+                    for (long long int j = 0; j < valid_a->get_columns(); j++) {
+
+                        output_a[i * valid_a->get_columns() + j] = valid_a->get_element(i, j);
+                    }
+                }
+
+                long long int index = 0;
+
+                for (long long int i = 0; i < valid_b->get_rows(); i++) {
+
+                    for (long long int j = 0; j < valid_b->get_columns(); j++) {
+
+                        output_b[index] = valid_b->get_element(i, j);
+                        index++;
+                    }
+
+                    index -= valid_b->get_columns();
+                    index += valid_a->get_columns();
+                }
+
+                long long int rows_rep = valid_a->get_rows() / valid_b->get_rows();
+                long long int jump = valid_b->get_rows() * valid_a->get_columns();
+
+                for (long long int i = 0; i < rows_rep - 1; i++) {
+
+                    long long int k = 0;
+
+                    for (long long int j = i * jump; j < i * jump + jump; j++) {
+
+                        output_b[j + jump] = output_b[j];
+
+                        k++;
+
+                        if (k >= valid_b->get_columns()) {
+
+                            k = 0;
+                            j -= valid_b->get_columns();
+                            j += valid_a->get_columns();
+                        }
+                    }
+                }
+
+                for (long long int i = 0; i < valid_a->get_rows(); i++) {
+
+                    long long int curr_position = i * valid_a->get_columns();
+
+                    for (long long int j = curr_position;
+                         j <= curr_position + ((long long int)valid_a->get_columns() - 1
+                                             - (long long int)valid_b->get_columns()); j++) {
+
+                        output_b[j + valid_b->get_columns()] = output_b[j];
+                    }
+                }
+
+            }
+            else if (flag == 1) {
+
+                for (long long int i = 0; i < valid_b->get_rows(); i++) {
+
+                    for (long long int j = 0; j < valid_b->get_columns(); j++) {
+
+                        output_b[i * valid_b->get_columns() + j] = valid_b->get_element(i, j);
+                    }
+                }
+
+                long long int index = 0;
+
+                for (long long int i = 0; i < valid_a->get_rows(); i++) {
+
+                    for (long long int j = 0; j < valid_a->get_columns(); j++) {
+
+                        output_a[index] = valid_a->get_element(i, j);
+                        index++;
+                    }
+
+                    index -= valid_a->get_columns();
+                    index += valid_b->get_columns();
+                }
+
+                long long int rows_rep = valid_b->get_rows() / valid_a->get_rows();
+                long long int jump = valid_a->get_rows() * valid_b->get_columns();
+
+                for (long long int i = 0; i < rows_rep - 1; i++) {
+
+                    long long int k = 0;
+
+                    for (long long int j = i * jump; j < i * jump + jump; j++) {
+
+                        output_a[j + jump] = output_a[j];
+
+                        k++;
+
+                        if (k >= valid_a->get_columns()) {
+
+                            k = 0;
+                            j -= valid_a->get_columns();
+                            j += valid_b->get_columns();
+                        }
+                    }
+                }
+
+                for (long long int i = 0; i < valid_b->get_rows(); i++) {
+
+                    long long int curr_position = i * valid_b->get_columns();
+
+                    for (long long int j = curr_position;
+                         j <= curr_position + ((long long int)valid_b->get_columns() - 1
+                                             - (long long int)valid_a->get_columns()); j++) {
+
+                        output_a[j + valid_a->get_columns()] = output_a[j];
+                    }
+                }
+            }
+
+            return flag;
+        }
+    }
+
+    void add_profile(const std::string& command, size_t bytes, cl_ulong queued, cl_ulong submitted, cl_ulong started,
+                     cl_ulong ended) {
+
+        std::lock_guard<std::mutex> lock(profile_mutex);
+
+        ProfileStats& stats = profile_totals[command];
+        stats.command = command;
+        stats.count++;
+        stats.bytes += bytes;
+        stats.queued_ns += submitted - queued;
+        stats.submitted_ns += started - submitted;
+        stats.executed_ns += ended - started;
+    }
+
+    cl_ulong host_time() {
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void add_trace(const std::string& name, bool device, cl_ulong start, cl_ulong end) {
+
+        std::lock_guard<std::mutex> lock(profile_mutex);
+        trace_events.push_back({ name, device, trace_thread, start, end });
+    }
+
+    //records the host time spent in a scope, from construction to destruction,
+    //and names the operation that memory allocated meanwhile is counted under
+    struct TraceSpan {
+
+        const char* name;
+        cl_ulong start;
+
+        const char* outer_operation;
+
+        explicit TraceSpan(const char* name) : name(name), start(tracing_enabled ? host_time() : 0),
+                                               outer_operation(current_operation) {
+
+            if (current_operation == nullptr)
+                current_operation = name;
+        }
+
+        ~TraceSpan() {
+
+            current_operation = outer_operation;
+
+            if (tracing_enabled && start != 0)
+                add_trace(name, false, start, host_time());
+        }
+    };
+
+    //a marker's end time against the host clock right after it completes gives the offset of the queue's device
+    cl_long measure_device_offset(cl_command_queue target_queue) {
+
+        cl_event marker;
+        cl_ulong device_time = 0;
+        cl_long offset = 0;
+
+        if (clEnqueueMarkerWithWaitList(target_queue, 0, nullptr, &marker) == 0) {
+
+            clWaitForEvents(1, &marker);
+            cl_ulong host_now = host_time();
+
+            if (clGetEventProfilingInfo(marker, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &device_time,
+                                        nullptr) == 0)
+                offset = (cl_long)(device_time - host_now);
+
+            clReleaseEvent(marker);
+        }
+
+        return offset;
+    }
+
+    //the clock offset of the device that ran the event, measured on its queue the first time the device is seen
+    cl_long trace_device_offset(cl_event event) {
+
+        cl_command_queue event_queue = nullptr;
+        cl_device_id device = nullptr;
+
+        if (clGetEventInfo(event, CL_EVENT_COMMAND_QUEUE, sizeof(cl_command_queue), &event_queue, nullptr) != 0
+            || clGetCommandQueueInfo(event_queue, CL_QUEUE_DEVICE, sizeof(cl_device_id), &device, nullptr) != 0)
+            return 0;
+
+        {
+            std::lock_guard<std::mutex> lock(profile_mutex);
+
+            auto found = trace_device_offsets.find(device);
+
+            if (found != trace_device_offsets.end())
+                return found->second;
+        }
+
+        cl_long offset = measure_device_offset(event_queue);
+
+        std::lock_guard<std::mutex> lock(profile_mutex);
+        return trace_device_offsets.emplace(device, offset).first->second;
+    }
+
+    //event slot for the command about to be enqueued, nullptr while profiling is off
+    cl_event* profiled(const std::string& command, size_t bytes = 0) {
+
+        if (!profiling_enabled)
+            return nullptr;
+
+        profile_pending.push_back({ command, bytes, nullptr });
+        return &profile_pending.back().event;
+    }
+
+    std::string kernel_name(cl_kernel kernel) {
+
+        char name[128] = "kernel";
+        clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, sizeof(name), name, nullptr);
+
+        return name;
+    }
+
+    cl_event* profiled(cl_kernel kernel) {
+
+        if (!profiling_enabled)
+            return nullptr;
+
+        return profiled(kernel_name(kernel));
+    }
+
+    //adds the timestamps of the calling thread's enqueued commands to the totals
+    void collect_profile() {
+
+        for (ProfileRecord& record : profile_pending) {
+
+            if (record.event == nullptr)
+                continue;
+
+            cl_ulong times[4];
+            cl_int ret = clWaitForEvents(1, &record.event);
+
+            for (cl_uint i = 0; i < 4; i++)
+                ret |= clGetEventProfilingInfo(record.event, CL_PROFILING_COMMAND_QUEUED + i, sizeof(cl_ulong),
+                                               &times[i], nullptr);
+
+            //commands of a queue created before profiling was turned on carry no timestamps
+            if (ret == 0) {
+
+                add_profile(record.command, record.bytes, times[0], times[1], times[2], times[3]);
+
+                if (tracing_enabled) {
+
+                    cl_long offset = trace_device_offset(record.event);
+                    add_trace(record.command, true, times[2] - offset, times[3] - offset);
+                }
+            }
+
+            clReleaseEvent(record.event);
+        }
+
+        profile_pending.clear();
+    }
+
+    cl_mem get_memory_buffer(size_t size, int buffer_type = CL_MEM_READ_ONLY) {
+
+        cl_int ret;
+        cl_ulong started = profiling_enabled ? host_time() : 0;
+
+        cl_mem buffer = clCreateBuffer(context, buffer_type,
+                                       size, nullptr, &ret);
+
+        if (ret != 0) {
+            throw MatrixStatus("Memory buffer could not be created.", 92);
+        }
+
+        account_device(size, true);
+
+        //buffer creation is not a queued command, it is timed on the host
+        if (profiling_enabled) {
+
+            cl_ulong ended = host_time();
+            add_profile("create buffer", size, started, started, started, ended);
+
+            if (tracing_enabled)
+                add_trace("create buffer", false, started, ended);
+        }
+
+        return buffer;
+    }
+
+    StagingSlot& staging_slot(size_t index) {
+
+        if (staging_ring.empty()) {
+
+            staging_ring.assign(staging_slots, { nullptr, nullptr, nullptr });
+
+            for (StagingSlot& slot : staging_ring) {
+
+                cl_int ret;
+                slot.buffer = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, staging_chunk, nullptr,
+                                             &ret);
+
+                if (ret == 0)
+                    slot.mapped = clEnqueueMapBuffer(queue, slot.buffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0,
+                                                     staging_chunk, 0, nullptr, nullptr, &ret);
+
+                if (ret != 0) {
+
+                    throw MatrixStatus("Memory buffer could not be created.", 92);
+                }
+            }
+        }
+
+        return staging_ring[index];
+    }
+
+    //the slot's last transfer must be done before its memory is reused
+    void wait_staging(StagingSlot& slot) {
+
+        if (slot.pending == nullptr)
+            return;
+
+        cl_int ret = clWaitForEvents(1, &slot.pending);
+
+        clReleaseEvent(slot.pending);
+        slot.pending = nullptr;
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error synchronizing kernel tasks.", 96);
+        }
+    }
+
+    //the slot keeps its own reference to an event handed to the profiler
+    void keep_staging_event(StagingSlot& slot, cl_event* event) {
+
+        if (event != nullptr) {
+
+            slot.pending = *event;
+            clRetainEvent(slot.pending);
+        }
+    }
+
+    void release_staging() {
+
+        for (StagingSlot& slot : staging_ring) {
+
+            if (slot.pending != nullptr) {
+
+                clWaitForEvents(1, &slot.pending);
+                clReleaseEvent(slot.pending);
+            }
+
+            if (slot.mapped != nullptr)
+                clEnqueueUnmapMemObject(queue, slot.buffer, slot.mapped, 0, nullptr, nullptr);
+
+            if (slot.buffer != nullptr)
+                clReleaseMemObject(slot.buffer);
+        }
+
+        staging_ring.clear();
+    }
+
+    //pageable memory is staged when pinned memory is on and the transfer is large enough to gain from it,
+    //on unified memory there is no transfer to speed up
+    bool is_staged(size_t size, const void* data) {
+
+        return pinned_enabled && !unified_memory && size >= staging_threshold && !is_pinned(data);
+    }
+
+    void staged_write(cl_mem buffer, size_t size, const void* data) {
+
+        for (size_t offset = 0, index = 0; offset < size; offset += staging_chunk, index = (index + 1) % staging_slots) {
+
+            StagingSlot& slot = staging_slot(index);
+            size_t chunk = std::min(staging_chunk, size - offset);
+
+            wait_staging(slot);
+            memcpy(slot.mapped, static_cast<const char*>(data) + offset, chunk);
+
+            cl_event* event = profiled("write", chunk);
+            cl_int ret = clEnqueueWriteBuffer(queue, buffer, CL_FALSE, offset, chunk, slot.mapped, 0, nullptr,
+                                              event != nullptr ? event : &slot.pending);
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Memory buffer value could not be set.", 93);
+            }
+
+            keep_staging_event(slot, event);
+        }
+    }
+
+    void enqueue_staged_read(cl_mem buffer, size_t size, size_t index) {
+
+        StagingSlot& slot = staging_slot(index % staging_slots);
+        size_t offset = index * staging_chunk;
+        size_t chunk = std::min(staging_chunk, size - offset);
+
+        wait_staging(slot);
+
+        cl_event* event = profiled("read", chunk);
+        cl_int ret = clEnqueueReadBuffer(queue, buffer, CL_FALSE, offset, chunk, slot.mapped, 0, nullptr,
+                                         event != nullptr ? event : &slot.pending);
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error reading output from kernel.", 97);
+        }
+
+        keep_staging_event(slot, event);
+    }
+
+    //keeps every slot reading ahead, each chunk is copied out while the following ones are transferred
+    void staged_read(cl_mem buffer, size_t size, void* data) {
+
+        size_t chunks = (size + staging_chunk - 1) / staging_chunk;
+
+        for (size_t index = 0; index < std::min(chunks, staging_slots); index++)
+            enqueue_staged_read(buffer, size, index);
+
+        for (size_t index = 0; index < chunks; index++) {
+
+            StagingSlot& slot = staging_slot(index % staging_slots);
+            size_t offset = index * staging_chunk;
+
+            wait_staging(slot);
+            memcpy(static_cast<char*>(data) + offset, slot.mapped, std::min(staging_chunk, size - offset));
+
+            if (index + staging_slots < chunks)
+                enqueue_staged_read(buffer, size, index + staging_slots);
+        }
+    }
+
+    //untyped variants for matrices of any element type, the typed ones below go through them
+    void enqueue_write_bytes(cl_mem buffer, size_t size, const void* data) {
+
+        if (is_staged(size, data)) {
+
+            staged_write(buffer, size, data);
+            return;
+        }
+
+        cl_int ret = clEnqueueWriteBuffer(queue, buffer, CL_TRUE, 0,
+                                          size, data,
+                                          0, nullptr, profiled("write", size));
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Memory buffer value could not be set.", 93);
+        }
+    }
+
+    void enqueue_read_bytes(cl_mem buffer, size_t size, void* data) {
+
+        if (is_staged(size, data)) {
+
+            staged_read(buffer, size, data);
+            return;
+        }
+
+        cl_int ret = clEnqueueReadBuffer(queue, buffer, CL_TRUE, 0,
+                                         size, data,
+                                         0, nullptr, profiled("read", size));
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error reading output from kernel.", 97);
+        }
+    }
+
+    //Views are packed into the buffer straight from the storage they share, one row per line of a rectangular
+    //transfer. A column step leaves no rectangle to transfer, those views are gathered on the host first
+    template<typename T>
+    void write_view(cl_command_queue target, cl_mem buffer, const BasicMatrix<T>& view, cl_bool blocking = CL_TRUE) {
+
+        size_t row_bytes = view.get_columns() * sizeof(T);
+        size_t size = view.get_rows() * row_bytes;
+        cl_int ret = 0;
+
+        if (size == 0)
+            return;
+
+        if (view.is_contiguous() && target == queue && blocking) {
+
+            enqueue_write_bytes(buffer, size, view.get_matrix());
+            return;
+        }
+
+        if (view.is_contiguous()) {
+
+            ret = clEnqueueWriteBuffer(target, buffer, blocking, 0, size, view.get_matrix(), 0, nullptr,
+                                       profiled("write", size));
+        }
+        else if (view.get_column_step() == 1) {
+
+            const size_t origin[3] = { 0, 0, 0 };
+            const size_t region[3] = { row_bytes, view.get_rows(), 1 };
+
+            ret = clEnqueueWriteBufferRect(target, buffer, blocking, origin, origin, region, row_bytes, 0,
+                                           view.get_row_stride() * sizeof(T), 0, view.get_matrix(), 0, nullptr,
+                                           profiled("write", size));
+        }
+        else {
+
+            std::vector<T> packed(view.get_rows() * view.get_columns());
+
+            for (size_t i = 0; i < view.get_rows(); i++)
+                for (size_t j = 0; j < view.get_columns(); j++)
+                    packed[i * view.get_columns() + j] = view.get_element(i, j);
+
+            ret = clEnqueueWriteBuffer(target, buffer, CL_TRUE, 0, size, packed.data(), 0, nullptr,
+                                       profiled("write", size));
+        }
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Memory buffer value could not be set.", 93);
+        }
+    }
+
+    //the contiguous result in the buffer is spread over the elements the view refers to
+    template<typename T>
+    void read_view(cl_mem buffer, BasicMatrix<T> view) {
+
+        size_t row_bytes = view.get_columns() * sizeof(T);
+        size_t size = view.get_rows() * row_bytes;
+        cl_int ret = 0;
+
+        if (size == 0)
+            return;
+
+        if (view.is_contiguous()) {
+
+            enqueue_read_bytes(buffer, size, view.get_matrix());
+            return;
+        }
+
+        if (view.get_column_step() == 1) {
+
+            const size_t origin[3] = { 0, 0, 0 };
+            const size_t region[3] = { row_bytes, view.get_rows(), 1 };
+
+            ret = clEnqueueReadBufferRect(queue, buffer, CL_TRUE, origin, origin, region, row_bytes, 0,
+                                          view.get_row_stride() * sizeof(T), 0, view.get_matrix(), 0, nullptr,
+                                          profiled("read", size));
+        }
+        else {
+
+            std::vector<T> packed(view.get_rows() * view.get_columns());
+
+            ret = clEnqueueReadBuffer(queue, buffer, CL_TRUE, 0, size, packed.data(), 0, nullptr,
+                                      profiled("read", size));
+
+            for (size_t i = 0; i < view.get_rows(); i++)
+                for (size_t j = 0; j < view.get_columns(); j++)
+                    view.set_element(i, j, packed[i * view.get_columns() + j]);
+        }
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error reading output from kernel.", 97);
+        }
+    }
+
+    void enqueue_write(cl_mem buffer, Matrix matrix) {
+
+        write_view(queue, buffer, matrix);
+    }
+
+    void enqueue_write(cl_mem buffer, float item) {
+
+        cl_int ret = clEnqueueWriteBuffer(queue, buffer, CL_TRUE, 0,
+                                          sizeof(float), &item,
+                                          0, nullptr, profiled("write", sizeof(float)));
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Memory buffer value could not be set.", 93);
+        }
+    }
+
+    void enqueue_write(cl_mem buffer, size_t size, const float* matrix) {
+
+        enqueue_write_bytes(buffer, size, matrix);
+    }
+
+    void enqueue_write(cl_mem buffer, size_t size, const int* items) {
+
+        enqueue_write_bytes(buffer, size, items);
+    }
+
+    //writes a (rows x columns) block to position (row, column) of a buffer that holds `ld` columns per row
+    void enqueue_write_block(cl_mem buffer, size_t ld, size_t row, size_t column, size_t rows, size_t columns,
+                             float* block) {
+
+        const size_t buffer_origin[3] = { column * sizeof(float), row, 0 };
+        const size_t host_origin[3] = { 0, 0, 0 };
+        const size_t region[3] = { columns * sizeof(float), rows, 1 };
+
+        cl_int ret = clEnqueueWriteBufferRect(queue, buffer, CL_TRUE, buffer_origin, host_origin, region,
+                                              ld * sizeof(float), 0, columns * sizeof(float), 0, block,
+                                              0, nullptr, profiled("write", region[0] * region[1]));
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Memory buffer value could not be set.", 93);
+        }
+    }
+
+    void enqueue_read(cl_mem buffer, size_t size, float* matrix) {
+
+        enqueue_read_bytes(buffer, size, matrix);
+    }
+
+    void enqueue_read(cl_mem buffer, size_t size, int* items) {
+
+        enqueue_read_bytes(buffer, size, items);
+    }
+
+    //reads a (rows x columns) block from position (row, column) of a buffer that holds `ld` columns per row
+    void enqueue_read_block(cl_mem buffer, size_t ld, size_t row, size_t column, size_t rows, size_t columns,
+                            float* block) {
+
+        const size_t buffer_origin[3] = { column * sizeof(float), row, 0 };
+        const size_t host_origin[3] = { 0, 0, 0 };
+        const size_t region[3] = { columns * sizeof(float), rows, 1 };
+
+        cl_int ret = clEnqueueReadBufferRect(queue, buffer, CL_TRUE, buffer_origin, host_origin, region,
+                                             ld * sizeof(float), 0, columns * sizeof(float), 0, block,
+                                             0, nullptr, profiled("read", region[0] * region[1]));
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error reading output from kernel.", 97);
+        }
+    }
+
+    void enqueue_fill(cl_mem buffer, size_t size, float value) {
+
+        cl_int ret = clEnqueueFillBuffer(queue, buffer, &value, sizeof(float), 0, size, 0, nullptr,
+                                         profiled("fill", size));
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Memory buffer value could not be set.", 93);
+        }
+    }
+
+    void set_argument(cl_kernel kernel, int argument_position, void* argument, size_t size = sizeof(int)) {
+
+        cl_int ret = clSetKernelArg(kernel, argument_position, size, argument);
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Kernel arguments could not be set.", 94);
+        }
+    }
+
+    void synchronize() {
+
+        TraceSpan span("synchronize");
+        cl_int ret = clFinish(queue);
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error synchronizing kernel tasks.", 96);
+        }
+
+        if (!profile_pending.empty())
+            collect_profile();
+    }
+
+    void release(cl_mem buffer) {
+
+        size_t size = 0;
+        cl_mem_flags flags = 0;
+
+        //buffers wrapping host storage were never counted as device memory
+        clGetMemObjectInfo(buffer, CL_MEM_FLAGS, sizeof(cl_mem_flags), &flags, nullptr);
+
+        if (!(flags & CL_MEM_USE_HOST_PTR) &&
+            clGetMemObjectInfo(buffer, CL_MEM_SIZE, sizeof(size_t), &size, nullptr) == 0)
+            account_device(size, false);
+
+        cl_int ret = clReleaseMemObject(buffer);
+
+        if (ret != 0) {
+
+            std::cerr << "98: WARNING: Error clearing kernel space. Memory leaks may happen.\n";
+        }
+    }
+
+    //wraps host storage on unified memory devices, the storage must stay alive and untouched until the buffer is released
+    cl_mem host_buffer(void* data, size_t size, int buffer_type) {
+
+        cl_int ret;
+        cl_mem buffer = clCreateBuffer(context, buffer_type | CL_MEM_USE_HOST_PTR, size, data, &ret);
+
+        if (ret != 0) {
+            throw MatrixStatus("Memory buffer could not be created.", 92);
+        }
+
+        return buffer;
+    }
+
+    //an operand of a kernel, zero-copy on unified memory and written to the device otherwise
+    cl_mem input_buffer(const void* data, size_t size) {
+
+        if (unified_memory)
+            return host_buffer(const_cast<void*>(data), size, CL_MEM_READ_ONLY);
+
+        cl_mem buffer = get_memory_buffer(size);
+        enqueue_write_bytes(buffer, size, data);
+
+        return buffer;
+    }
+
+    //views are only wrapped when their elements are contiguous, the others are packed into a buffer of their own
+    template<typename T>
+    cl_mem input_buffer(const BasicMatrix<T>& matrix) {
+
+        size_t size = matrix.get_rows() * matrix.get_columns() * sizeof(T);
+
+        if (matrix.is_contiguous())
+            return input_buffer(matrix.get_matrix(), size);
+
+        cl_mem buffer = get_memory_buffer(size);
+        write_view(queue, buffer, matrix);
+
+        return buffer;
+    }
+
+    //the result of a kernel, written straight into the storage of the result on unified memory
+    cl_mem output_buffer(void* data, size_t size) {
+
+        if (unified_memory)
+            return host_buffer(data, size, CL_MEM_WRITE_ONLY);
+
+        return get_memory_buffer(size, CL_MEM_WRITE_ONLY);
+    }
+
+    //brings the result into the host storage, mapping it makes the kernel writes visible without copying
+    void finish_output(cl_mem buffer, void* data, size_t size) {
+
+        if (!unified_memory) {
+
+            enqueue_read_bytes(buffer, size, data);
+            return;
+        }
+
+        cl_int ret;
+        void* mapped = clEnqueueMapBuffer(queue, buffer, CL_TRUE, CL_MAP_READ, 0, size, 0, nullptr,
+                                          profiled("map", size), &ret);
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error reading output from kernel.", 97);
+        }
+
+        ret = clEnqueueUnmapMemObject(queue, buffer, mapped, 0, nullptr, nullptr);
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error reading output from kernel.", 97);
+        }
+    }
+
+    //unless a local size is given the work-group size is left to the runtime,
+    //so global sizes need not be multiples of anything
+    void enqueue_kernel(cl_kernel kernel, cl_uint dimensions, const size_t* global_work_size,
+                        const size_t* local_work_size = nullptr) {
+
+        cl_int ret = clEnqueueNDRangeKernel(queue, kernel, dimensions, nullptr,
+                                            global_work_size, local_work_size, 0, nullptr, profiled(kernel));
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error launching kernel.", 95);
+        }
+    }
+
+    //y = A * x, where A is the (m x n) block at offset_a of a row-major buffer with `lda` columns per row
+    void gemv(size_t m, size_t n, cl_mem a, size_t offset_a, size_t lda, cl_mem x, cl_mem y) {
+
+        if (m == 0)
+            return;
+
+        int args[4] = { (int)m, (int)n, (int)offset_a, (int)lda };
+
+        set_argument(matrix_kernel_gemv, 0, (void*)&args[0]);
+        set_argument(matrix_kernel_gemv, 1, (void*)&args[1]);
+        set_argument(matrix_kernel_gemv, 2, (void*)&a, sizeof(cl_mem));
+        set_argument(matrix_kernel_gemv, 3, (void*)&args[2]);
+        set_argument(matrix_kernel_gemv, 4, (void*)&args[3]);
+        set_argument(matrix_kernel_gemv, 5, (void*)&x, sizeof(cl_mem));
+        set_argument(matrix_kernel_gemv, 6, (void*)&y, sizeof(cl_mem));
+        set_argument(matrix_kernel_gemv, 7, nullptr, gemv_lanes * sizeof(float));
+
+        //one work-group per row, its lanes stride over the row together and reduce in local memory
+        const size_t local_work_size = gemv_lanes;
+        const size_t global_work_size = m * gemv_lanes;
+        enqueue_kernel(matrix_kernel_gemv, 1, &global_work_size, &local_work_size);
+    }
+
+    bool is_partitioned(size_t rows) {
+
+        return device_queues.size() > 1 && rows >= device_queues.size() * partition_min_rows;
+    }
+
+    //row boundaries of the blocks given to each device queue, proportional to the weights of their devices
+    std::vector<size_t> partition_rows(size_t rows) {
+
+        std::vector<double> weights;
+
+        {
+            std::lock_guard<std::mutex> lock(parallel_mutex);
+
+            for (size_t device : queue_devices)
+                weights.push_back(device_weights[device]);
+        }
+
+        double total = 0, sum = 0;
+
+        for (double weight : weights)
+            total += weight;
+
+        std::vector<size_t> bounds(weights.size() + 1, 0);
+
+        for (size_t i = 0; i < weights.size(); i++) {
+
+            sum += weights[i];
+            bounds[i + 1] = (size_t)(rows * sum / total + 0.5);
+        }
+
+        bounds.back() = rows;
+        return bounds;
+    }
+
+    //Moves the weights of the devices that ran a block towards the throughput their kernels achieved. The queues of
+    //one device run side by side, so a device's rate is all its rows over the span from its first to its last kernel
+    void record_partition(const std::vector<size_t>& bounds, const std::vector<cl_event>& events) {
+
+        size_t device_count = device_weights.size();
+
+        std::vector<double> rows(device_count, 0), rates(device_count, 0);
+        std::vector<cl_ulong> first(device_count, std::numeric_limits<cl_ulong>::max()), last(device_count, 0);
+        std::vector<bool> ran(device_count, false);
+        double rate_total = 0;
+
+        for (size_t i = 0; i < events.size(); i++) {
+
+            if (events[i] == nullptr)
+                continue;
+
+            cl_ulong start = 0, end = 0;
+            clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, nullptr);
+            clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, nullptr);
+
+            size_t device = queue_devices[i];
+
+            rows[device] += (double)(bounds[i + 1] - bounds[i]);
+            first[device] = std::min(first[device], start);
+            last[device] = std::max(last[device], end);
+            ran[device] = true;
+        }
+
+        for (size_t d = 0; d < device_count; d++) {
+
+            if (!ran[d])
+                continue;
+
+            rates[d] = rows[d] / (double)std::max<cl_ulong>(last[d] > first[d] ? last[d] - first[d] : 0, 1);
+            rate_total += rates[d];
+        }
+
+        std::lock_guard<std::mutex> lock(parallel_mutex);
+
+        double weight_total = 0;
+
+        for (size_t d = 0; d < device_count; d++)
+            if (ran[d])
+                weight_total += device_weights[d];
+
+        for (size_t d = 0; d < device_count; d++)
+            if (ran[d])
+                device_weights[d] = 0.75 * device_weights[d] + 0.25 * weight_total * rates[d] / rate_total;
+    }
+
+    //waits for every device queue, updates the weights and releases the blocks' buffers and events
+    void finish_partition(cl_kernel kernel, const std::vector<size_t>& bounds, std::vector<cl_event>& events,
+                          std::vector<cl_mem>& buffers) {
+
+        cl_int ret = 0;
+
+        for (cl_command_queue device_queue : device_queues)
+            ret |= clFinish(device_queue);
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error synchronizing kernel tasks.", 96);
+        }
+
+        record_partition(bounds, events);
+
+        //the block kernels already carry events, profiling takes them over instead of releasing them
+        for (cl_event event : events) {
+
+            if (event == nullptr)
+                continue;
+
+            if (profiling_enabled)
+                profile_pending.push_back({ kernel_name(kernel), 0, event });
+            else
+                clReleaseEvent(event);
+        }
+
+        collect_profile();
+
+        for (cl_mem buffer : buffers)
+            release(buffer);
+    }
+
+    //runs an element-wise kernel (a, b, results) with one row block per device queue, each block is read straight
+    //into its place in the result
+    Matrix elementwise_partitioned(cl_kernel kernel, size_t rows, size_t columns, const float* a, const float* b) {
+
+        Matrix result(rows, columns);
+
+        std::vector<size_t> bounds = partition_rows(rows);
+        std::vector<cl_event> events(device_queues.size(), nullptr);
+        std::vector<cl_mem> buffers;
+
+        for (size_t i = 0; i < device_queues.size(); i++) {
+
+            size_t offset = bounds[i] * columns;
+            size_t size = (bounds[i + 1] - bounds[i]) * columns;
+
+            if (size == 0)
+                continue;
+
+            cl_mem memory_input_a = get_memory_buffer(size * sizeof(float));
+            cl_mem memory_input_b = get_memory_buffer(size * sizeof(float));
+            cl_mem memory_output_a = get_memory_buffer(size * sizeof(float), CL_MEM_WRITE_ONLY);
+
+            buffers.push_back(memory_input_a);
+            buffers.push_back(memory_input_b);
+            buffers.push_back(memory_output_a);
+
+            cl_int ret = clEnqueueWriteBuffer(device_queues[i], memory_input_a, CL_FALSE, 0, size * sizeof(float),
+                                              a + offset, 0, nullptr, profiled("write", size * sizeof(float)));
+            ret |= clEnqueueWriteBuffer(device_queues[i], memory_input_b, CL_FALSE, 0, size * sizeof(float),
+                                        b + offset, 0, nullptr, profiled("write", size * sizeof(float)));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Memory buffer value could not be set.", 93);
+            }
+
+            set_argument(kernel, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(kernel, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(kernel, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            ret = clEnqueueNDRangeKernel(device_queues[i], kernel, 1, nullptr, &size, nullptr, 0, nullptr, &events[i]);
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            ret = clEnqueueReadBuffer(device_queues[i], memory_output_a, CL_FALSE, 0, size * sizeof(float),
+                                      result.get_matrix() + offset, 0, nullptr, profiled("read", size * sizeof(float)));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error reading output from kernel.", 97);
+            }
+        }
+
+        finish_partition(kernel, bounds, events, buffers);
+
+        return result;
+    }
+
+    //a * b with one row block of a per device queue, every queue gets the whole of b
+    Matrix matmul_partitioned(Matrix a, Matrix b) {
+
+        size_t inter = a.get_columns(), columns = b.get_columns();
+
+        Matrix result(a.get_rows(), columns);
+
+        std::vector<size_t> bounds = partition_rows(a.get_rows());
+        std::vector<cl_event> events(device_queues.size(), nullptr);
+        std::vector<cl_mem> buffers;
+
+        for (size_t i = 0; i < device_queues.size(); i++) {
+
+            size_t block_rows = bounds[i + 1] - bounds[i];
+
+            if (block_rows == 0)
+                continue;
+
+            cl_mem memory_input_a = get_memory_buffer(block_rows * inter * sizeof(float));
+            cl_mem memory_input_b = get_memory_buffer(inter * columns * sizeof(float));
+            cl_mem memory_output_a = get_memory_buffer(block_rows * columns * sizeof(float), CL_MEM_WRITE_ONLY);
+
+            buffers.push_back(memory_input_a);
+            buffers.push_back(memory_input_b);
+            buffers.push_back(memory_output_a);
+
+            write_view(device_queues[i], memory_input_a, a.row_range(bounds[i], bounds[i + 1]), CL_FALSE);
+            write_view(device_queues[i], memory_input_b, b, CL_FALSE);
+
+            cl_int ret;
+            int args[3] = { (int)block_rows, (int)columns, (int)inter };
+
+            set_argument(matrix_kernel_multiply, 0, (void*)&args[0]);
+            set_argument(matrix_kernel_multiply, 1, (void*)&args[1]);
+            set_argument(matrix_kernel_multiply, 2, (void*)&args[2]);
+            set_argument(matrix_kernel_multiply, 3, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(matrix_kernel_multiply, 4, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(matrix_kernel_multiply, 5, (void*)&memory_output_a, sizeof(cl_mem));
+
+            const size_t global_work_size[2] = { block_rows, columns };
+
+            ret = clEnqueueNDRangeKernel(device_queues[i], matrix_kernel_multiply, 2, nullptr, global_work_size,
+                                         nullptr, 0, nullptr, &events[i]);
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            ret = clEnqueueReadBuffer(device_queues[i], memory_output_a, CL_FALSE, 0,
+                                      block_rows * columns * sizeof(float),
+                                      result.get_matrix() + bounds[i] * columns, 0, nullptr,
+                                      profiled("read", block_rows * columns * sizeof(float)));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error reading output from kernel.", 97);
+            }
+        }
+
+        finish_partition(matrix_kernel_multiply, bounds, events, buffers);
+
+        return result;
+    }
+
+    Matrix matmul(Matrix a, Matrix b) {
+
+        TraceSpan span("matmul");
+
+        //a matrix-vector product is bandwidth bound, it goes through the reduction kernel instead
+        if (b.get_columns() == 1 && a.get_columns() == b.get_rows()) {
+
+            Matrix result(a.get_rows(), 1);
+
+            cl_mem memory_input_a = get_memory_buffer(a.get_rows() * a.get_columns() * sizeof(float));
+            cl_mem memory_input_b = get_memory_buffer(b.get_rows() * sizeof(float));
+            cl_mem memory_output_a = get_memory_buffer(a.get_rows() * sizeof(float), CL_MEM_WRITE_ONLY);
+
+            enqueue_write(memory_input_a, a);
+            enqueue_write(memory_input_b, b);
+
+            gemv(a.get_rows(), a.get_columns(), memory_input_a, 0, a.get_columns(), memory_input_b, memory_output_a);
+            synchronize();
+
+            enqueue_read(memory_output_a, a.get_rows() * sizeof(float), result.get_matrix());
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+
+            return result;
+        }
+
+        if (a.get_columns() == b.get_rows() && is_partitioned(a.get_rows()))
+            return matmul_partitioned(a, b);
+
+        cl_int ret;
+
+        Matrix result(a.get_rows(), b.get_columns());
+
+        cl_mem memory_input_a = input_buffer(a);
+        cl_mem memory_input_b = input_buffer(b);
+        cl_mem memory_output_a = output_buffer(result.get_matrix(), a.get_rows() * b.get_columns() * sizeof(float));
+
+        int rows = a.get_rows(), cols = b.get_columns(), inter = b.get_rows();
+
+        set_argument(matrix_kernel_multiply, 0, (void*)&rows);
+        set_argument(matrix_kernel_multiply, 1, (void*)&cols);
+        set_argument(matrix_kernel_multiply, 2, (void*)&inter);
+        set_argument(matrix_kernel_multiply, 3, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(matrix_kernel_multiply, 4, (void*)&memory_input_b, sizeof(cl_mem));
+        set_argument(matrix_kernel_multiply, 5, (void*)&memory_output_a, sizeof(cl_mem));
+
+        const size_t local_work_size[2] = { 1, 1 };
+        const size_t global_work_size[2] = { a.get_rows(), b.get_columns() };
+
+        ret = clEnqueueNDRangeKernel(queue, matrix_kernel_multiply, 2, nullptr,
+                                     global_work_size, local_work_size, 0, nullptr, profiled(matrix_kernel_multiply));
+
+        if (ret != 0)
+            throw MatrixStatus("Error launching kernel.", 95);
+
+        synchronize();
+
+        finish_output(memory_output_a, result.get_matrix(), a.get_rows() * b.get_columns() * sizeof(float));
+
+        release(memory_input_a);
+        release(memory_input_b);
+        release(memory_output_a);
+
+        return result;
+    }
+
+    void gemm(bool trans_a, bool trans_b, float alpha, Matrix a, Matrix b, float beta, Matrix& c) {
+
+        TraceSpan span("gemm");
+
+        size_t m = trans_a ? a.get_columns() : a.get_rows();
+        size_t k = trans_a ? a.get_rows() : a.get_columns();
+        size_t n = trans_b ? b.get_rows() : b.get_columns();
+
+        if ((trans_b ? b.get_columns() : b.get_rows()) != k || c.get_rows() != m || c.get_columns() != n) {
+
+            throw MatrixStatus("Matrix dimensions are unmatchable for the product.", 21);
+        }
+
+        if (m == 0 || n == 0)
+            return;
+
+        cl_mem memory_input_a = get_memory_buffer(a.get_rows() * a.get_columns() * sizeof(float));
+        cl_mem memory_input_b = get_memory_buffer(b.get_rows() * b.get_columns() * sizeof(float));
+        cl_mem memory_output_a = get_memory_buffer(m * n * sizeof(float), CL_MEM_READ_WRITE);
+
+        enqueue_write(memory_input_a, a);
+        enqueue_write(memory_input_b, b);
+
+        //with beta zero the old contents of C are never read, so they need not be uploaded
+        if (beta != 0.0f)
+            enqueue_write(memory_output_a, c);
+
+        int args[5] = { (int)m, (int)n, (int)k, trans_a ? 1 : 0, trans_b ? 1 : 0 };
+
+        set_argument(matrix_kernel_gemm, 0, (void*)&args[0]);
+        set_argument(matrix_kernel_gemm, 1, (void*)&args[1]);
+        set_argument(matrix_kernel_gemm, 2, (void*)&args[2]);
+        set_argument(matrix_kernel_gemm, 3, (void*)&args[3]);
+        set_argument(matrix_kernel_gemm, 4, (void*)&args[4]);
+        set_argument(matrix_kernel_gemm, 5, (void*)&alpha, sizeof(float));
+        set_argument(matrix_kernel_gemm, 6, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(matrix_kernel_gemm, 7, (void*)&memory_input_b, sizeof(cl_mem));
+        set_argument(matrix_kernel_gemm, 8, (void*)&beta, sizeof(float));
+        set_argument(matrix_kernel_gemm, 9, (void*)&memory_output_a, sizeof(cl_mem));
+
+        const size_t global_work_size[2] = { m, n };
+        enqueue_kernel(matrix_kernel_gemm, 2, global_work_size);
+
+        synchronize();
+
+        read_view(memory_output_a, c);
+
+        release(memory_input_a);
+        release(memory_input_b);
+        release(memory_output_a);
+    }
+
+    Matrix matmul_batched(Matrix a, Matrix b, size_t batch) {
+
+        TraceSpan span("matmul_batched");
+
+        if (batch == 0 || a.get_rows() % batch != 0) {
+
+            throw MatrixStatus("Matrix dimensions are unmatchable for the batched product.", 20);
+        }
+
+        size_t m = a.get_rows() / batch, k = a.get_columns(), n = b.get_columns();
+
+        //a single right hand matrix is shared by every product of the batch
+        bool shared = b.get_rows() == k;
+
+        if (!shared && b.get_rows() != batch * k) {
+
+            throw MatrixStatus("Matrix dimensions are unmatchable for the batched product.", 20);
+        }
+
+        Matrix result(batch * m, n);
+
+        cl_mem memory_input_a = get_memory_buffer(a.get_rows() * k * sizeof(float));
+        cl_mem memory_input_b = get_memory_buffer(b.get_rows() * n * sizeof(float));
+        cl_mem memory_output_a = get_memory_buffer(batch * m * n * sizeof(float), CL_MEM_WRITE_ONLY);
+
+        enqueue_write(memory_input_a, a);
+        enqueue_write(memory_input_b, b);
+
+        int args[5] = { (int)m, (int)n, (int)k, (int)(m * k), shared ? 0 : (int)(k * n) };
+
+        set_argument(batched_kernel_multiply, 0, (void*)&args[0]);
+        set_argument(batched_kernel_multiply, 1, (void*)&args[1]);
+        set_argument(batched_kernel_multiply, 2, (void*)&args[2]);
+        set_argument(batched_kernel_multiply, 3, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(batched_kernel_multiply, 4, (void*)&args[3]);
+        set_argument(batched_kernel_multiply, 5, (void*)&memory_input_b, sizeof(cl_mem));
+        set_argument(batched_kernel_multiply, 6, (void*)&args[4]);
+        set_argument(batched_kernel_multiply, 7, (void*)&memory_output_a, sizeof(cl_mem));
+
+        const size_t global_work_size[3] = { batch, m, n };
+        enqueue_kernel(batched_kernel_multiply, 3, global_work_size);
+
+        synchronize();
+
+        enqueue_read(memory_output_a, batch * m * n * sizeof(float), result.get_matrix());
+
+        release(memory_input_a);
+        release(memory_input_b);
+        release(memory_output_a);
+
+        return result;
+    }
+
+    Matrix transpose(Matrix a) {
+
+        TraceSpan span("transpose");
+
+        cl_int ret;
+
+        Matrix result(a.get_columns(), a.get_rows());
+
+        cl_mem memory_input_a = input_buffer(a);
+        cl_mem memory_output_a = output_buffer(result.get_matrix(), a.get_rows() * a.get_columns() * sizeof(float));
+
+        int rows = a.get_rows(), cols = a.get_columns();
+
+        set_argument(matrix_kernel_transpose, 0, (void*)&rows);
+        set_argument(matrix_kernel_transpose, 1, (void*)&cols);
+        set_argument(matrix_kernel_transpose, 2, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(matrix_kernel_transpose, 3, (void*)&memory_output_a, sizeof(cl_mem));
+
+        const size_t local_work_size[2] = { 1, 1 };
+        const size_t global_work_size[2] = { a.get_rows(), a.get_columns() };
+
+        ret = clEnqueueNDRangeKernel(queue, matrix_kernel_transpose, 2, nullptr,
+                                     global_work_size, local_work_size, 0, nullptr, profiled(matrix_kernel_transpose));
 
         if (ret != 0) {
 
-            throw MatrixStatus("Memory buffer value could not be set.", 93);
+            throw MatrixStatus("Error launching kernel.", 95);
+        }
+
+        synchronize();
+
+        finish_output(memory_output_a, result.get_matrix(), a.get_rows() * a.get_columns() * sizeof(float));
+
+        release(memory_input_a);
+        release(memory_output_a);
+        return result;
+    }
+
+    Matrix operator+(Matrix& first, Matrix const& second) {
+
+        TraceSpan span("operator+");
+
+        try {
+
+            cl_int ret;
+
+            float* output_a = nullptr, * output_b = nullptr;
+            long long int columns_highest = 0, rows_highest = 0;
+
+            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+            else {
+
+                output_a = allocate_storage<float>(rows_highest * columns_highest);
+                output_b = allocate_storage<float>(rows_highest * columns_highest);
+            }
+
+            flag = broadcast2(&first, &second, output_a, output_b, flag);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+
+            if (is_partitioned(rows_highest)) {
+
+                Matrix result = elementwise_partitioned(kernel_add, rows_highest, columns_highest, output_a, output_b);
+
+                free_storage(output_a);
+                free_storage(output_b);
+
+                return result;
+            }
+
+            Matrix result(rows_highest, columns_highest);
+
+            cl_mem memory_input_a = input_buffer(output_a, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_input_b = input_buffer(output_b, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), rows_highest * columns_highest * sizeof(float));
+
+            set_argument(kernel_add, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(kernel_add, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(kernel_add, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = rows_highest * columns_highest;
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, kernel_add, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(kernel_add));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), rows_highest * columns_highest * sizeof(float));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+
+            free_storage(output_a);
+            free_storage(output_b);
+
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Matrix operator-(Matrix& first, Matrix const& second) {
+
+        TraceSpan span("operator-");
+
+        try {
+
+            cl_int ret;
+
+            float* output_a = nullptr, * output_b = nullptr;
+            long long int columns_highest = 0, rows_highest = 0;
+
+            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+            else {
+
+                output_a = allocate_storage<float>(rows_highest * columns_highest);
+                output_b = allocate_storage<float>(rows_highest * columns_highest);
+            }
+
+            flag = broadcast2(&first, &second, output_a, output_b, flag);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+
+            if (is_partitioned(rows_highest)) {
+
+                Matrix result = elementwise_partitioned(kernel_subtract, rows_highest, columns_highest, output_a, output_b);
+
+                free_storage(output_a);
+                free_storage(output_b);
+
+                return result;
+            }
+
+            Matrix result(rows_highest, columns_highest);
+
+            cl_mem memory_input_a = input_buffer(output_a, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_input_b = input_buffer(output_b, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), rows_highest * columns_highest * sizeof(float));
+
+            set_argument(kernel_subtract, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(kernel_subtract, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(kernel_subtract, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = rows_highest * columns_highest;
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, kernel_subtract, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(kernel_subtract));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), rows_highest * columns_highest * sizeof(float));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+
+            free_storage(output_a);
+            free_storage(output_b);
+
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Matrix operator*(Matrix& first, Matrix const& second) {
+
+        TraceSpan span("operator*");
+
+        try {
+
+            cl_int ret;
+
+            float* output_a = nullptr, * output_b = nullptr;
+            long long int columns_highest = 0, rows_highest = 0;
+
+            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+            else {
+
+                output_a = allocate_storage<float>(rows_highest * columns_highest);
+                output_b = allocate_storage<float>(rows_highest * columns_highest);
+            }
+
+            flag = broadcast2(&first, &second, output_a, output_b, flag);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+
+            if (is_partitioned(rows_highest)) {
+
+                Matrix result = elementwise_partitioned(kernel_multiply, rows_highest, columns_highest, output_a, output_b);
+
+                free_storage(output_a);
+                free_storage(output_b);
+
+                return result;
+            }
+
+            Matrix result(rows_highest, columns_highest);
+
+            cl_mem memory_input_a = input_buffer(output_a, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_input_b = input_buffer(output_b, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), rows_highest * columns_highest * sizeof(float));
+
+            set_argument(kernel_multiply, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(kernel_multiply, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(kernel_multiply, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = rows_highest * columns_highest;
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, kernel_multiply, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(kernel_multiply));
+
+            if (ret != 0)
+                throw MatrixStatus("Error launching kernel.", 95);
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), rows_highest * columns_highest * sizeof(float));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+
+            free_storage(output_a);
+            free_storage(output_b);
+
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Mask operator>(Matrix& first, Matrix const& second) {
+
+        TraceSpan span("operator>");
+
+        try {
+
+            cl_int ret;
+
+            float* output_a = nullptr, * output_b = nullptr;
+            long long int columns_highest = 0, rows_highest = 0;
+
+            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+            else {
+
+                output_a = allocate_storage<float>(rows_highest * columns_highest);
+                output_b = allocate_storage<float>(rows_highest * columns_highest);
+            }
+
+            flag = broadcast2(&first, &second, output_a, output_b, flag);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+
+            Mask result(rows_highest, columns_highest);
+
+            cl_mem memory_input_a = input_buffer(output_a, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_input_b = input_buffer(output_b, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), rows_highest * columns_highest * sizeof(uint8_t));
+
+            set_argument(kernel_gt, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(kernel_gt, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(kernel_gt, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = rows_highest * columns_highest;
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, kernel_gt, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(kernel_gt));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), rows_highest * columns_highest * sizeof(uint8_t));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+
+            free_storage(output_a);
+            free_storage(output_b);
+
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Mask operator<(Matrix& first, Matrix const& second) {
+
+        TraceSpan span("operator<");
+
+        try {
+
+            cl_int ret;
+
+            float* output_a = nullptr, * output_b = nullptr;
+            long long int columns_highest = 0, rows_highest = 0;
+
+            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+            else {
+
+                output_a = allocate_storage<float>(rows_highest * columns_highest);
+                output_b = allocate_storage<float>(rows_highest * columns_highest);
+            }
+
+            flag = broadcast2(&first, &second, output_a, output_b, flag);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+
+            Mask result(rows_highest, columns_highest);
+
+            cl_mem memory_input_a = input_buffer(output_a, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_input_b = input_buffer(output_b, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), rows_highest * columns_highest * sizeof(uint8_t));
+
+            set_argument(kernel_lt, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(kernel_lt, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(kernel_lt, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = rows_highest * columns_highest;
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, kernel_lt, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(kernel_lt));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), rows_highest * columns_highest * sizeof(uint8_t));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+
+            free_storage(output_a);
+            free_storage(output_b);
+
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Mask operator==(Matrix& first, Matrix const& second) {
+
+        TraceSpan span("operator==");
+
+        try {
+
+            cl_int ret;
+
+            float* output_a = nullptr, * output_b = nullptr;
+            long long int columns_highest = 0, rows_highest = 0;
+
+            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+            else {
+
+                output_a = allocate_storage<float>(rows_highest * columns_highest);
+                output_b = allocate_storage<float>(rows_highest * columns_highest);
+            }
+
+            flag = broadcast2(&first, &second, output_a, output_b, flag);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+
+            Mask result(rows_highest, columns_highest);
+
+            cl_mem memory_input_a = input_buffer(output_a, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_input_b = input_buffer(output_b, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), rows_highest * columns_highest * sizeof(uint8_t));
+
+            set_argument(kernel_equals, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(kernel_equals, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(kernel_equals, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = rows_highest * columns_highest;
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, kernel_equals, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(kernel_equals));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), rows_highest * columns_highest * sizeof(uint8_t));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+
+            free_storage(output_a);
+            free_storage(output_b);
+
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Mask operator>=(Matrix& first, Matrix const& second) {
+
+        TraceSpan span("operator>=");
+
+        try {
+
+            cl_int ret;
+
+            float* output_a = nullptr, * output_b = nullptr;
+            long long int columns_highest = 0, rows_highest = 0;
+
+            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+            else {
+
+                output_a = allocate_storage<float>(rows_highest * columns_highest);
+                output_b = allocate_storage<float>(rows_highest * columns_highest);
+            }
+
+            flag = broadcast2(&first, &second, output_a, output_b, flag);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+
+            Mask result(rows_highest, columns_highest);
+
+            cl_mem memory_input_a = input_buffer(output_a, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_input_b = input_buffer(output_b, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), rows_highest * columns_highest * sizeof(uint8_t));
+
+            set_argument(kernel_gte, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(kernel_gte, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(kernel_gte, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = rows_highest * columns_highest;
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, kernel_gte, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(kernel_gte));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), rows_highest * columns_highest * sizeof(uint8_t));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+
+            free_storage(output_a);
+            free_storage(output_b);
+
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Mask operator<=(Matrix& first, Matrix const& second) {
+
+        TraceSpan span("operator<=");
+
+        try {
+
+            cl_int ret;
+
+            float* output_a = nullptr, * output_b = nullptr;
+            long long int columns_highest = 0, rows_highest = 0;
+
+            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+            else {
+
+                output_a = allocate_storage<float>(rows_highest * columns_highest);
+                output_b = allocate_storage<float>(rows_highest * columns_highest);
+            }
+
+            flag = broadcast2(&first, &second, output_a, output_b, flag);
+
+            if (flag == 0) {
+
+                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            }
+
+            Mask result(rows_highest, columns_highest);
+
+            cl_mem memory_input_a = input_buffer(output_a, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_input_b = input_buffer(output_b, rows_highest * columns_highest * sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), rows_highest * columns_highest * sizeof(uint8_t));
+
+            set_argument(kernel_lte, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(kernel_lte, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(kernel_lte, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = rows_highest * columns_highest;
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, kernel_lte, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(kernel_lte));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), rows_highest * columns_highest * sizeof(uint8_t));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+
+            free_storage(output_a);
+            free_storage(output_b);
+
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+//Scalar Operations
+
+    Matrix operator*(Matrix& first, float const& second) {
+
+        TraceSpan span("operator* (scalar)");
+
+        try {
+
+            cl_int ret;
+
+            Matrix result(first.get_rows(), first.get_columns());
+
+            cl_mem memory_input_a = input_buffer(first);
+
+            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), first.get_rows() * first.get_columns() * sizeof(float));
+            enqueue_write(memory_input_b, second);
+
+            set_argument(scalar_kernel_multiply, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(scalar_kernel_multiply, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(scalar_kernel_multiply, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = first.get_columns() * first.get_rows();
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_multiply, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr,
+                                         profiled(scalar_kernel_multiply));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), first.get_columns() * first.get_rows() * sizeof(float));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Mask operator>(Matrix& first, float const& second) {
+
+        TraceSpan span("operator> (scalar)");
+
+        try {
+
+            cl_int ret;
+
+            Mask result(first.get_rows(), first.get_columns());
+
+            cl_mem memory_input_a = input_buffer(first);
+
+            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), first.get_rows() * first.get_columns() * sizeof(uint8_t));
+            enqueue_write(memory_input_b, second);
+
+            set_argument(scalar_kernel_gt, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(scalar_kernel_gt, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(scalar_kernel_gt, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = first.get_columns() * first.get_rows();
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_gt, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(scalar_kernel_gt));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), first.get_columns() * first.get_rows() * sizeof(uint8_t));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Mask operator<(Matrix& first, float const& second) {
+
+        TraceSpan span("operator< (scalar)");
+
+        try {
+
+            cl_int ret;
+
+            Mask result(first.get_rows(), first.get_columns());
+
+            cl_mem memory_input_a = input_buffer(first);
+
+            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), first.get_rows() * first.get_columns() * sizeof(uint8_t));
+            enqueue_write(memory_input_b, second);
+
+            set_argument(scalar_kernel_lt, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(scalar_kernel_lt, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(scalar_kernel_lt, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = first.get_columns() * first.get_rows();
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_lt, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(scalar_kernel_lt));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), first.get_columns() * first.get_rows() * sizeof(uint8_t));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Mask operator==(Matrix& first, float const& second) {
+
+        TraceSpan span("operator== (scalar)");
+
+        try {
+
+            cl_int ret;
+
+            Mask result(first.get_rows(), first.get_columns());
+
+            cl_mem memory_input_a = input_buffer(first);
+
+            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), first.get_rows() * first.get_columns() * sizeof(uint8_t));
+            enqueue_write(memory_input_b, second);
+
+            set_argument(scalar_kernel_equals, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(scalar_kernel_equals, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(scalar_kernel_equals, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = first.get_columns() * first.get_rows();
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_equals, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr,
+                                         profiled(scalar_kernel_equals));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), first.get_columns() * first.get_rows() * sizeof(uint8_t));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Mask operator>=(Matrix& first, float const& second) {
+
+        TraceSpan span("operator>= (scalar)");
+
+        try {
+
+            cl_int ret;
+
+            Mask result(first.get_rows(), first.get_columns());
+
+            cl_mem memory_input_a = input_buffer(first);
+
+            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), first.get_rows() * first.get_columns() * sizeof(uint8_t));
+            enqueue_write(memory_input_b, second);
+
+            set_argument(scalar_kernel_gte, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(scalar_kernel_gte, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(scalar_kernel_gte, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = first.get_columns() * first.get_rows();
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_gte, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(scalar_kernel_gte));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), first.get_columns() * first.get_rows() * sizeof(uint8_t));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Mask operator<=(Matrix& first, float const& second) {
+
+        TraceSpan span("operator<= (scalar)");
+
+        try {
+
+            cl_int ret;
+
+            Mask result(first.get_rows(), first.get_columns());
+
+            cl_mem memory_input_a = input_buffer(first);
+
+            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), first.get_rows() * first.get_columns() * sizeof(uint8_t));
+            enqueue_write(memory_input_b, second);
+
+            set_argument(scalar_kernel_lte, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(scalar_kernel_lte, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(scalar_kernel_lte, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = first.get_columns() * first.get_rows();
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_lte, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr, profiled(scalar_kernel_lte));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), first.get_columns() * first.get_rows() * sizeof(uint8_t));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Matrix operator^(Matrix& first, float const& second) {
+
+        TraceSpan span("operator^ (scalar)");
+
+        try {
+
+            cl_int ret;
+
+            Matrix result(first.get_rows(), first.get_columns());
+
+            cl_mem memory_input_a = input_buffer(first);
+
+            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), first.get_rows() * first.get_columns() * sizeof(float));
+            enqueue_write(memory_input_b, second);
+
+            set_argument(scalar_kernel_power, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(scalar_kernel_power, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(scalar_kernel_power, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = first.get_columns() * first.get_rows();
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_power, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr,
+                                         profiled(scalar_kernel_power));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), first.get_columns() * first.get_rows() * sizeof(float));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Matrix operator+(Matrix& first, float const& second) {
+
+        TraceSpan span("operator+ (scalar)");
+
+        try {
+
+            cl_int ret;
+
+            Matrix result(first.get_rows(), first.get_columns());
+
+            cl_mem memory_input_a = input_buffer(first);
+            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
+            cl_mem memory_input_c = get_memory_buffer(sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), first.get_rows() * first.get_columns() * sizeof(float));
+
+            float num_columns = first.get_columns();
+            enqueue_write(memory_input_b, second);
+            enqueue_write(memory_input_c, num_columns);
+
+            set_argument(scalar_kernel_adder, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(scalar_kernel_adder, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(scalar_kernel_adder, 2, (void*)&memory_input_c, sizeof(cl_mem));
+            set_argument(scalar_kernel_adder, 3, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = first.get_columns() * first.get_rows();
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_adder, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr,
+                                         profiled(scalar_kernel_adder));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), first.get_columns() * first.get_rows() * sizeof(float));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    Matrix operator-(Matrix& first, float const& second) {
+
+        TraceSpan span("operator- (scalar)");
+
+        try {
+
+            cl_int ret;
+
+            Matrix result(first.get_rows(), first.get_columns());
+
+            cl_mem memory_input_a = input_buffer(first);
+            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
+            cl_mem memory_input_c = get_memory_buffer(sizeof(float));
+            cl_mem memory_output_a = output_buffer(result.get_matrix(), first.get_rows() * first.get_columns() * sizeof(float));
+
+            float num_columns = first.get_columns();
+            enqueue_write(memory_input_b, second);
+            enqueue_write(memory_input_c, num_columns);
+
+            set_argument(scalar_kernel_subtracter, 0, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(scalar_kernel_subtracter, 1, (void*)&memory_input_b, sizeof(cl_mem));
+            set_argument(scalar_kernel_subtracter, 2, (void*)&memory_input_c, sizeof(cl_mem));
+            set_argument(scalar_kernel_subtracter, 3, (void*)&memory_output_a, sizeof(cl_mem));
+
+            size_t global_work_size = first.get_columns() * first.get_rows();
+            size_t local_work_size = 1;
+
+            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_subtracter, 1, nullptr,
+                                         &global_work_size, &local_work_size, 0, nullptr,
+                                         profiled(scalar_kernel_subtracter));
+
+            if (ret != 0) {
+
+                throw MatrixStatus("Error launching kernel.", 95);
+            }
+
+            synchronize();
+
+            finish_output(memory_output_a, result.get_matrix(), first.get_columns() * first.get_rows() * sizeof(float));
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_output_a);
+            return result;
+        }
+        catch (MatrixStatus& status) {
+
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
+
+    //returns the workspace buffer of `slot`, growing it when it is smaller than `size`
+    cl_mem workspace(int slot, size_t size) {
+
+        if (workspace_sizes[slot] < size) {
+
+            if (workspace_buffers[slot] != nullptr)
+                release(workspace_buffers[slot]);
+
+            workspace_buffers[slot] = get_memory_buffer(size, CL_MEM_READ_WRITE);
+            workspace_sizes[slot] = size;
+        }
+
+        return workspace_buffers[slot];
+    }
+
+    //runs a binary element-wise kernel on a and the `second_size` floats at `second`, writing into the storage of out
+    //a matrix operand comes as second_matrix instead, so a view of it is packed on the way to the device
+    void elementwise_into(cl_kernel kernel, Matrix a, const float* second, size_t second_size, Matrix& out,
+                          const Matrix* second_matrix = nullptr) {
+
+        if (out.get_rows() != a.get_rows() || out.get_columns() != a.get_columns()) {
+
+            throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+        }
+
+        size_t size = a.get_rows() * a.get_columns();
+
+        if (size == 0)
+            return;
+
+        cl_mem memory_input_a = workspace(0, size * sizeof(float));
+        cl_mem memory_input_b = workspace(1, second_size * sizeof(float));
+        cl_mem memory_output_a = workspace(2, size * sizeof(float));
+
+        enqueue_write(memory_input_a, a);
+
+        if (second_matrix != nullptr)
+            enqueue_write(memory_input_b, *second_matrix);
+        else
+            enqueue_write(memory_input_b, second_size * sizeof(float), second);
+
+        set_argument(kernel, 0, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(kernel, 1, (void*)&memory_input_b, sizeof(cl_mem));
+        set_argument(kernel, 2, (void*)&memory_output_a, sizeof(cl_mem));
+
+        enqueue_kernel(kernel, 1, &size);
+
+        synchronize();
+
+        read_view(memory_output_a, out);
+    }
+
+    void elementwise_into(cl_kernel kernel, Matrix a, Matrix b, Matrix& out) {
+
+        if (b.get_rows() != a.get_rows() || b.get_columns() != a.get_columns()) {
+
+            throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+        }
+
+        elementwise_into(kernel, a, nullptr, b.get_rows() * b.get_columns(), out, &b);
+    }
+
+    void add(Matrix a, Matrix b, Matrix& out) {
+
+        TraceSpan span("add");
+
+        elementwise_into(kernel_add, a, b, out);
+    }
+
+    void subtract(Matrix a, Matrix b, Matrix& out) {
+
+        TraceSpan span("subtract");
+
+        elementwise_into(kernel_subtract, a, b, out);
+    }
+
+    void multiply(Matrix a, Matrix b, Matrix& out) {
+
+        TraceSpan span("multiply");
+
+        elementwise_into(kernel_multiply, a, b, out);
+    }
+
+    void multiply(Matrix a, float b, Matrix& out) {
+
+        TraceSpan span("multiply (scalar)");
+
+        elementwise_into(scalar_kernel_multiply, a, &b, 1, out);
+    }
+
+    void power(Matrix a, float b, Matrix& out) {
+
+        TraceSpan span("power (scalar)");
+
+        elementwise_into(scalar_kernel_power, a, &b, 1, out);
+    }
+
+    Matrix& operator+=(Matrix& first, Matrix const& second) {
+
+        TraceSpan span("operator+=");
+
+        add(first, second, first);
+        return first;
+    }
+
+    Matrix& operator-=(Matrix& first, Matrix const& second) {
+
+        TraceSpan span("operator-=");
+
+        subtract(first, second, first);
+        return first;
+    }
+
+    Matrix& operator*=(Matrix& first, Matrix const& second) {
+
+        TraceSpan span("operator*=");
+
+        multiply(first, second, first);
+        return first;
+    }
+
+    Matrix& operator*=(Matrix& first, float const& second) {
+
+        TraceSpan span("operator*= (scalar)");
+
+        multiply(first, second, first);
+        return first;
+    }
+
+    Matrix& operator^=(Matrix& first, float const& second) {
+
+        TraceSpan span("operator^= (scalar)");
+
+        power(first, second, first);
+        return first;
+    }
+
+    //C += alpha * A * B, where A, B and C are (m x k), (k x n) and (m x n) blocks inside larger row-major buffers
+    void block_update(size_t m, size_t n, size_t k, float alpha, cl_mem a, size_t offset_a, size_t lda, cl_mem b,
+                      size_t offset_b, size_t ldb, cl_mem c, size_t offset_c, size_t ldc) {
+
+        if (m == 0 || n == 0 || k == 0)
+            return;
+
+        int args[9] = { (int)m, (int)n, (int)k, (int)offset_a, (int)lda, (int)offset_b, (int)ldb, (int)offset_c, (int)ldc };
+
+        set_argument(block_kernel_update, 0, (void*)&args[0]);
+        set_argument(block_kernel_update, 1, (void*)&args[1]);
+        set_argument(block_kernel_update, 2, (void*)&args[2]);
+        set_argument(block_kernel_update, 3, (void*)&a, sizeof(cl_mem));
+        set_argument(block_kernel_update, 4, (void*)&args[3]);
+        set_argument(block_kernel_update, 5, (void*)&args[4]);
+        set_argument(block_kernel_update, 6, (void*)&b, sizeof(cl_mem));
+        set_argument(block_kernel_update, 7, (void*)&args[5]);
+        set_argument(block_kernel_update, 8, (void*)&args[6]);
+        set_argument(block_kernel_update, 9, (void*)&c, sizeof(cl_mem));
+        set_argument(block_kernel_update, 10, (void*)&args[7]);
+        set_argument(block_kernel_update, 11, (void*)&args[8]);
+        set_argument(block_kernel_update, 12, (void*)&alpha, sizeof(float));
+
+        const size_t global_work_size[2] = { m, n };
+        enqueue_kernel(block_kernel_update, 2, global_work_size);
+    }
+
+    //writes the transpose of the (rows x columns) matrix in `input` to `output`
+    void transpose_block(cl_mem input, cl_mem output, size_t rows, size_t columns) {
+
+        if (rows == 0 || columns == 0)
+            return;
+
+        int args[2] = { (int)rows, (int)columns };
+
+        set_argument(matrix_kernel_transpose, 0, (void*)&args[0]);
+        set_argument(matrix_kernel_transpose, 1, (void*)&args[1]);
+        set_argument(matrix_kernel_transpose, 2, (void*)&input, sizeof(cl_mem));
+        set_argument(matrix_kernel_transpose, 3, (void*)&output, sizeof(cl_mem));
+
+        const size_t global_work_size[2] = { rows, columns };
+        enqueue_kernel(matrix_kernel_transpose, 2, global_work_size);
+    }
+
+
+    //applies the interchanges pivots[start, start + count) to the rows of a buffer with `columns` columns
+    //columns [skip_start, skip_start + skip_count) are left untouched
+    void swap_rows(cl_mem buffer, size_t columns, size_t start, size_t count, size_t skip_start, size_t skip_count,
+                   cl_mem pivot_buffer) {
+
+        int args[5] = { (int)columns, (int)start, (int)count, (int)skip_start, (int)skip_count };
+
+        set_argument(block_kernel_swap_rows, 0, (void*)&args[0]);
+        set_argument(block_kernel_swap_rows, 1, (void*)&args[1]);
+        set_argument(block_kernel_swap_rows, 2, (void*)&args[2]);
+        set_argument(block_kernel_swap_rows, 3, (void*)&args[3]);
+        set_argument(block_kernel_swap_rows, 4, (void*)&args[4]);
+        set_argument(block_kernel_swap_rows, 5, (void*)&pivot_buffer, sizeof(cl_mem));
+        set_argument(block_kernel_swap_rows, 6, (void*)&buffer, sizeof(cl_mem));
+
+        const size_t global_work_size = columns;
+        enqueue_kernel(block_kernel_swap_rows, 1, &global_work_size);
+    }
+
+    //solves T * X = B in place for the (k x n) block B, where T is the (k x k) triangular block at offset_t
+    //unit: the diagonal of T is taken to be all 1s
+    void triangular_solve(cl_kernel kernel, size_t n, size_t k, bool unit, cl_mem t, size_t offset_t, size_t ldt,
+                          cl_mem b, size_t offset_b, size_t ldb) {
+
+        if (n == 0 || k == 0)
+            return;
+
+        int args[7] = { (int)n, (int)k, unit ? 1 : 0, (int)offset_t, (int)ldt, (int)offset_b, (int)ldb };
+
+        set_argument(kernel, 0, (void*)&args[0]);
+        set_argument(kernel, 1, (void*)&args[1]);
+        set_argument(kernel, 2, (void*)&args[2]);
+        set_argument(kernel, 3, (void*)&t, sizeof(cl_mem));
+        set_argument(kernel, 4, (void*)&args[3]);
+        set_argument(kernel, 5, (void*)&args[4]);
+        set_argument(kernel, 6, (void*)&b, sizeof(cl_mem));
+        set_argument(kernel, 7, (void*)&args[5]);
+        set_argument(kernel, 8, (void*)&args[6]);
+
+        const size_t global_work_size = n;
+        enqueue_kernel(kernel, 1, &global_work_size);
+    }
+
+    //Blocked right-looking LU decomposition with partial pivoting of the (n x n) matrix held in `buffer`.
+    //Each panel is factored on the host, the row interchanges, the U12 solve and the trailing update run on the device.
+    //Returns false if the matrix is singular. determinant (if not null) receives det(A).
+    bool lu_factorize(cl_mem buffer, size_t n, cl_mem pivot_buffer, std::vector<int>& pivots, double* determinant) {
+
+        bool singular = false;
+        double product = 1.0;
+
+        std::vector<float> panel;
+        pivots.assign(n, 0);
+
+        for (size_t k0 = 0; k0 < n; k0 += linalg_block_size) {
+
+            size_t kb = std::min(linalg_block_size, n - k0);
+            size_t height = n - k0;
+
+            panel.resize(height * kb);
+            enqueue_read_block(buffer, n, k0, k0, height, kb, panel.data());
+
+            for (size_t j = 0; j < kb; j++) {
+
+                size_t pivot = j;
+
+                for (size_t i = j + 1; i < height; i++) {
+
+                    if (fabs(panel[i * kb + j]) > fabs(panel[pivot * kb + j]))
+                        pivot = i;
+                }
+
+                pivots[k0 + j] = (int)(k0 + pivot);
+
+                if (pivot != j) {
+
+                    std::swap_ranges(panel.begin() + j * kb, panel.begin() + (j + 1) * kb, panel.begin() + pivot * kb);
+                    product = -product;
+                }
+
+                float diagonal = panel[j * kb + j];
+                product *= diagonal;
+
+                if (diagonal == 0.0f) {
+
+                    singular = true;
+                    continue;
+                }
+
+                for (size_t i = j + 1; i < height; i++) {
+
+                    float factor = panel[i * kb + j] / diagonal;
+                    panel[i * kb + j] = factor;
+
+                    for (size_t c = j + 1; c < kb; c++)
+                        panel[i * kb + c] -= factor * panel[j * kb + c];
+                }
+            }
+
+            enqueue_write_block(buffer, n, k0, k0, height, kb, panel.data());
+            enqueue_write(pivot_buffer, n * sizeof(int), pivots.data());
+
+            swap_rows(buffer, n, k0, kb, k0, kb, pivot_buffer);
+
+            if (k0 + kb < n) {
+
+                size_t rest = n - k0 - kb;
+
+                triangular_solve(block_kernel_lower_solve, rest, kb, true, buffer, k0 * n + k0, n,
+                                 buffer, k0 * n + k0 + kb, n);
+                block_update(rest, rest, kb, -1.0f, buffer, (k0 + kb) * n + k0, n, buffer, k0 * n + k0 + kb, n,
+                             buffer, (k0 + kb) * n + k0 + kb, n);
+            }
+        }
+
+        synchronize();
+
+        if (determinant != nullptr)
+            *determinant = product;
+
+        return !singular;
+    }
+
+    //blocked forward substitution: overwrites the (n x columns) block `rhs` with L^-1 * rhs
+    void forward_substitute(cl_mem factors, size_t n, cl_mem rhs, size_t columns, bool unit) {
+
+        for (size_t k0 = 0; k0 < n; k0 += linalg_block_size) {
+
+            size_t kb = std::min(linalg_block_size, n - k0);
+
+            triangular_solve(block_kernel_lower_solve, columns, kb, unit, factors, k0 * n + k0, n,
+                             rhs, k0 * columns, columns);
+            block_update(n - k0 - kb, columns, kb, -1.0f, factors, (k0 + kb) * n + k0, n,
+                         rhs, k0 * columns, columns, rhs, (k0 + kb) * columns, columns);
+        }
+    }
+
+    //blocked back substitution: overwrites the (n x columns) block `rhs` with U^-1 * rhs
+    void backward_substitute(cl_mem factors, size_t n, cl_mem rhs, size_t columns) {
+
+        if (n == 0)
+            return;
+
+        for (size_t k0 = ((n - 1) / linalg_block_size) * linalg_block_size; ; k0 -= linalg_block_size) {
+
+            size_t kb = std::min(linalg_block_size, n - k0);
+
+            triangular_solve(block_kernel_upper_solve, columns, kb, false, factors, k0 * n + k0, n,
+                             rhs, k0 * columns, columns);
+            block_update(k0, columns, kb, -1.0f, factors, k0, n, rhs, k0 * columns, columns, rhs, 0, columns);
+
+            if (k0 == 0)
+                break;
+        }
+    }
+
+    //overwrites the (n x columns) right hand sides in `rhs` with the solution of A * X = B, given the LU factors of A
+    void lu_substitute(cl_mem factors, size_t n, cl_mem pivot_buffer, cl_mem rhs, size_t columns) {
+
+        if (n == 0)
+            return;
+
+        swap_rows(rhs, columns, 0, n, 0, 0, pivot_buffer);
+
+        forward_substitute(factors, n, rhs, columns, true);
+        backward_substitute(factors, n, rhs, columns);
+
+        synchronize();
+    }
+
+    Matrix lu(Matrix a, std::vector<int>& pivots) {
+
+        TraceSpan span("lu");
+
+        if (a.get_rows() != a.get_columns()) {
+
+            throw MatrixStatus("Square matrix required.", 11);
+        }
+
+        size_t n = a.get_rows();
+
+        Matrix result(n, n);
+
+        cl_mem memory_input_a = get_memory_buffer(n * n * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_pivots = get_memory_buffer(n * sizeof(int));
+
+        enqueue_write(memory_input_a, a);
+
+        lu_factorize(memory_input_a, n, memory_pivots, pivots, nullptr);
+
+        enqueue_read(memory_input_a, n * n * sizeof(float), result.get_matrix());
+
+        release(memory_input_a);
+        release(memory_pivots);
+
+        return result;
+    }
+
+    Matrix solve(Matrix a, Matrix b) {
+
+        TraceSpan span("solve");
+
+        if (a.get_rows() != a.get_columns()) {
+
+            throw MatrixStatus("Square matrix required.", 11);
+        }
+
+        if (a.get_rows() != b.get_rows()) {
+
+            throw MatrixStatus("Matrix dimensions are unmatchable for the linear solve.", 13);
+        }
+
+        size_t n = a.get_rows(), columns = b.get_columns();
+        std::vector<int> pivots;
+
+        Matrix result(n, columns);
+
+        cl_mem memory_input_a = get_memory_buffer(n * n * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_input_b = get_memory_buffer(n * columns * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_pivots = get_memory_buffer(n * sizeof(int));
+
+        enqueue_write(memory_input_a, a);
+        enqueue_write(memory_input_b, b);
+
+        if (!lu_factorize(memory_input_a, n, memory_pivots, pivots, nullptr)) {
+
+            release(memory_input_a);
+            release(memory_input_b);
+            release(memory_pivots);
+
+            throw MatrixStatus("Matrix is singular.", 12);
+        }
+
+        lu_substitute(memory_input_a, n, memory_pivots, memory_input_b, columns);
+
+        enqueue_read(memory_input_b, n * columns * sizeof(float), result.get_matrix());
+
+        release(memory_input_a);
+        release(memory_input_b);
+        release(memory_pivots);
+
+        return result;
+    }
+
+    float det(Matrix a) {
+
+        TraceSpan span("det");
+
+        if (a.get_rows() != a.get_columns()) {
+
+            throw MatrixStatus("Square matrix required.", 11);
+        }
+
+        size_t n = a.get_rows();
+        std::vector<int> pivots;
+        double determinant = 1.0;
+
+        cl_mem memory_input_a = get_memory_buffer(n * n * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_pivots = get_memory_buffer(n * sizeof(int));
+
+        enqueue_write(memory_input_a, a);
+
+        lu_factorize(memory_input_a, n, memory_pivots, pivots, &determinant);
+
+        release(memory_input_a);
+        release(memory_pivots);
+
+        return (float)determinant;
+    }
+
+    Matrix inverse(Matrix a) {
+
+        TraceSpan span("inverse");
+
+        Matrix identity_matrix(a.get_rows(), a.get_rows());
+        identity_matrix.clean_up();
+        identity_matrix.identity(1);
+
+        Matrix result = solve(a, identity_matrix);
+
+        identity_matrix.clean_up();
+
+        return result;
+    }
+
+    //Blocked right-looking Cholesky decomposition A = L * L^T of the (n x n) matrix held in `buffer`, in place.
+    //Diagonal blocks are factored on the host, the L21 solve and the Schur complement update run on the device.
+    //Only the lower triangle is read and written. Returns false if the matrix is not positive definite.
+    bool cholesky_factorize(cl_mem buffer, size_t n) {
+
+        std::vector<float> block;
+
+        for (size_t k0 = 0; k0 < n; k0 += linalg_block_size) {
+
+            size_t kb = std::min(linalg_block_size, n - k0);
+
+            block.resize(kb * kb);
+            enqueue_read_block(buffer, n, k0, k0, kb, kb, block.data());
+
+            for (size_t j = 0; j < kb; j++) {
+
+                float diagonal = block[j * kb + j];
+
+                for (size_t p = 0; p < j; p++)
+                    diagonal -= block[j * kb + p] * block[j * kb + p];
+
+                if (!(diagonal > 0.0f))
+                    return false;
+
+                diagonal = sqrtf(diagonal);
+                block[j * kb + j] = diagonal;
+
+                for (size_t i = j + 1; i < kb; i++) {
+
+                    float sum = block[i * kb + j];
+
+                    for (size_t p = 0; p < j; p++)
+                        sum -= block[i * kb + p] * block[j * kb + p];
+
+                    block[i * kb + j] = sum / diagonal;
+                }
+            }
+
+            enqueue_write_block(buffer, n, k0, k0, kb, kb, block.data());
+
+            if (k0 + kb < n) {
+
+                int rest = (int)(n - k0 - kb), width = (int)kb, ld = (int)n;
+                int offset_diagonal = (int)(k0 * n + k0), offset_panel = (int)((k0 + kb) * n + k0);
+                int offset_trailing = (int)((k0 + kb) * n + k0 + kb);
+
+                set_argument(block_kernel_right_lower_solve, 0, (void*)&rest);
+                set_argument(block_kernel_right_lower_solve, 1, (void*)&width);
+                set_argument(block_kernel_right_lower_solve, 2, (void*)&buffer, sizeof(cl_mem));
+                set_argument(block_kernel_right_lower_solve, 3, (void*)&offset_diagonal);
+                set_argument(block_kernel_right_lower_solve, 4, (void*)&ld);
+                set_argument(block_kernel_right_lower_solve, 5, (void*)&buffer, sizeof(cl_mem));
+                set_argument(block_kernel_right_lower_solve, 6, (void*)&offset_panel);
+                set_argument(block_kernel_right_lower_solve, 7, (void*)&ld);
+
+                const size_t solve_work_size = rest;
+                enqueue_kernel(block_kernel_right_lower_solve, 1, &solve_work_size);
+
+                set_argument(block_kernel_symmetric_update, 0, (void*)&rest);
+                set_argument(block_kernel_symmetric_update, 1, (void*)&width);
+                set_argument(block_kernel_symmetric_update, 2, (void*)&buffer, sizeof(cl_mem));
+                set_argument(block_kernel_symmetric_update, 3, (void*)&offset_panel);
+                set_argument(block_kernel_symmetric_update, 4, (void*)&ld);
+                set_argument(block_kernel_symmetric_update, 5, (void*)&buffer, sizeof(cl_mem));
+                set_argument(block_kernel_symmetric_update, 6, (void*)&offset_trailing);
+                set_argument(block_kernel_symmetric_update, 7, (void*)&ld);
+
+                const size_t update_work_size[2] = { (size_t)rest, (size_t)rest };
+                enqueue_kernel(block_kernel_symmetric_update, 2, update_work_size);
+            }
+        }
+
+        synchronize();
+
+        return true;
+    }
+
+    Matrix cholesky(Matrix a) {
+
+        TraceSpan span("cholesky");
+
+        if (a.get_rows() != a.get_columns()) {
+
+            throw MatrixStatus("Square matrix required.", 11);
+        }
+
+        size_t n = a.get_rows();
+
+        Matrix result(n, n);
+
+        cl_mem memory_input_a = get_memory_buffer(n * n * sizeof(float), CL_MEM_READ_WRITE);
+
+        enqueue_write(memory_input_a, a);
+
+        if (!cholesky_factorize(memory_input_a, n)) {
+
+            release(memory_input_a);
+
+            throw MatrixStatus("Matrix is not positive definite.", 14);
+        }
+
+        enqueue_read(memory_input_a, n * n * sizeof(float), result.get_matrix());
+
+        release(memory_input_a);
+
+        //the strictly upper triangle still holds the input
+        for (size_t i = 0; i < n; i++) {
+
+            for (size_t j = i + 1; j < n; j++) {
+
+                result.set_element(i, j, 0);
+            }
+        }
+
+        return result;
+    }
+
+    Matrix cho_solve(Matrix l, Matrix b) {
+
+        TraceSpan span("cho_solve");
+
+        if (l.get_rows() != l.get_columns()) {
+
+            throw MatrixStatus("Square matrix required.", 11);
+        }
+
+        if (l.get_rows() != b.get_rows()) {
+
+            throw MatrixStatus("Matrix dimensions are unmatchable for the linear solve.", 13);
+        }
+
+        size_t n = l.get_rows(), columns = b.get_columns();
+
+        Matrix result(n, columns);
+
+        cl_mem memory_input_l = get_memory_buffer(n * n * sizeof(float));
+        cl_mem memory_input_u = get_memory_buffer(n * n * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_input_b = get_memory_buffer(n * columns * sizeof(float), CL_MEM_READ_WRITE);
+
+        enqueue_write(memory_input_l, l);
+        enqueue_write(memory_input_b, b);
+
+        //L^T is formed on the device so both substitutions can walk row-major triangles
+        transpose_block(memory_input_l, memory_input_u, n, n);
+
+        forward_substitute(memory_input_l, n, memory_input_b, columns, false);
+        backward_substitute(memory_input_u, n, memory_input_b, columns);
+
+        synchronize();
+
+        enqueue_read(memory_input_b, n * columns * sizeof(float), result.get_matrix());
+
+        release(memory_input_l);
+        release(memory_input_u);
+        release(memory_input_b);
+
+        return result;
+    }
+
+    //One panel of Householder reflectors in compact WY form, H = H1 * H2 * ... = I - V * T * V^T
+    struct BlockReflector {
+
+        //first row of the matrix the panel acts on
+        size_t offset;
+
+        size_t height;
+
+        size_t width;
+
+        //(height x width) unit lower trapezoidal matrix of Householder vectors
+        std::vector<float> v;
+
+        //(width x width) upper triangular factor
+        std::vector<float> t;
+    };
+
+    //builds T from the Householder vectors in V and their scalar factors: T[0:j, j] = -tau_j * T[0:j, 0:j] * V^T * v_j
+    void form_triangular_factor(BlockReflector& reflector, const std::vector<float>& taus) {
+
+        size_t height = reflector.height, width = reflector.width;
+
+        reflector.t.assign(width * width, 0.0f);
+
+        for (size_t j = 0; j < width; j++) {
+
+            reflector.t[j * width + j] = taus[j];
+
+            for (size_t p = 0; p < j; p++) {
+
+                float dot = 0.0f;
+
+                for (size_t i = j; i < height; i++)
+                    dot += reflector.v[i * width + p] * reflector.v[i * width + j];
+
+                for (size_t i = 0; i <= p; i++)
+                    reflector.t[i * width + j] -= taus[j] * reflector.t[i * width + p] * dot;
+            }
+        }
+    }
+
+    //target[row:row + height, column:column + columns] = H^T * target (transpose) or H * target (otherwise)
+    //Both products are GEMMs: W = Z * target with Z = T^T * V^T (or T * V^T), then target -= V * W
+    void apply_block_reflector(cl_mem target, size_t ld, size_t row, size_t column, size_t columns,
+                               const BlockReflector& reflector, bool transpose) {
+
+        if (columns == 0)
+            return;
+
+        size_t height = reflector.height, width = reflector.width;
+
+        std::vector<float> z(width * height, 0.0f);
+
+        for (size_t a = 0; a < width; a++) {
+
+            for (size_t b = 0; b < width; b++) {
+
+                float factor = transpose ? reflector.t[b * width + a] : reflector.t[a * width + b];
+
+                if (factor == 0.0f)
+                    continue;
+
+                for (size_t i = 0; i < height; i++)
+                    z[a * height + i] += factor * reflector.v[i * width + b];
+            }
+        }
+
+        cl_mem memory_v = get_memory_buffer(height * width * sizeof(float));
+        cl_mem memory_z = get_memory_buffer(width * height * sizeof(float));
+        cl_mem memory_w = get_memory_buffer(width * columns * sizeof(float), CL_MEM_READ_WRITE);
+
+        enqueue_write(memory_v, height * width * sizeof(float), (float*)reflector.v.data());
+        enqueue_write(memory_z, width * height * sizeof(float), z.data());
+        enqueue_fill(memory_w, width * columns * sizeof(float), 0.0f);
+
+        block_update(width, columns, height, 1.0f, memory_z, 0, height, target, row * ld + column, ld,
+                     memory_w, 0, columns);
+        block_update(height, columns, width, -1.0f, memory_v, 0, width, memory_w, 0, columns,
+                     target, row * ld + column, ld);
+
+        synchronize();
+
+        release(memory_v);
+        release(memory_z);
+        release(memory_w);
+    }
+
+    //Blocked Householder QR decomposition of the (m x n) matrix held in `buffer`, in place.
+    //R ends up on and above the diagonal and the Householder vectors below it, as in LAPACK's geqrf.
+    //Panels are factored on the host, the trailing columns are updated on the device with the WY form.
+    //Returns false if a diagonal element of R is zero.
+    bool qr_factorize(cl_mem buffer, size_t m, size_t n, std::vector<BlockReflector>& reflectors) {
+
+        bool full_rank = true;
+        size_t k = std::min(m, n);
+
+        std::vector<float> panel, taus(linalg_block_size);
+        reflectors.clear();
+
+        for (size_t k0 = 0; k0 < k; k0 += linalg_block_size) {
+
+            size_t kb = std::min(linalg_block_size, k - k0);
+            size_t height = m - k0;
+
+            BlockReflector reflector;
+            reflector.offset = k0;
+            reflector.height = height;
+            reflector.width = kb;
+            reflector.v.assign(height * kb, 0.0f);
+
+            panel.resize(height * kb);
+            enqueue_read_block(buffer, n, k0, k0, height, kb, panel.data());
+
+            for (size_t j = 0; j < kb; j++) {
+
+                float alpha = panel[j * kb + j], sigma = 0.0f, tau = 0.0f;
+
+                for (size_t i = j + 1; i < height; i++)
+                    sigma += panel[i * kb + j] * panel[i * kb + j];
+
+                if (sigma != 0.0f) {
+
+                    float norm = sqrtf(alpha * alpha + sigma);
+                    float beta = alpha <= 0.0f ? norm : -norm;
+                    float scale = 1.0f / (alpha - beta);
+
+                    tau = (beta - alpha) / beta;
+
+                    for (size_t i = j + 1; i < height; i++)
+                        panel[i * kb + j] *= scale;
+
+                    panel[j * kb + j] = beta;
+
+                    for (size_t c = j + 1; c < kb; c++) {
+
+                        float w = panel[j * kb + c];
+
+                        for (size_t i = j + 1; i < height; i++)
+                            w += panel[i * kb + j] * panel[i * kb + c];
+
+                        panel[j * kb + c] -= tau * w;
+
+                        for (size_t i = j + 1; i < height; i++)
+                            panel[i * kb + c] -= tau * panel[i * kb + j] * w;
+                    }
+                }
+
+                if (panel[j * kb + j] == 0.0f)
+                    full_rank = false;
+
+                reflector.v[j * kb + j] = 1.0f;
+
+                for (size_t i = j + 1; i < height; i++)
+                    reflector.v[i * kb + j] = panel[i * kb + j];
+
+                taus[j] = tau;
+            }
+
+            form_triangular_factor(reflector, taus);
+
+            enqueue_write_block(buffer, n, k0, k0, height, kb, panel.data());
+
+            apply_block_reflector(buffer, n, k0, k0 + kb, n - k0 - kb, reflector, true);
+
+            reflectors.push_back(reflector);
+        }
+
+        return full_rank;
+    }
+
+    void qr(Matrix a, Matrix& q, Matrix& r) {
+
+        TraceSpan span("qr");
+
+        size_t m = a.get_rows(), n = a.get_columns(), k = std::min(m, n);
+        std::vector<BlockReflector> reflectors;
+
+        cl_mem memory_input_a = get_memory_buffer(m * n * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_output_q = get_memory_buffer(m * k * sizeof(float), CL_MEM_READ_WRITE);
+
+        enqueue_write(memory_input_a, a);
+
+        qr_factorize(memory_input_a, m, n, reflectors);
+
+        Matrix factors(m, n);
+        enqueue_read(memory_input_a, m * n * sizeof(float), factors.get_matrix());
+
+        Matrix upper(k, n);
+
+        for (size_t i = 0; i < k; i++) {
+
+            for (size_t j = 0; j < n; j++) {
+
+                upper.set_element(i, j, j < i ? 0 : factors.get_element(i, j));
+            }
+        }
+
+        //Q = H1 * H2 * ... * I, accumulated backwards so each panel only touches its trailing block
+        Matrix orthogonal(m, k);
+        orthogonal.clean_up();
+        orthogonal.identity(1);
+
+        enqueue_write(memory_output_q, orthogonal);
+
+        for (size_t i = reflectors.size(); i > 0; i--) {
+
+            const BlockReflector& reflector = reflectors[i - 1];
+            apply_block_reflector(memory_output_q, k, reflector.offset, reflector.offset, k - reflector.offset,
+                                  reflector, false);
+        }
+
+        enqueue_read(memory_output_q, m * k * sizeof(float), orthogonal.get_matrix());
+
+        release(memory_input_a);
+        release(memory_output_q);
+
+        factors.clean_up();
+
+        q = orthogonal;
+        r = upper;
+    }
+
+    Matrix lstsq(Matrix a, Matrix b) {
+
+        TraceSpan span("lstsq");
+
+        if (a.get_rows() != b.get_rows()) {
+
+            throw MatrixStatus("Matrix dimensions are unmatchable for the linear solve.", 13);
+        }
+
+        if (a.get_rows() < a.get_columns()) {
+
+            throw MatrixStatus("Least squares requires at least as many rows as columns.", 15);
+        }
+
+        size_t m = a.get_rows(), n = a.get_columns(), columns = b.get_columns();
+        std::vector<BlockReflector> reflectors;
+
+        Matrix result(n, columns);
+
+        cl_mem memory_input_a = get_memory_buffer(m * n * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_input_b = get_memory_buffer(m * columns * sizeof(float), CL_MEM_READ_WRITE);
+
+        enqueue_write(memory_input_a, a);
+        enqueue_write(memory_input_b, b);
+
+        if (!qr_factorize(memory_input_a, m, n, reflectors)) {
+
+            release(memory_input_a);
+            release(memory_input_b);
+
+            throw MatrixStatus("Matrix is rank deficient.", 16);
+        }
+
+        for (const BlockReflector& reflector : reflectors)
+            apply_block_reflector(memory_input_b, columns, reflector.offset, 0, columns, reflector, true);
+
+        //the leading (n x n) block of the factored buffer is R, with the same row stride as the square solvers
+        backward_substitute(memory_input_a, n, memory_input_b, columns);
+
+        synchronize();
+
+        enqueue_read(memory_input_b, n * columns * sizeof(float), result.get_matrix());
+
+        release(memory_input_a);
+        release(memory_input_b);
+
+        return result;
+    }
+
+    Matrix lstsq_batched(Matrix a, Matrix b, size_t batch) {
+
+        TraceSpan span("lstsq_batched");
+
+        if (batch == 0 || a.get_rows() % batch != 0 || b.get_rows() != a.get_rows()) {
+
+            throw MatrixStatus("Matrix dimensions are unmatchable for the linear solve.", 13);
+        }
+
+        int m = a.get_rows() / batch, n = a.get_columns(), columns = b.get_columns();
+
+        if (m < n) {
+
+            throw MatrixStatus("Least squares requires at least as many rows as columns.", 15);
+        }
+
+        Matrix result(batch * n, columns);
+
+        cl_mem memory_input_a = get_memory_buffer(a.get_rows() * n * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_input_b = get_memory_buffer(b.get_rows() * columns * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_output_a = get_memory_buffer(batch * n * columns * sizeof(float), CL_MEM_WRITE_ONLY);
+        cl_mem memory_status = get_memory_buffer(batch * sizeof(int), CL_MEM_WRITE_ONLY);
+
+        enqueue_write(memory_input_a, a);
+        enqueue_write(memory_input_b, b);
+
+        set_argument(batched_kernel_lstsq, 0, (void*)&m);
+        set_argument(batched_kernel_lstsq, 1, (void*)&n);
+        set_argument(batched_kernel_lstsq, 2, (void*)&columns);
+        set_argument(batched_kernel_lstsq, 3, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(batched_kernel_lstsq, 4, (void*)&memory_input_b, sizeof(cl_mem));
+        set_argument(batched_kernel_lstsq, 5, (void*)&memory_output_a, sizeof(cl_mem));
+        set_argument(batched_kernel_lstsq, 6, (void*)&memory_status, sizeof(cl_mem));
+
+        const size_t global_work_size = batch;
+        enqueue_kernel(batched_kernel_lstsq, 1, &global_work_size);
+
+        synchronize();
+
+        //a problem whose R has a zero or negligible diagonal element is left unsolved and flagged
+        std::vector<int> status(batch);
+
+        enqueue_read(memory_status, batch * sizeof(int), status.data());
+        enqueue_read(memory_output_a, batch * n * columns * sizeof(float), result.get_matrix());
+
+        release(memory_input_a);
+        release(memory_input_b);
+        release(memory_output_a);
+        release(memory_status);
+
+        for (size_t i = 0; i < batch; i++) {
+
+            if (status[i] != 0) {
+
+                result.clean_up();
+                throw MatrixStatus("Matrix is rank deficient. (Problem " + std::to_string(i) + " of the batch)", 16);
+            }
+        }
+
+        return result;
+    }
+
+    //Implicit QL iterations on the symmetric tridiagonal matrix with diagonal d and subdiagonal e[1:n] (e[0] unused).
+    //On return d holds the eigenvalues in ascending order, and the columns of the (n x n) row-major z, which the
+    //caller initialises, are rotated along so that z ends up holding the matching eigenvectors.
+    void tridiagonal_eigen(std::vector<double>& d, std::vector<double>& e, std::vector<double>& z, size_t n) {
+
+        for (size_t i = 1; i < n; i++)
+            e[i - 1] = e[i];
+
+        if (n > 0)
+            e[n - 1] = 0.0;
+
+        double shift = 0.0, norm = 0.0;
+
+        for (size_t l = 0; l < n; l++) {
+
+            norm = std::max(norm, fabs(d[l]) + fabs(e[l]));
+
+            size_t m = l;
+
+            while (m < n - 1 && fabs(e[m]) > DBL_EPSILON * norm)
+                m++;
+
+            int iterations = 0;
+
+            while (m > l && fabs(e[l]) > DBL_EPSILON * norm) {
+
+                if (++iterations > 60) {
+
+                    throw MatrixStatus("Eigenvalue iteration did not converge.", 17);
+                }
+
+                double g = d[l];
+                double p = (d[l + 1] - g) / (2.0 * e[l]);
+                double r = hypot(p, 1.0);
+
+                if (p < 0)
+                    r = -r;
+
+                d[l] = e[l] / (p + r);
+                d[l + 1] = e[l] * (p + r);
+
+                double dl1 = d[l + 1];
+                double h = g - d[l];
+
+                for (size_t i = l + 2; i < n; i++)
+                    d[i] -= h;
+
+                shift += h;
+
+                p = d[m];
+
+                double c = 1.0, c2 = 1.0, c3 = 1.0, s = 0.0, s2 = 0.0;
+                double el1 = e[l + 1];
+
+                for (size_t i = m; i-- > l; ) {
+
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    g = c * e[i];
+                    h = c * p;
+                    r = hypot(p, e[i]);
+                    e[i + 1] = s * r;
+                    s = e[i] / r;
+                    c = p / r;
+                    p = c * d[i] - s * g;
+                    d[i + 1] = h + s * (c * g + s * d[i]);
+
+                    for (size_t k = 0; k < n; k++) {
+
+                        h = z[k * n + i + 1];
+                        z[k * n + i + 1] = s * z[k * n + i] + c * h;
+                        z[k * n + i] = c * z[k * n + i] - s * h;
+                    }
+                }
+
+                p = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            }
+
+            d[l] += shift;
+            e[l] = 0.0;
+        }
+
+        for (size_t i = 0; i + 1 < n; i++) {
+
+            size_t smallest = i;
+
+            for (size_t j = i + 1; j < n; j++) {
+
+                if (d[j] < d[smallest])
+                    smallest = j;
+            }
+
+            if (smallest != i) {
+
+                std::swap(d[i], d[smallest]);
+
+                for (size_t k = 0; k < n; k++)
+                    std::swap(z[k * n + i], z[k * n + smallest]);
+            }
+        }
+    }
+
+    float dominant_eigen(Matrix matrix, Matrix& eigen_vector, float tolerable_error, size_t max_iterations,
+                         EigenStatus* status) {
+
+        TraceSpan span("dominant_eigen");
+
+        if (matrix.get_rows() != matrix.get_columns()) {
+
+            std::cerr << "108: ERROR: Eigen values supported only for square matrices.\n";
+            return 0.0f;
+        }
+
+        size_t n = matrix.get_rows(), iterations = 0;
+        float lambda_old = INFINITY, lambda_new = 0.0f, residual = 0.0f;
+        bool converged = false;
+
+        std::vector<float> guess(n, 1.0f), product(n);
+
+        cl_mem memory_input_a = get_memory_buffer(n * n * sizeof(float));
+        cl_mem memory_input_x = get_memory_buffer(n * sizeof(float));
+        cl_mem memory_output_y = get_memory_buffer(n * sizeof(float), CL_MEM_WRITE_ONLY);
+
+        enqueue_write(memory_input_a, matrix);
+
+        while (!converged && iterations < max_iterations) {
+
+            iterations++;
+
+            enqueue_write(memory_input_x, n * sizeof(float), guess.data());
+            gemv(n, n, memory_input_a, 0, n, memory_input_x, memory_output_y);
+            enqueue_read(memory_output_y, n * sizeof(float), product.data());
+
+            size_t largest = 0;
+
+            for (size_t i = 1; i < n; i++) {
+
+                if (fabs(product[i]) > fabs(product[largest]))
+                    largest = i;
+            }
+
+            lambda_new = product[largest];
+
+            //the guess lies in the null space, 0 is an eigenvalue
+            if (lambda_new == 0.0f) {
+
+                residual = 0.0f;
+                converged = true;
+                break;
+            }
+
+            double error = 0.0, length = 0.0;
+
+            for (size_t i = 0; i < n; i++) {
+
+                error += (product[i] - lambda_new * guess[i]) * (product[i] - lambda_new * guess[i]);
+                length += guess[i] * guess[i];
+
+                guess[i] = product[i] / lambda_new;
+            }
+
+            residual = (float)std::sqrt(error / length);
+            converged = fabs(lambda_new - lambda_old) <= tolerable_error;
+            lambda_old = lambda_new;
+        }
+
+        release(memory_input_a);
+        release(memory_input_x);
+        release(memory_output_y);
+
+        Matrix result(n, 1);
+        std::copy(guess.begin(), guess.end(), result.get_matrix());
+        eigen_vector = result;
+
+        if (status != nullptr) {
+
+            status->converged = converged;
+            status->iterations = iterations;
+            status->residual = residual;
+        }
+
+        return lambda_new;
+    }
+
+    //Eigen decomposition of a symmetric matrix: Householder reduction to tridiagonal form on the device (one GEMV
+    //and one rank 2 update per column), implicit QL on the host, then the eigenvectors of the tridiagonal matrix are
+    //carried back through the reflectors grouped into WY blocks, so the back transformation runs as GEMMs.
+    Matrix eigh(Matrix a, Matrix& eigen_vectors) {
+
+        TraceSpan span("eigh");
+
+        if (a.get_rows() != a.get_columns()) {
+
+            throw MatrixStatus("Square matrix required.", 11);
+        }
+
+        size_t n = a.get_rows();
+
+        std::vector<double> diagonal(n, 0.0), subdiagonal(n, 0.0), rotations(n * n, 0.0);
+        std::vector<float> column(n), v(n), w(n), taus(linalg_block_size);
+        std::vector<BlockReflector> reflectors;
+        BlockReflector reflector;
+
+        cl_mem memory_input_a = get_memory_buffer(n * n * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_input_v = get_memory_buffer(n * sizeof(float));
+        cl_mem memory_input_w = get_memory_buffer(n * sizeof(float), CL_MEM_READ_WRITE);
+
+        enqueue_write(memory_input_a, a);
+
+        for (size_t k = 0; k + 2 < n; k++) {
+
+            size_t height = n - k - 1;
+
+            enqueue_read_block(memory_input_a, n, k, k, height + 1, 1, column.data());
+
+            float alpha = column[1], sigma = 0.0f, beta = alpha, tau = 0.0f;
+
+            for (size_t i = 2; i <= height; i++)
+                sigma += column[i] * column[i];
+
+            v[0] = 1.0f;
+
+            if (sigma != 0.0f) {
+
+                float norm = sqrtf(alpha * alpha + sigma);
+
+                beta = alpha <= 0.0f ? norm : -norm;
+                tau = (beta - alpha) / beta;
+
+                for (size_t i = 1; i < height; i++)
+                    v[i] = column[i + 1] / (alpha - beta);
+            }
+            else {
+
+                std::fill(v.begin() + 1, v.begin() + height, 0.0f);
+            }
+
+            diagonal[k] = column[0];
+            subdiagonal[k + 1] = beta;
+
+            //A22 = H * A22 * H, as A22 - v * w^T - w * v^T with w = p - (tau / 2) * (p^T v) * v and p = tau * A22 * v
+            if (tau != 0.0f) {
+
+                enqueue_write(memory_input_v, height * sizeof(float), v.data());
+                gemv(height, height, memory_input_a, (k + 1) * n + k + 1, n, memory_input_v, memory_input_w);
+                enqueue_read(memory_input_w, height * sizeof(float), w.data());
+
+                float dot = 0.0f;
+
+                for (size_t i = 0; i < height; i++) {
+
+                    w[i] *= tau;
+                    dot += w[i] * v[i];
+                }
+
+                for (size_t i = 0; i < height; i++)
+                    w[i] -= 0.5f * tau * dot * v[i];
+
+                enqueue_write(memory_input_w, height * sizeof(float), w.data());
+
+                int size = height, offset = (k + 1) * n + k + 1, ld = n;
+
+                set_argument(block_kernel_rank2_update, 0, (void*)&size);
+                set_argument(block_kernel_rank2_update, 1, (void*)&memory_input_v, sizeof(cl_mem));
+                set_argument(block_kernel_rank2_update, 2, (void*)&memory_input_w, sizeof(cl_mem));
+                set_argument(block_kernel_rank2_update, 3, (void*)&memory_input_a, sizeof(cl_mem));
+                set_argument(block_kernel_rank2_update, 4, (void*)&offset);
+                set_argument(block_kernel_rank2_update, 5, (void*)&ld);
+
+                const size_t global_work_size[2] = { height, height };
+                enqueue_kernel(block_kernel_rank2_update, 2, global_work_size);
+            }
+
+            //reflector k acts on rows k + 1 onwards, consecutive reflectors form the panels of the WY blocks
+            size_t j = k % linalg_block_size;
+
+            if (j == 0) {
+
+                reflector.offset = k + 1;
+                reflector.height = height;
+                reflector.width = std::min(linalg_block_size, n - 2 - k);
+                reflector.v.assign(reflector.height * reflector.width, 0.0f);
+            }
+
+            for (size_t i = 0; i < height; i++)
+                reflector.v[(i + j) * reflector.width + j] = v[i];
+
+            taus[j] = tau;
+
+            if (j + 1 == reflector.width) {
+
+                form_triangular_factor(reflector, taus);
+                reflectors.push_back(reflector);
+            }
+        }
+
+        if (n >= 2) {
+
+            float corner[4];
+            enqueue_read_block(memory_input_a, n, n - 2, n - 2, 2, 2, corner);
+
+            diagonal[n - 2] = corner[0];
+            subdiagonal[n - 1] = corner[2];
+            diagonal[n - 1] = corner[3];
+        }
+        else if (n == 1) {
+
+            enqueue_read_block(memory_input_a, n, 0, 0, 1, 1, column.data());
+            diagonal[0] = column[0];
+        }
+
+        for (size_t i = 0; i < n; i++)
+            rotations[i * n + i] = 1.0;
+
+        tridiagonal_eigen(diagonal, subdiagonal, rotations, n);
+
+        Matrix values(n, 1), vectors(n, n);
+
+        for (size_t i = 0; i < n; i++) {
+
+            values.set_element(i, 0, (float)diagonal[i]);
+
+            for (size_t j = 0; j < n; j++)
+                vectors.set_element(i, j, (float)rotations[i * n + j]);
+        }
+
+        enqueue_write(memory_input_a, vectors);
+
+        for (size_t i = reflectors.size(); i > 0; i--)
+            apply_block_reflector(memory_input_a, n, reflectors[i - 1].offset, 0, n, reflectors[i - 1], false);
+
+        enqueue_read(memory_input_a, n * n * sizeof(float), vectors.get_matrix());
+
+        release(memory_input_a);
+        release(memory_input_v);
+        release(memory_input_w);
+
+        eigen_vectors = vectors;
+        return values;
+    }
+
+    Matrix eigsh(Matrix a, size_t k, Matrix& eigen_vectors, size_t max_iterations, float tolerance,
+                 EigenStatus* status) {
+
+        TraceSpan span("eigsh");
+
+        if (a.get_rows() != a.get_columns()) {
+
+            throw MatrixStatus("Square matrix required.", 11);
+        }
+
+        size_t n = a.get_rows();
+
+        if (k == 0 || k > n) {
+
+            throw MatrixStatus("Invalid number of eigenpairs requested.", 18);
+        }
+
+        size_t limit = std::min(n, std::max(max_iterations, k));
+
+        std::vector<float> basis, q(n), w(n);
+        std::vector<double> alphas, betas, diagonal, subdiagonal, rotations;
+        std::vector<size_t> order;
+
+        bool converged = false;
+        double residual = 0.0;
+        size_t steps = 0;
+
+        cl_mem memory_input_a = get_memory_buffer(n * n * sizeof(float));
+        cl_mem memory_input_q = get_memory_buffer(n * sizeof(float));
+        cl_mem memory_output_w = get_memory_buffer(n * sizeof(float), CL_MEM_WRITE_ONLY);
+
+        enqueue_write(memory_input_a, a);
+
+        //starts a new Lanczos vector orthogonal to the basis so far, returns false if none could be found
+        auto random_start = [&]() {
+
+            for (int attempt = 0; attempt < 3; attempt++) {
+
+                for (size_t i = 0; i < n; i++)
+                    q[i] = (float)(rand() % 2001 - 1000);
+
+                for (size_t r = 0; r < steps; r++) {
+
+                    double dot = 0.0;
+
+                    for (size_t i = 0; i < n; i++)
+                        dot += q[i] * basis[r * n + i];
+
+                    for (size_t i = 0; i < n; i++)
+                        q[i] -= (float)dot * basis[r * n + i];
+                }
+
+                double length = 0.0;
+
+                for (size_t i = 0; i < n; i++)
+                    length += q[i] * q[i];
+
+                if (length > 1e-6) {
+
+                    for (size_t i = 0; i < n; i++)
+                        q[i] /= (float)std::sqrt(length);
+
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        random_start();
+
+        while (steps < limit) {
+
+            basis.insert(basis.end(), q.begin(), q.end());
+            steps++;
+
+            enqueue_write(memory_input_q, n * sizeof(float), q.data());
+            gemv(n, n, memory_input_a, 0, n, memory_input_q, memory_output_w);
+            enqueue_read(memory_output_w, n * sizeof(float), w.data());
+
+            double alpha = 0.0, beta = 0.0;
+
+            for (size_t i = 0; i < n; i++)
+                alpha += w[i] * q[i];
+
+            alphas.push_back(alpha);
+
+            //full reorthogonalization against the whole basis keeps the Ritz values free of spurious copies
+            for (size_t r = 0; r < steps; r++) {
+
+                double dot = 0.0;
+
+                for (size_t i = 0; i < n; i++)
+                    dot += w[i] * basis[r * n + i];
+
+                for (size_t i = 0; i < n; i++)
+                    w[i] -= (float)dot * basis[r * n + i];
+            }
+
+            for (size_t i = 0; i < n; i++)
+                beta += w[i] * w[i];
+
+            beta = std::sqrt(beta);
+
+            bool exhausted = beta <= 1e-6 * std::max(1.0, fabs(alpha));
+
+            if (steps >= k && (exhausted || steps == limit || (steps - k) % 10 == 0)) {
+
+                diagonal = alphas;
+                subdiagonal.assign(steps, 0.0);
+
+                for (size_t i = 1; i < steps; i++)
+                    subdiagonal[i] = betas[i - 1];
+
+                rotations.assign(steps * steps, 0.0);
+
+                for (size_t i = 0; i < steps; i++)
+                    rotations[i * steps + i] = 1.0;
+
+                tridiagonal_eigen(diagonal, subdiagonal, rotations, steps);
+
+                order.resize(steps);
+
+                for (size_t i = 0; i < steps; i++)
+                    order[i] = i;
+
+                std::sort(order.begin(), order.end(), [&](size_t x, size_t y) {
+                    return fabs(diagonal[x]) > fabs(diagonal[y]);
+                });
+
+                //the residual of a Ritz pair is beta times the last component of its eigenvector
+                residual = 0.0;
+                converged = true;
+
+                for (size_t i = 0; i < k; i++) {
+
+                    double pair_residual = fabs(beta * rotations[(steps - 1) * steps + order[i]]);
+
+                    residual = std::max(residual, pair_residual);
+
+                    if (pair_residual > tolerance * std::max(1.0, fabs(diagonal[order[i]])))
+                        converged = false;
+                }
+
+                if (converged || steps == limit)
+                    break;
+            }
+
+            if (exhausted) {
+
+                //an invariant subspace was found, continue in a fresh direction with a decoupled T
+                betas.push_back(0.0);
+
+                if (!random_start())
+                    break;
+            }
+            else {
+
+                betas.push_back(beta);
+
+                for (size_t i = 0; i < n; i++)
+                    q[i] = w[i] / (float)beta;
+            }
+        }
+
+        release(memory_input_a);
+        release(memory_input_q);
+        release(memory_output_w);
+
+        Matrix values(k, 1), vectors(n, k);
+
+        for (size_t j = 0; j < k; j++) {
+
+            values.set_element(j, 0, (float)diagonal[order[j]]);
+
+            for (size_t i = 0; i < n; i++) {
+
+                double sum = 0.0;
+
+                for (size_t r = 0; r < steps; r++)
+                    sum += basis[r * n + i] * rotations[r * steps + order[j]];
+
+                vectors.set_element(i, j, (float)sum);
+            }
+        }
+
+        eigen_vectors = vectors;
+
+        if (status != nullptr) {
+
+            status->converged = converged;
+            status->iterations = steps;
+            status->residual = (float)residual;
+        }
+
+        return values;
+    }
+
+    //Orthonormalizes the columns of the (m x l) host matrix y in place by shifted Cholesky QR3, streaming it
+    //through the device `block_rows` rows at a time. Each pass accumulates G = Y^T * Y over the row blocks, factors
+    //G = L * L^T and replaces every block by Y * L^-T. The blocks reuse the caller's (block_rows x l) buffers.
+    //Plain Cholesky QR squares the condition number of Y and breaks down in float once it passes ~1e3, so the first
+    //pass adds a shift large enough to keep G well conditioned and the two following passes restore orthogonality.
+    void orthonormalize_rows(std::vector<float>& y, size_t m, size_t l, size_t block_rows, cl_mem memory_block,
+                             cl_mem memory_transpose, cl_mem memory_result) {
+
+        cl_mem memory_gram = get_memory_buffer(l * l * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_factor = get_memory_buffer(l * l * sizeof(float));
+
+        for (int pass = 0; pass < 3; pass++) {
+
+            enqueue_fill(memory_gram, l * l * sizeof(float), 0.0f);
+
+            for (size_t r0 = 0; r0 < m; r0 += block_rows) {
+
+                size_t rows = std::min(block_rows, m - r0);
+
+                enqueue_write(memory_block, rows * l * sizeof(float), y.data() + r0 * l);
+                transpose_block(memory_block, memory_transpose, rows, l);
+                block_update(l, l, rows, 1.0f, memory_transpose, 0, rows, memory_block, 0, l, memory_gram, 0, l);
+            }
+
+            Matrix gram(l, l);
+            enqueue_read(memory_gram, l * l * sizeof(float), gram.get_matrix());
+
+            //the later passes keep a small shift so the factorization stays defined when Y is numerically rank deficient
+            float trace = 0.0f;
+
+            for (size_t i = 0; i < l; i++)
+                trace += gram.get_element(i, i);
+
+            float shift = (pass == 0 ? sqrtf((float)m) : 1.0f) * l * FLT_EPSILON * trace + FLT_MIN;
+
+            for (size_t i = 0; i < l; i++)
+                gram.set_element(i, i, gram.get_element(i, i) + shift);
+
+            Matrix lower = cholesky(gram);
+            Matrix upper = transpose(lower);
+            Matrix factor = inverse(upper);
+
+            enqueue_write(memory_factor, factor);
+
+            for (size_t r0 = 0; r0 < m; r0 += block_rows) {
+
+                size_t rows = std::min(block_rows, m - r0);
+
+                enqueue_write(memory_block, rows * l * sizeof(float), y.data() + r0 * l);
+                enqueue_fill(memory_result, rows * l * sizeof(float), 0.0f);
+                block_update(rows, l, l, 1.0f, memory_block, 0, l, memory_factor, 0, l, memory_result, 0, l);
+                enqueue_read(memory_result, rows * l * sizeof(float), y.data() + r0 * l);
+            }
+
+            gram.clean_up();
+            lower.clean_up();
+            upper.clean_up();
+            factor.clean_up();
+        }
+
+        release(memory_gram);
+        release(memory_factor);
+    }
+
+    //One-sided Jacobi SVD of the (rows x columns) row-major matrix w in double precision. The columns of w are
+    //rotated until they are mutually orthogonal, so afterwards w = U * S and the rotations are accumulated in the
+    //(columns x columns) matrix v, giving the input as w * v^T. Working on w directly avoids forming w^T * w, which
+    //would square the condition number.
+    void jacobi_svd(std::vector<double>& w, size_t rows, size_t columns, std::vector<double>& v) {
+
+        v.assign(columns * columns, 0.0);
+
+        for (size_t i = 0; i < columns; i++)
+            v[i * columns + i] = 1.0;
+
+        for (int sweep = 0; sweep < 60; sweep++) {
+
+            bool rotated = false;
+
+            for (size_t p = 0; p + 1 < columns; p++) {
+
+                for (size_t q = p + 1; q < columns; q++) {
+
+                    double alpha = 0.0, beta = 0.0, gamma = 0.0;
+
+                    for (size_t i = 0; i < rows; i++) {
+
+                        alpha += w[i * columns + p] * w[i * columns + p];
+                        beta += w[i * columns + q] * w[i * columns + q];
+                        gamma += w[i * columns + p] * w[i * columns + q];
+                    }
+
+                    if (std::fabs(gamma) <= DBL_EPSILON * std::sqrt(alpha * beta) || gamma == 0.0)
+                        continue;
+
+                    rotated = true;
+
+                    double zeta = (beta - alpha) / (2.0 * gamma);
+                    double t = (zeta >= 0.0 ? 1.0 : -1.0) / (std::fabs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                    double c = 1.0 / std::sqrt(1.0 + t * t), s = c * t;
+
+                    for (size_t i = 0; i < rows; i++) {
+
+                        double x = w[i * columns + p], y = w[i * columns + q];
+                        w[i * columns + p] = c * x - s * y;
+                        w[i * columns + q] = s * x + c * y;
+                    }
+
+                    for (size_t i = 0; i < columns; i++) {
+
+                        double x = v[i * columns + p], y = v[i * columns + q];
+                        v[i * columns + p] = c * x - s * y;
+                        v[i * columns + q] = s * x + c * y;
+                    }
+                }
+            }
+
+            if (!rotated)
+                break;
+        }
+    }
+
+    Matrix svd_randomized(Matrix a, size_t k, Matrix& u, Matrix& vt, size_t power_iterations, size_t oversampling,
+                          size_t block_rows) {
+
+        TraceSpan span("svd_randomized");
+
+        size_t m = a.get_rows(), n = a.get_columns();
+        size_t l = std::min(std::min(m, n), k + oversampling);
+
+        if (k == 0 || k > std::min(m, n)) {
+
+            throw MatrixStatus("Invalid number of singular values requested.", 19);
+        }
+
+        //the row blocks of A, A^T and of the (m x l) sketch must fit on the device together with the small factors
+        if (block_rows == 0) {
+
+            size_t row_bytes = 2 * (n + l) * sizeof(float);
+            size_t fixed = 4 * n * l * sizeof(float);
+            size_t budget = device_memory_size / 2 > fixed ? device_memory_size / 2 - fixed : row_bytes;
+
+            block_rows = std::max((size_t)1, std::min(budget / row_bytes, device_max_allocation / (n * sizeof(float))));
+        }
+
+        block_rows = std::min(block_rows, m);
+
+        std::vector<float> sketch(m * l), omega(n * l);
+
+        cl_mem memory_block_a = get_memory_buffer(block_rows * n * sizeof(float));
+        cl_mem memory_block_at = get_memory_buffer(block_rows * n * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_block_y = get_memory_buffer(block_rows * l * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_block_yt = get_memory_buffer(block_rows * l * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_block_out = get_memory_buffer(block_rows * l * sizeof(float), CL_MEM_READ_WRITE);
+        cl_mem memory_omega = get_memory_buffer(n * l * sizeof(float), CL_MEM_READ_WRITE);
+
+        for (size_t i = 0; i < n * l; i++)
+            omega[i] = (float)(rand() % 2001 - 1000) / 1000.0f;
+
+        enqueue_write(memory_omega, n * l * sizeof(float), omega.data());
+
+        for (size_t iteration = 0; iteration <= power_iterations; iteration++) {
+
+            //Y = A * Omega, one row block at a time
+            for (size_t r0 = 0; r0 < m; r0 += block_rows) {
+
+                size_t rows = std::min(block_rows, m - r0);
+
+                write_view(queue, memory_block_a, a.row_range(r0, r0 + rows));
+                enqueue_fill(memory_block_y, rows * l * sizeof(float), 0.0f);
+                block_update(rows, l, n, 1.0f, memory_block_a, 0, n, memory_omega, 0, l, memory_block_y, 0, l);
+                enqueue_read(memory_block_y, rows * l * sizeof(float), sketch.data() + r0 * l);
+            }
+
+            orthonormalize_rows(sketch, m, l, block_rows, memory_block_y, memory_block_yt, memory_block_out);
+
+            if (iteration == power_iterations)
+                break;
+
+            //Omega = orth(A^T * Q), accumulated over the row blocks
+            enqueue_fill(memory_omega, n * l * sizeof(float), 0.0f);
+
+            for (size_t r0 = 0; r0 < m; r0 += block_rows) {
+
+                size_t rows = std::min(block_rows, m - r0);
+
+                write_view(queue, memory_block_a, a.row_range(r0, r0 + rows));
+                enqueue_write(memory_block_y, rows * l * sizeof(float), sketch.data() + r0 * l);
+                transpose_block(memory_block_a, memory_block_at, rows, n);
+                block_update(n, l, rows, 1.0f, memory_block_at, 0, rows, memory_block_y, 0, l, memory_omega, 0, l);
+            }
+
+            Matrix projection(n, l), q(1, 1), r(1, 1);
+            enqueue_read(memory_omega, n * l * sizeof(float), projection.get_matrix());
+
+            qr(projection, q, r);
+            enqueue_write(memory_omega, q);
+
+            projection.clean_up();
+            q.clean_up();
+            r.clean_up();
+        }
+
+        //B = Q^T * A is only (l x n). It is decomposed through the QR factorization B^T = Q_b * R_b and a Jacobi SVD
+        //of the small R_b in double, so unlike the eigenpairs of B * B^T the condition number is never squared
+        cl_mem memory_b = get_memory_buffer(l * n * sizeof(float), CL_MEM_READ_WRITE);
+        enqueue_fill(memory_b, l * n * sizeof(float), 0.0f);
+
+        for (size_t r0 = 0; r0 < m; r0 += block_rows) {
+
+            size_t rows = std::min(block_rows, m - r0);
+
+            write_view(queue, memory_block_a, a.row_range(r0, r0 + rows));
+            enqueue_write(memory_block_y, rows * l * sizeof(float), sketch.data() + r0 * l);
+            transpose_block(memory_block_y, memory_block_yt, rows, l);
+            block_update(l, n, rows, 1.0f, memory_block_yt, 0, rows, memory_block_a, 0, n, memory_b, 0, n);
+        }
+
+        Matrix small(l, n), small_q(1, 1), small_r(1, 1);
+        enqueue_read(memory_b, l * n * sizeof(float), small.get_matrix());
+
+        Matrix small_transpose = transpose(small);
+        qr(small_transpose, small_q, small_r);
+
+        //R_b = W * J^T with orthogonal columns in W, so B = J * S * (Q_b * W * S^-1)^T
+        std::vector<double> w(l * l), rotations;
+
+        for (size_t i = 0; i < l; i++)
+            for (size_t j = 0; j < l; j++)
+                w[i * l + j] = small_r.get_element(i, j);
+
+        jacobi_svd(w, l, l, rotations);
+
+        std::vector<double> norms(l, 0.0);
+        std::vector<size_t> order(l);
+
+        for (size_t j = 0; j < l; j++) {
+
+            for (size_t i = 0; i < l; i++)
+                norms[j] += w[i * l + j] * w[i * l + j];
+
+            norms[j] = std::sqrt(norms[j]);
+            order[j] = j;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&](size_t x, size_t y) { return norms[x] > norms[y]; });
+
+        Matrix values(k, 1), left(l, k), directions(l, k);
+
+        for (size_t j = 0; j < k; j++) {
+
+            double value = norms[order[j]];
+            double scale = value > 0.0 ? 1.0 / value : 0.0;
+
+            values.set_element(j, 0, (float)value);
+
+            for (size_t i = 0; i < l; i++) {
+
+                left.set_element(i, j, (float)rotations[i * l + order[j]]);
+                directions.set_element(i, j, (float)(w[i * l + order[j]] * scale));
+            }
+        }
+
+        Matrix right_transpose = matmul(small_q, directions);
+        Matrix right = transpose(right_transpose);
+
+        //U = Q * U_small, one row block at a time
+        Matrix result_u(m, k);
+        cl_mem memory_left = get_memory_buffer(l * k * sizeof(float));
+
+        enqueue_write(memory_left, left);
+
+        for (size_t r0 = 0; r0 < m; r0 += block_rows) {
+
+            size_t rows = std::min(block_rows, m - r0);
+
+            enqueue_write(memory_block_y, rows * l * sizeof(float), sketch.data() + r0 * l);
+            enqueue_fill(memory_block_out, rows * k * sizeof(float), 0.0f);
+            block_update(rows, k, l, 1.0f, memory_block_y, 0, l, memory_left, 0, k, memory_block_out, 0, k);
+            enqueue_read(memory_block_out, rows * k * sizeof(float), result_u.get_matrix() + r0 * k);
+        }
+
+        release(memory_block_a);
+        release(memory_block_at);
+        release(memory_block_y);
+        release(memory_block_yt);
+        release(memory_block_out);
+        release(memory_omega);
+        release(memory_b);
+        release(memory_left);
+
+        small.clean_up();
+        small_q.clean_up();
+        small_r.clean_up();
+        small_transpose.clean_up();
+        left.clean_up();
+        directions.clean_up();
+        right_transpose.clean_up();
+
+        u = result_u;
+        vt = right;
+        return values;
+    }
+
+    //device copies of the three CSR arrays, empty arrays still get a buffer so kernels can be bound
+    struct SparseBuffers {
+
+        cl_mem row_pointers;
+        cl_mem column_indices;
+        cl_mem values;
+    };
+
+    SparseBuffers upload_sparse(SparseMatrix const& a) {
+
+        size_t entries = std::max(a.get_nonzeros(), (size_t)1);
+        SparseBuffers buffers{};
+
+        buffers.row_pointers = get_memory_buffer((a.get_rows() + 1) * sizeof(int));
+        buffers.column_indices = get_memory_buffer(entries * sizeof(int));
+        buffers.values = get_memory_buffer(entries * sizeof(float));
+
+        enqueue_write(buffers.row_pointers, (a.get_rows() + 1) * sizeof(int), a.get_row_pointers().data());
+
+        if (a.get_nonzeros() > 0) {
+
+            enqueue_write(buffers.column_indices, a.get_nonzeros() * sizeof(int), a.get_column_indices().data());
+            enqueue_write(buffers.values, a.get_nonzeros() * sizeof(float), a.get_values().data());
+        }
+
+        return buffers;
+    }
+
+    void release(SparseBuffers& buffers) {
+
+        release(buffers.row_pointers);
+        release(buffers.column_indices);
+        release(buffers.values);
+    }
+
+    //turns the per-row entry counts left in `counts` into row pointers, uploaded to `row_pointers`
+    std::vector<int> scan_row_counts(cl_mem counts, cl_mem row_pointers, size_t rows) {
+
+        std::vector<int> pointers(rows + 1, 0);
+
+        enqueue_read(counts, rows * sizeof(int), pointers.data() + 1);
+
+        for (size_t i = 0; i < rows; i++)
+            pointers[i + 1] += pointers[i];
+
+        enqueue_write(row_pointers, (rows + 1) * sizeof(int), pointers.data());
+        return pointers;
+    }
+
+    SparseMatrix to_sparse(Matrix a) {
+
+        TraceSpan span("to_sparse");
+
+        size_t rows = a.get_rows();
+        int columns = a.get_columns();
+
+        if (rows == 0)
+            return SparseMatrix(rows, columns);
+
+        cl_mem memory_input_a = get_memory_buffer(rows * columns * sizeof(float));
+        cl_mem memory_counts = get_memory_buffer(rows * sizeof(int), CL_MEM_READ_WRITE);
+        cl_mem memory_pointers = get_memory_buffer((rows + 1) * sizeof(int));
+
+        enqueue_write(memory_input_a, a);
+
+        //count the non-zeros of every row, then let every row write its entries at its own offset
+        set_argument(sparse_kernel_dense_count, 0, (void*)&columns);
+        set_argument(sparse_kernel_dense_count, 1, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(sparse_kernel_dense_count, 2, (void*)&memory_counts, sizeof(cl_mem));
+
+        enqueue_kernel(sparse_kernel_dense_count, 1, &rows);
+
+        std::vector<int> pointers = scan_row_counts(memory_counts, memory_pointers, rows);
+        size_t entries = pointers[rows];
+
+        std::vector<int> column_indices(entries);
+        std::vector<float> values(entries);
+
+        cl_mem memory_columns = get_memory_buffer(std::max(entries, (size_t)1) * sizeof(int), CL_MEM_WRITE_ONLY);
+        cl_mem memory_values = get_memory_buffer(std::max(entries, (size_t)1) * sizeof(float), CL_MEM_WRITE_ONLY);
+
+        set_argument(sparse_kernel_compress, 0, (void*)&columns);
+        set_argument(sparse_kernel_compress, 1, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(sparse_kernel_compress, 2, (void*)&memory_pointers, sizeof(cl_mem));
+        set_argument(sparse_kernel_compress, 3, (void*)&memory_columns, sizeof(cl_mem));
+        set_argument(sparse_kernel_compress, 4, (void*)&memory_values, sizeof(cl_mem));
+
+        enqueue_kernel(sparse_kernel_compress, 1, &rows);
+
+        synchronize();
+
+        if (entries > 0) {
+
+            enqueue_read(memory_columns, entries * sizeof(int), column_indices.data());
+            enqueue_read(memory_values, entries * sizeof(float), values.data());
+        }
+
+        release(memory_input_a);
+        release(memory_counts);
+        release(memory_pointers);
+        release(memory_columns);
+        release(memory_values);
+
+        return SparseMatrix(rows, columns, pointers, column_indices, values);
+    }
+
+    Matrix to_dense(SparseMatrix const& a) {
+
+        TraceSpan span("to_dense");
+
+        size_t rows = a.get_rows();
+        int columns = a.get_columns();
+
+        Matrix result(rows, columns);
+
+        if (rows == 0 || columns == 0)
+            return result;
+
+        SparseBuffers memory_input_a = upload_sparse(a);
+        cl_mem memory_output_a = get_memory_buffer(rows * columns * sizeof(float), CL_MEM_READ_WRITE);
+
+        enqueue_fill(memory_output_a, rows * columns * sizeof(float), 0.0f);
+
+        set_argument(sparse_kernel_expand, 0, (void*)&columns);
+        set_argument(sparse_kernel_expand, 1, (void*)&memory_input_a.row_pointers, sizeof(cl_mem));
+        set_argument(sparse_kernel_expand, 2, (void*)&memory_input_a.column_indices, sizeof(cl_mem));
+        set_argument(sparse_kernel_expand, 3, (void*)&memory_input_a.values, sizeof(cl_mem));
+        set_argument(sparse_kernel_expand, 4, (void*)&memory_output_a, sizeof(cl_mem));
+
+        enqueue_kernel(sparse_kernel_expand, 1, &rows);
+
+        synchronize();
+
+        enqueue_read(memory_output_a, rows * columns * sizeof(float), result.get_matrix());
+
+        release(memory_input_a);
+        release(memory_output_a);
+
+        return result;
+    }
+
+    Matrix spmv(SparseMatrix const& a, Matrix x) {
+
+        TraceSpan span("spmv");
+
+        if (x.get_rows() != a.get_columns() || x.get_columns() != 1) {
+
+            throw MatrixStatus("Sparse matrix dimensions are unmatchable.", 23);
+        }
+
+        size_t rows = a.get_rows();
+        Matrix result(rows, 1);
+
+        if (rows == 0)
+            return result;
+
+        SparseBuffers memory_input_a = upload_sparse(a);
+        cl_mem memory_input_x = get_memory_buffer(std::max(x.get_rows(), (size_t)1) * sizeof(float));
+        cl_mem memory_output_a = get_memory_buffer(rows * sizeof(float), CL_MEM_WRITE_ONLY);
+
+        enqueue_write(memory_input_x, x);
+
+        set_argument(sparse_kernel_spmv, 0, (void*)&memory_input_a.row_pointers, sizeof(cl_mem));
+        set_argument(sparse_kernel_spmv, 1, (void*)&memory_input_a.column_indices, sizeof(cl_mem));
+        set_argument(sparse_kernel_spmv, 2, (void*)&memory_input_a.values, sizeof(cl_mem));
+        set_argument(sparse_kernel_spmv, 3, (void*)&memory_input_x, sizeof(cl_mem));
+        set_argument(sparse_kernel_spmv, 4, (void*)&memory_output_a, sizeof(cl_mem));
+
+        enqueue_kernel(sparse_kernel_spmv, 1, &rows);
+
+        synchronize();
+
+        enqueue_read(memory_output_a, rows * sizeof(float), result.get_matrix());
+
+        release(memory_input_a);
+        release(memory_input_x);
+        release(memory_output_a);
+
+        return result;
+    }
+
+    Matrix spmm(SparseMatrix const& a, Matrix b) {
+
+        TraceSpan span("spmm");
+
+        if (b.get_rows() != a.get_columns()) {
+
+            throw MatrixStatus("Sparse matrix dimensions are unmatchable.", 23);
+        }
+
+        if (b.get_columns() == 1)
+            return spmv(a, b);
+
+        size_t rows = a.get_rows();
+        int columns = b.get_columns();
+
+        Matrix result(rows, columns);
+
+        if (rows == 0 || columns == 0)
+            return result;
+
+        SparseBuffers memory_input_a = upload_sparse(a);
+        cl_mem memory_input_b = get_memory_buffer(std::max(b.get_rows(), (size_t)1) * columns * sizeof(float));
+        cl_mem memory_output_a = get_memory_buffer(rows * columns * sizeof(float), CL_MEM_WRITE_ONLY);
+
+        enqueue_write(memory_input_b, b);
+
+        set_argument(sparse_kernel_spmm, 0, (void*)&columns);
+        set_argument(sparse_kernel_spmm, 1, (void*)&memory_input_a.row_pointers, sizeof(cl_mem));
+        set_argument(sparse_kernel_spmm, 2, (void*)&memory_input_a.column_indices, sizeof(cl_mem));
+        set_argument(sparse_kernel_spmm, 3, (void*)&memory_input_a.values, sizeof(cl_mem));
+        set_argument(sparse_kernel_spmm, 4, (void*)&memory_input_b, sizeof(cl_mem));
+        set_argument(sparse_kernel_spmm, 5, (void*)&memory_output_a, sizeof(cl_mem));
+
+        const size_t global_work_size[2] = { rows, (size_t)columns };
+        enqueue_kernel(sparse_kernel_spmm, 2, global_work_size);
+
+        synchronize();
+
+        enqueue_read(memory_output_a, rows * columns * sizeof(float), result.get_matrix());
+
+        release(memory_input_a);
+        release(memory_input_b);
+        release(memory_output_a);
+
+        return result;
+    }
+
+    //op 0 adds, 1 subtracts and 2 multiplies. Sums and differences keep the union of both patterns, products only
+    //their intersection, so the output pattern is counted first and then filled row by row
+    SparseMatrix sparse_elementwise(SparseMatrix const& first, SparseMatrix const& second, int op) {
+
+        if (first.get_rows() != second.get_rows() || first.get_columns() != second.get_columns()) {
+
+            throw MatrixStatus("Sparse matrix dimensions are unmatchable.", 23);
         }
-    }
 
-    void set_argument(cl_kernel kernel, int argument_position, void* argument, size_t size = sizeof(int)) {
+        size_t rows = first.get_rows();
 
-        cl_int ret = clSetKernelArg(kernel, argument_position, size, argument);
+        if (rows == 0)
+            return SparseMatrix(rows, first.get_columns());
 
-        if (ret != 0) {
+        SparseBuffers memory_input_a = upload_sparse(first);
+        SparseBuffers memory_input_b = upload_sparse(second);
+        cl_mem memory_counts = get_memory_buffer(rows * sizeof(int), CL_MEM_READ_WRITE);
+        cl_mem memory_pointers = get_memory_buffer((rows + 1) * sizeof(int));
 
-            throw MatrixStatus("Kernel arguments could not be set.", 94);
-        }
-    }
+        set_argument(sparse_kernel_count, 0, (void*)&op);
+        set_argument(sparse_kernel_count, 1, (void*)&memory_input_a.row_pointers, sizeof(cl_mem));
+        set_argument(sparse_kernel_count, 2, (void*)&memory_input_a.column_indices, sizeof(cl_mem));
+        set_argument(sparse_kernel_count, 3, (void*)&memory_input_b.row_pointers, sizeof(cl_mem));
+        set_argument(sparse_kernel_count, 4, (void*)&memory_input_b.column_indices, sizeof(cl_mem));
+        set_argument(sparse_kernel_count, 5, (void*)&memory_counts, sizeof(cl_mem));
 
-    void synchronize() {
+        enqueue_kernel(sparse_kernel_count, 1, &rows);
 
-        cl_int ret = clFinish(queue);
+        std::vector<int> pointers = scan_row_counts(memory_counts, memory_pointers, rows);
+        size_t entries = pointers[rows];
 
-        if (ret != 0) {
+        std::vector<int> column_indices(entries);
+        std::vector<float> values(entries);
 
-            throw MatrixStatus("Error synchronizing kernel tasks.", 96);
+        cl_mem memory_columns = get_memory_buffer(std::max(entries, (size_t)1) * sizeof(int), CL_MEM_WRITE_ONLY);
+        cl_mem memory_values = get_memory_buffer(std::max(entries, (size_t)1) * sizeof(float), CL_MEM_WRITE_ONLY);
+
+        set_argument(sparse_kernel_merge, 0, (void*)&op);
+        set_argument(sparse_kernel_merge, 1, (void*)&memory_input_a.row_pointers, sizeof(cl_mem));
+        set_argument(sparse_kernel_merge, 2, (void*)&memory_input_a.column_indices, sizeof(cl_mem));
+        set_argument(sparse_kernel_merge, 3, (void*)&memory_input_a.values, sizeof(cl_mem));
+        set_argument(sparse_kernel_merge, 4, (void*)&memory_input_b.row_pointers, sizeof(cl_mem));
+        set_argument(sparse_kernel_merge, 5, (void*)&memory_input_b.column_indices, sizeof(cl_mem));
+        set_argument(sparse_kernel_merge, 6, (void*)&memory_input_b.values, sizeof(cl_mem));
+        set_argument(sparse_kernel_merge, 7, (void*)&memory_pointers, sizeof(cl_mem));
+        set_argument(sparse_kernel_merge, 8, (void*)&memory_columns, sizeof(cl_mem));
+        set_argument(sparse_kernel_merge, 9, (void*)&memory_values, sizeof(cl_mem));
+
+        enqueue_kernel(sparse_kernel_merge, 1, &rows);
+
+        synchronize();
+
+        if (entries > 0) {
+
+            enqueue_read(memory_columns, entries * sizeof(int), column_indices.data());
+            enqueue_read(memory_values, entries * sizeof(float), values.data());
         }
+
+        release(memory_input_a);
+        release(memory_input_b);
+        release(memory_counts);
+        release(memory_pointers);
+        release(memory_columns);
+        release(memory_values);
+
+        return SparseMatrix(rows, first.get_columns(), pointers, column_indices, values);
     }
 
-    void release(cl_mem buffer) {
+    SparseMatrix operator+(SparseMatrix const& first, SparseMatrix const& second) {
 
-        cl_int ret = clReleaseMemObject(buffer);
+        TraceSpan span("operator+ (sparse)");
 
-        if (ret != 0) {
+        return sparse_elementwise(first, second, 0);
+    }
 
-            std::cerr << "98: WARNING: Error clearing kernel space. Memory leaks may happen.\n";
-        }
+    SparseMatrix operator-(SparseMatrix const& first, SparseMatrix const& second) {
+
+        TraceSpan span("operator- (sparse)");
+
+        return sparse_elementwise(first, second, 1);
     }
 
-    Matrix matmul(Matrix a, Matrix b) {
+    SparseMatrix operator*(SparseMatrix const& first, SparseMatrix const& second) {
 
-        cl_int ret;
-        auto* output = new float[a.get_rows() * b.get_columns()];
+        TraceSpan span("operator* (sparse)");
 
-        Matrix result(a.get_rows(), b.get_columns());
+        return sparse_elementwise(first, second, 2);
+    }
 
-        cl_mem memory_input_a = get_memory_buffer(a.get_rows() * a.get_columns() * sizeof(float));
-        cl_mem memory_input_b = get_memory_buffer(b.get_rows() * b.get_columns() * sizeof(float));
-        cl_mem memory_output_a = get_memory_buffer(a.get_rows() * b.get_columns() * sizeof(float), CL_MEM_WRITE_ONLY);
+    SparseMatrix operator*(SparseMatrix const& first, float const& second) {
 
-        enqueue_write(memory_input_a, a);
-        enqueue_write(memory_input_b, b);
+        TraceSpan span("operator* (scalar) (sparse)");
 
-        size_t rows = a.get_rows(), cols = b.get_columns(), inter = b.get_rows();
+        size_t entries = first.get_nonzeros();
 
-        set_argument(matrix_kernel_multiply, 0, (void*)&rows);
-        set_argument(matrix_kernel_multiply, 1, (void*)&cols);
-        set_argument(matrix_kernel_multiply, 2, (void*)&inter);
-        set_argument(matrix_kernel_multiply, 3, (void*)&memory_input_a, sizeof(cl_mem));
-        set_argument(matrix_kernel_multiply, 4, (void*)&memory_input_b, sizeof(cl_mem));
-        set_argument(matrix_kernel_multiply, 5, (void*)&memory_output_a, sizeof(cl_mem));
+        if (entries == 0)
+            return first;
 
-        const size_t local_work_size[2] = { 1, 1 };
-        const size_t global_work_size[2] = { a.get_rows(), b.get_columns() };
+        std::vector<float> values(entries);
 
-        ret = clEnqueueNDRangeKernel(queue, matrix_kernel_multiply, 2, nullptr,
-                                     global_work_size, local_work_size, 0, nullptr, nullptr);
+        cl_mem memory_input_a = get_memory_buffer(entries * sizeof(float));
+        cl_mem memory_input_b = get_memory_buffer(sizeof(float));
+        cl_mem memory_output_a = get_memory_buffer(entries * sizeof(float), CL_MEM_WRITE_ONLY);
 
-        if (ret != 0)
-            throw MatrixStatus("Error launching kernel.", 95);
+        enqueue_write(memory_input_a, entries * sizeof(float), first.get_values().data());
+        enqueue_write(memory_input_b, second);
 
-        synchronize();
+        //the pattern is unchanged, only the stored values are scaled
+        set_argument(scalar_kernel_multiply, 0, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(scalar_kernel_multiply, 1, (void*)&memory_input_b, sizeof(cl_mem));
+        set_argument(scalar_kernel_multiply, 2, (void*)&memory_output_a, sizeof(cl_mem));
 
-        ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                  a.get_rows() * b.get_columns() * sizeof(float), output, 0, nullptr, nullptr);
+        enqueue_kernel(scalar_kernel_multiply, 1, &entries);
 
-        if (ret != 0)
-            throw MatrixStatus("Error reading output from kernel.", 97);
+        synchronize();
+
+        enqueue_read(memory_output_a, entries * sizeof(float), values.data());
 
         release(memory_input_a);
         release(memory_input_b);
         release(memory_output_a);
 
-        result.set_matrix(output);
-        return result;
+        return SparseMatrix(first.get_rows(), first.get_columns(), first.get_row_pointers(),
+                            first.get_column_indices(), values);
     }
 
-    Matrix transpose(Matrix a) {
+    //counts the set elements of every `mask_chunk_size` long chunk of a device mask of `size` elements
+    std::vector<int> count_mask_chunks(cl_mem memory_mask, size_t size) {
 
-        cl_int ret;
-        auto* output = new float[a.get_rows() * a.get_columns()];
+        size_t chunks = (size + mask_chunk_size - 1) / mask_chunk_size;
+        int args[2] = { (int)size, (int)mask_chunk_size };
 
-        Matrix result(a.get_columns(), a.get_rows());
+        std::vector<int> counts(chunks);
+        cl_mem memory_counts = get_memory_buffer(chunks * sizeof(int), CL_MEM_WRITE_ONLY);
 
-        cl_mem memory_input_a = get_memory_buffer(a.get_rows() * a.get_columns() * sizeof(float));
-        cl_mem memory_output_a = get_memory_buffer(a.get_rows() * a.get_columns() * sizeof(float), CL_MEM_WRITE_ONLY);
+        set_argument(mask_kernel_count, 0, (void*)&args[0]);
+        set_argument(mask_kernel_count, 1, (void*)&args[1]);
+        set_argument(mask_kernel_count, 2, (void*)&memory_mask, sizeof(cl_mem));
+        set_argument(mask_kernel_count, 3, (void*)&memory_counts, sizeof(cl_mem));
 
-        enqueue_write(memory_input_a, a);
+        enqueue_kernel(mask_kernel_count, 1, &chunks);
 
-        int cols = a.get_columns();
+        synchronize();
 
-        set_argument(matrix_kernel_transpose, 0, (void*)&cols);
-        set_argument(matrix_kernel_transpose, 1, (void*)&memory_input_a, sizeof(cl_mem));
-        set_argument(matrix_kernel_transpose, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        enqueue_read(memory_counts, chunks * sizeof(int), counts.data());
+        release(memory_counts);
 
-        const size_t local_work_size[2] = { 1, 1 };
-        const size_t global_work_size[2] = { a.get_rows(), a.get_columns() };
+        return counts;
+    }
 
-        ret = clEnqueueNDRangeKernel(queue, matrix_kernel_transpose, 2, nullptr,
-                                     global_work_size, local_work_size, 0, nullptr, nullptr);
+    size_t count_nonzero(Mask mask) {
 
-        if (ret != 0) {
+        TraceSpan span("count_nonzero");
 
-            throw MatrixStatus("Error launching kernel.", 95);
-        }
+        size_t size = mask.get_rows() * mask.get_columns(), count = 0;
 
-        synchronize();
+        if (size == 0)
+            return 0;
 
-        ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                  a.get_rows() * a.get_columns() * sizeof(float), output, 0, nullptr, nullptr);
+        cl_mem memory_mask = get_memory_buffer(size * sizeof(uint8_t));
+        write_view(queue, memory_mask, mask);
 
-        if (ret != 0) {
+        for (int chunk : count_mask_chunks(memory_mask, size))
+            count += chunk;
 
-            throw MatrixStatus("Error reading output from kernel.", 97);
-        }
+        release(memory_mask);
+        return count;
+    }
 
-        release(memory_input_a);
-        release(memory_output_a);
+    bool any(Mask mask) {
 
-        result.set_matrix(output);
-        return result;
+        TraceSpan span("any");
+
+        return count_nonzero(mask) > 0;
     }
 
-    Matrix operator+(Matrix& first, Matrix const& second) {
+    bool all(Mask mask) {
 
-        try {
+        TraceSpan span("all");
 
-            cl_int ret;
+        return count_nonzero(mask) == mask.get_rows() * mask.get_columns();
+    }
 
-            float* output_a = nullptr, * output_b = nullptr;
-            long long int columns_highest = 0, rows_highest = 0;
+    Matrix masked_select(Matrix a, Mask mask) {
 
-            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+        TraceSpan span("masked_select");
 
-            if (flag == 0) {
+        if (a.get_rows() != mask.get_rows() || a.get_columns() != mask.get_columns()) {
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
-            else {
+            throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+        }
 
-                output_a = new float[rows_highest * columns_highest];
-                output_b = new float[rows_highest * columns_highest];
-            }
+        size_t size = a.get_rows() * a.get_columns();
 
-            flag = broadcast2(&first, &second, output_a, output_b, flag);
+        if (size == 0)
+            return Matrix(0, 1);
 
-            if (flag == 0) {
+        cl_mem memory_input_a = get_memory_buffer(size * sizeof(float));
+        cl_mem memory_mask = get_memory_buffer(size * sizeof(uint8_t));
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
+        enqueue_write(memory_input_a, a);
+        write_view(queue, memory_mask, mask);
 
-            Matrix result(rows_highest, columns_highest);
+        //every chunk writes its selected elements at the running total of the chunks before it
+        std::vector<int> offsets = count_mask_chunks(memory_mask, size);
+        size_t chunks = offsets.size(), selected = 0;
 
-            cl_mem memory_input_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_input_b = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float), CL_MEM_WRITE_ONLY);
+        for (size_t i = 0; i < chunks; i++) {
 
-            enqueue_write(memory_input_a, rows_highest * columns_highest * sizeof(float), output_a);
-            enqueue_write(memory_input_b, rows_highest * columns_highest * sizeof(float), output_b);
+            int count = offsets[i];
+            offsets[i] = (int)selected;
+            selected += count;
+        }
 
-            set_argument(kernel_add, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(kernel_add, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(kernel_add, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        Matrix result(selected, 1);
 
-            size_t global_work_size = rows_highest * columns_highest;
-            size_t local_work_size = 1;
+        if (selected > 0) {
 
-            ret = clEnqueueNDRangeKernel(queue, kernel_add, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+            cl_mem memory_offsets = get_memory_buffer(chunks * sizeof(int));
+            cl_mem memory_output_a = get_memory_buffer(selected * sizeof(float), CL_MEM_WRITE_ONLY);
 
-            if (ret != 0) {
+            enqueue_write(memory_offsets, chunks * sizeof(int), offsets.data());
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+            int args[2] = { (int)size, (int)mask_chunk_size };
 
-            synchronize();
+            set_argument(mask_kernel_select, 0, (void*)&args[0]);
+            set_argument(mask_kernel_select, 1, (void*)&args[1]);
+            set_argument(mask_kernel_select, 2, (void*)&memory_input_a, sizeof(cl_mem));
+            set_argument(mask_kernel_select, 3, (void*)&memory_mask, sizeof(cl_mem));
+            set_argument(mask_kernel_select, 4, (void*)&memory_offsets, sizeof(cl_mem));
+            set_argument(mask_kernel_select, 5, (void*)&memory_output_a, sizeof(cl_mem));
 
-            auto* output_final = new float[rows_highest * columns_highest];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      rows_highest * columns_highest * sizeof(float), output_final, 0, nullptr, nullptr);
+            enqueue_kernel(mask_kernel_select, 1, &chunks);
 
-            if (ret != 0) {
+            synchronize();
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+            enqueue_read(memory_output_a, selected * sizeof(float), result.get_matrix());
 
-            release(memory_input_a);
-            release(memory_input_b);
+            release(memory_offsets);
             release(memory_output_a);
+        }
 
-            result.set_matrix(output_final);
+        release(memory_input_a);
+        release(memory_mask);
 
-            delete[] output_a;
-            delete[] output_b;
+        return result;
+    }
 
-            return result;
-        }
-        catch (MatrixStatus& status) {
+    //copies with fewer bytes than this stay on the calling thread
+    const size_t parallel_copy_bytes = 4 << 20;
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
+    //runs body(begin, end) over blocks of the rows, one block per host core when there are enough bytes to move
+    template<typename F>
+    void parallel_rows(size_t rows, size_t row_bytes, F body) {
+
+        size_t workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), rows);
+
+        if (rows * row_bytes < parallel_copy_bytes || workers <= 1) {
+
+            body(0, rows);
+            return;
         }
+
+        std::vector<std::thread> threads;
+
+        for (size_t i = 0; i < workers; i++)
+            threads.emplace_back(body, rows * i / workers, rows * (i + 1) / workers);
+
+        for (std::thread& thread : threads)
+            thread.join();
     }
 
-    Matrix operator-(Matrix& first, Matrix const& second) {
+    //copies source into the elements of destination, whole rows at a time where both keep their rows contiguous
+    template<typename T>
+    void copy_view(BasicMatrix<T> destination, const BasicMatrix<T>& source) {
 
-        try {
+        size_t columns = source.get_columns();
+        bool rows_contiguous = destination.get_column_step() == 1 && source.get_column_step() == 1;
 
-            cl_int ret;
+        parallel_rows(source.get_rows(), columns * sizeof(T), [&](size_t begin, size_t end) {
 
-            float* output_a = nullptr, * output_b = nullptr;
-            long long int columns_highest = 0, rows_highest = 0;
+            for (size_t i = begin; i < end; i++) {
 
-            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+                if (rows_contiguous) {
 
-            if (flag == 0) {
+                    memcpy(destination.get_matrix() + i * destination.get_row_stride(),
+                           source.get_matrix() + i * source.get_row_stride(), columns * sizeof(T));
+                    continue;
+                }
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+                for (size_t j = 0; j < columns; j++)
+                    destination.set_element(i, j, source.get_element(i, j));
             }
-            else {
+        });
+    }
 
-                output_a = new float[rows_highest * columns_highest];
-                output_b = new float[rows_highest * columns_highest];
-            }
+    Matrix concatenate(const std::vector<Matrix>& parts, size_t axis) {
 
-            flag = broadcast2(&first, &second, output_a, output_b, flag);
+        TraceSpan span("concatenate");
 
-            if (flag == 0) {
+        if (parts.empty() || axis > 1) {
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
+            throw MatrixStatus("Matrix dimensions are unmatchable for the concatenation.", 26);
+        }
 
-            Matrix result(rows_highest, columns_highest);
+        size_t rows = parts[0].get_rows(), columns = parts[0].get_columns();
 
-            cl_mem memory_input_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_input_b = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
+        for (size_t i = 1; i < parts.size(); i++) {
 
-            enqueue_write(memory_input_a, rows_highest * columns_highest * sizeof(float), output_a);
-            enqueue_write(memory_input_b, rows_highest * columns_highest * sizeof(float), output_b);
+            if (axis == 0 ? parts[i].get_columns() != columns : parts[i].get_rows() != rows) {
 
-            set_argument(kernel_subtract, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(kernel_subtract, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(kernel_subtract, 2, (void*)&memory_output_a, sizeof(cl_mem));
+                throw MatrixStatus("Matrix dimensions are unmatchable for the concatenation.", 26);
+            }
 
-            size_t global_work_size = rows_highest * columns_highest;
-            size_t local_work_size = 1;
+            if (axis == 0)
+                rows += parts[i].get_rows();
+            else
+                columns += parts[i].get_columns();
+        }
 
-            ret = clEnqueueNDRangeKernel(queue, kernel_subtract, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+        //one allocation, every part is copied straight to its place
+        Matrix result = Matrix::empty(rows, columns);
+        size_t offset = 0;
 
-            if (ret != 0) {
+        for (const Matrix& part : parts) {
 
-                throw MatrixStatus("Error launching kernel.", 95);
+            if (axis == 0) {
+
+                copy_view(result.block(offset, 0, part.get_rows(), columns), part);
+                offset += part.get_rows();
             }
+            else {
 
-            synchronize();
+                copy_view(result.block(0, offset, rows, part.get_columns()), part);
+                offset += part.get_columns();
+            }
+        }
 
-            auto* output_final = new float[rows_highest * columns_highest];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      rows_highest * columns_highest * sizeof(float), output_final, 0, nullptr, nullptr);
+        return result;
+    }
 
-            if (ret != 0) {
+    Matrix vstack(const std::vector<Matrix>& parts) {
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+        return concatenate(parts, 0);
+    }
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+    Matrix hstack(const std::vector<Matrix>& parts) {
+
+        return concatenate(parts, 1);
+    }
 
-            result.set_matrix(output_final);
+    std::vector<Matrix> split(Matrix a, const std::vector<size_t>& indices, size_t axis) {
 
-            delete[] output_a;
-            delete[] output_b;
+        TraceSpan span("split");
 
-            return result;
+        size_t extent = axis == 0 ? a.get_rows() : a.get_columns();
+
+        if (axis > 1) {
+
+            throw MatrixStatus("Matrix cannot be split into the requested parts.", 27);
         }
-        catch (MatrixStatus& status) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
+        std::vector<Matrix> parts;
+        size_t begin = 0;
+
+        for (size_t i = 0; i <= indices.size(); i++) {
+
+            size_t end = i < indices.size() ? indices[i] : extent;
+
+            if (end < begin || end > extent) {
+
+                throw MatrixStatus("Matrix cannot be split into the requested parts.", 27);
+            }
+
+            parts.push_back(axis == 0 ? a.row_range(begin, end) : a.column_range(begin, end));
+            begin = end;
         }
+
+        return parts;
     }
 
-    Matrix operator*(Matrix& first, Matrix const& second) {
+    std::vector<Matrix> split(Matrix a, size_t sections, size_t axis) {
 
-        try {
+        size_t extent = axis == 0 ? a.get_rows() : a.get_columns();
 
-            cl_int ret;
+        if (sections == 0 || extent % sections != 0) {
 
-            float* output_a = nullptr, * output_b = nullptr;
-            long long int columns_highest = 0, rows_highest = 0;
+            throw MatrixStatus("Matrix cannot be split into the requested parts.", 27);
+        }
 
-            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+        std::vector<size_t> indices;
 
-            if (flag == 0) {
+        for (size_t i = 1; i < sections; i++)
+            indices.push_back(extent / sections * i);
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
-            else {
+        return split(a, indices, axis);
+    }
 
-                output_a = new float[rows_highest * columns_highest];
-                output_b = new float[rows_highest * columns_highest];
-            }
+    //the host gathers and scatters unless the device shares its memory, copying a whole matrix
+    //to the device to pick a few of its rows out costs more than picking them out on the host
+    bool gather_on_device() {
 
-            flag = broadcast2(&first, &second, output_a, output_b, flag);
+        return unified_memory == CL_TRUE;
+    }
 
-            if (flag == 0) {
+    void check_indices(const int* indices, size_t count, size_t extent) {
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
+        for (size_t i = 0; i < count; i++) {
 
-            Matrix result(rows_highest, columns_highest);
+            if (indices[i] < 0 || (size_t)indices[i] >= extent) {
 
-            cl_mem memory_input_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_input_b = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float), CL_MEM_WRITE_ONLY);
+                throw MatrixStatus("Index is out of the bounds of the matrix.", 28);
+            }
+        }
+    }
 
-            enqueue_write(memory_input_a, rows_highest * columns_highest * sizeof(float), output_a);
-            enqueue_write(memory_input_b, rows_highest * columns_highest * sizeof(float), output_b);
+    //element (row, col) of the result reads a(I[row], col) with op 0, a(row, I[col]) with op 1,
+    //a(I[row*columns + col], col) with op 2 and a(row, I[row*columns + col]) with op 3
+    Matrix gather(Matrix a, int op, const int* indices, size_t count, size_t rows, size_t columns) {
 
-            set_argument(kernel_multiply, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(kernel_multiply, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(kernel_multiply, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        Matrix result = Matrix::empty(rows, columns);
 
-            size_t global_work_size = rows_highest * columns_highest;
-            size_t local_work_size = 1;
+        if (rows * columns == 0)
+            return result;
 
-            ret = clEnqueueNDRangeKernel(queue, kernel_multiply, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+        if (!gather_on_device()) {
 
-            if (ret != 0)
-                throw MatrixStatus("Error launching kernel.", 95);
+            const float* source = a.get_matrix();
+            size_t row_stride = a.get_row_stride(), column_step = a.get_column_step();
 
-            synchronize();
+            parallel_rows(rows, columns * sizeof(float), [&](size_t begin, size_t end) {
 
-            auto* output_final = new float[rows_highest * columns_highest];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      rows_highest * columns_highest * sizeof(float), output_final, 0, nullptr, nullptr);
+                for (size_t i = begin; i < end; i++) {
 
-            if (ret != 0) {
+                    float* out = result.get_matrix() + i * columns;
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+                    if (op == 0 && column_step == 1) {
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+                        memcpy(out, source + indices[i] * row_stride, columns * sizeof(float));
+                        continue;
+                    }
 
-            result.set_matrix(output_final);
+                    for (size_t j = 0; j < columns; j++) {
 
-            delete[] output_a;
-            delete[] output_b;
+                        size_t row = op == 0 ? indices[i] : op == 2 ? indices[i * columns + j] : i;
+                        size_t column = op == 1 ? indices[j] : op == 3 ? indices[i * columns + j] : j;
+
+                        out[j] = source[row * row_stride + column * column_step];
+                    }
+                }
+            });
 
             return result;
         }
-        catch (MatrixStatus& status) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
-        }
-    }
+        cl_mem memory_indices = input_buffer(indices, count * sizeof(int));
+        cl_mem memory_input_a = input_buffer(a);
+        cl_mem memory_output_a = output_buffer(result.get_matrix(), rows * columns * sizeof(float));
 
-    Matrix operator>(Matrix& first, Matrix const& second) {
+        int args[3] = { op, (int)a.get_columns(), (int)columns };
 
-        try {
+        set_argument(gather_kernel, 0, (void*)&args[0]);
+        set_argument(gather_kernel, 1, (void*)&args[1]);
+        set_argument(gather_kernel, 2, (void*)&args[2]);
+        set_argument(gather_kernel, 3, (void*)&memory_indices, sizeof(cl_mem));
+        set_argument(gather_kernel, 4, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(gather_kernel, 5, (void*)&memory_output_a, sizeof(cl_mem));
 
-            cl_int ret;
+        const size_t global_work_size[2] = { rows, columns };
+        enqueue_kernel(gather_kernel, 2, global_work_size);
 
-            float* output_a = nullptr, * output_b = nullptr;
-            long long int columns_highest = 0, rows_highest = 0;
+        synchronize();
 
-            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+        finish_output(memory_output_a, result.get_matrix(), rows * columns * sizeof(float));
 
-            if (flag == 0) {
+        release(memory_indices);
+        release(memory_input_a);
+        release(memory_output_a);
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
-            else {
+        return result;
+    }
+
+    Matrix take(Matrix a, const std::vector<int>& indices, size_t axis) {
+
+        TraceSpan span("take");
+
+        if (axis > 1) {
+
+            throw MatrixStatus("Index is out of the bounds of the matrix.", 28);
+        }
 
-                output_a = new float[rows_highest * columns_highest];
-                output_b = new float[rows_highest * columns_highest];
-            }
+        check_indices(indices.data(), indices.size(), axis == 0 ? a.get_rows() : a.get_columns());
 
-            flag = broadcast2(&first, &second, output_a, output_b, flag);
+        if (axis == 0)
+            return gather(a, 0, indices.data(), indices.size(), indices.size(), a.get_columns());
 
-            if (flag == 0) {
+        return gather(a, 1, indices.data(), indices.size(), a.get_rows(), indices.size());
+    }
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
+    Matrix compress(Matrix a, Mask mask, size_t axis) {
 
-            Matrix result(rows_highest, columns_highest);
+        size_t extent = axis == 0 ? a.get_rows() : a.get_columns();
 
-            cl_mem memory_input_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_input_b = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float), CL_MEM_WRITE_ONLY);
+        if (mask.get_rows() * mask.get_columns() != extent) {
 
-            enqueue_write(memory_input_a, rows_highest * columns_highest * sizeof(float), output_a);
-            enqueue_write(memory_input_b, rows_highest * columns_highest * sizeof(float), output_b);
+            throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+        }
 
-            set_argument(kernel_gt, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(kernel_gt, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(kernel_gt, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        std::vector<int> indices;
 
-            size_t global_work_size = rows_highest * columns_highest;
-            size_t local_work_size = 1;
+        for (size_t i = 0; i < extent; i++) {
 
-            ret = clEnqueueNDRangeKernel(queue, kernel_gt, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+            if (mask.get_element(i / mask.get_columns(), i % mask.get_columns()) != 0)
+                indices.push_back((int)i);
+        }
 
-            if (ret != 0) {
+        return take(a, indices, axis);
+    }
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+    Matrix take_along_axis(Matrix a, const BasicMatrix<int32_t>& indices, size_t axis) {
 
-            synchronize();
+        TraceSpan span("take_along_axis");
 
-            auto* output_final = new float[rows_highest * columns_highest];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      rows_highest * columns_highest * sizeof(float), output_final, 0, nullptr, nullptr);
+        if (axis > 1 || (axis == 0 ? indices.get_columns() != a.get_columns() : indices.get_rows() != a.get_rows())) {
 
-            if (ret != 0) {
+            throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+        }
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+        size_t rows = indices.get_rows(), columns = indices.get_columns();
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        //the kernel reads the indices row-major, views of them are packed first
+        std::vector<int> packed;
+        const int* items = indices.get_matrix();
 
-            result.set_matrix(output_final);
+        if (!indices.is_contiguous()) {
 
-            delete[] output_a;
-            delete[] output_b;
+            packed.resize(rows * columns);
 
-            return result;
-        }
-        catch (MatrixStatus& status) {
+            for (size_t i = 0; i < rows; i++)
+                for (size_t j = 0; j < columns; j++)
+                    packed[i * columns + j] = indices.get_element(i, j);
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
+            items = packed.data();
         }
+
+        check_indices(items, rows * columns, axis == 0 ? a.get_rows() : a.get_columns());
+
+        return gather(a, axis == 0 ? 2 : 3, items, rows * columns, rows, columns);
     }
 
-    Matrix operator<(Matrix& first, Matrix const& second) {
+    void scatter_add(Matrix& target, const std::vector<int>& indices, Matrix updates) {
 
-        try {
+        TraceSpan span("scatter_add");
 
-            cl_int ret;
+        size_t rows = target.get_rows(), columns = target.get_columns();
 
-            float* output_a = nullptr, * output_b = nullptr;
-            long long int columns_highest = 0, rows_highest = 0;
+        if (updates.get_rows() != indices.size() || updates.get_columns() != columns) {
 
-            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+            throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+        }
 
-            if (flag == 0) {
+        check_indices(indices.data(), indices.size(), rows);
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
-            else {
+        if (indices.empty() || columns == 0)
+            return;
 
-                output_a = new float[rows_highest * columns_highest];
-                output_b = new float[rows_highest * columns_highest];
-            }
+        //the updates grouped by the row they add to, so every row of the target is written by one
+        //work-item or thread and repeated indices accumulate in the order they are given
+        std::vector<int> offsets(rows + 1, 0), targets, starts(1, 0), order(indices.size());
 
-            flag = broadcast2(&first, &second, output_a, output_b, flag);
+        for (int index : indices)
+            offsets[index + 1]++;
 
-            if (flag == 0) {
+        for (size_t i = 0; i < rows; i++) {
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
+            if (offsets[i + 1] > 0) {
+
+                targets.push_back((int)i);
+                starts.push_back(starts.back() + offsets[i + 1]);
             }
 
-            Matrix result(rows_highest, columns_highest);
+            offsets[i + 1] += offsets[i];
+        }
 
-            cl_mem memory_input_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_input_b = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float), CL_MEM_WRITE_ONLY);
+        for (size_t i = 0; i < indices.size(); i++)
+            order[offsets[indices[i]]++] = (int)i;
 
-            enqueue_write(memory_input_a, rows_highest * columns_highest * sizeof(float), output_a);
-            enqueue_write(memory_input_b, rows_highest * columns_highest * sizeof(float), output_b);
+        size_t groups = targets.size();
 
-            set_argument(kernel_lt, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(kernel_lt, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(kernel_lt, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        if (!gather_on_device() || !target.is_contiguous()) {
 
-            size_t global_work_size = rows_highest * columns_highest;
-            size_t local_work_size = 1;
+            float* destination = target.get_matrix();
+            const float* source = updates.get_matrix();
 
-            ret = clEnqueueNDRangeKernel(queue, kernel_lt, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+            parallel_rows(groups, columns * sizeof(float), [&](size_t begin, size_t end) {
 
-            if (ret != 0) {
+                for (size_t g = begin; g < end; g++) {
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+                    float* row = destination + targets[g] * target.get_row_stride();
 
-            synchronize();
+                    for (size_t j = 0; j < columns; j++) {
 
-            auto* output_final = new float[rows_highest * columns_highest];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      rows_highest * columns_highest * sizeof(float), output_final, 0, nullptr, nullptr);
+                        float sum = 0.0f;
 
-            if (ret != 0) {
+                        for (int k = starts[g]; k < starts[g + 1]; k++)
+                            sum += source[order[k] * updates.get_row_stride() + j * updates.get_column_step()];
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+                        row[j * target.get_column_step()] += sum;
+                    }
+                }
+            });
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+            return;
+        }
 
-            result.set_matrix(output_final);
+        cl_mem memory_targets = input_buffer(targets.data(), groups * sizeof(int));
+        cl_mem memory_starts = input_buffer(starts.data(), (groups + 1) * sizeof(int));
+        cl_mem memory_order = input_buffer(order.data(), order.size() * sizeof(int));
+        cl_mem memory_updates = input_buffer(updates);
+        cl_mem memory_target = host_buffer(target.get_matrix(), rows * columns * sizeof(float), CL_MEM_READ_WRITE);
 
-            delete[] output_a;
-            delete[] output_b;
+        int N = (int)columns;
 
-            return result;
-        }
-        catch (MatrixStatus& status) {
+        set_argument(scatter_kernel_add, 0, (void*)&N);
+        set_argument(scatter_kernel_add, 1, (void*)&memory_targets, sizeof(cl_mem));
+        set_argument(scatter_kernel_add, 2, (void*)&memory_starts, sizeof(cl_mem));
+        set_argument(scatter_kernel_add, 3, (void*)&memory_order, sizeof(cl_mem));
+        set_argument(scatter_kernel_add, 4, (void*)&memory_updates, sizeof(cl_mem));
+        set_argument(scatter_kernel_add, 5, (void*)&memory_target, sizeof(cl_mem));
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
-        }
+        const size_t global_work_size[2] = { groups, columns };
+        enqueue_kernel(scatter_kernel_add, 2, global_work_size);
+
+        synchronize();
+
+        finish_output(memory_target, target.get_matrix(), rows * columns * sizeof(float));
+
+        release(memory_targets);
+        release(memory_starts);
+        release(memory_order);
+        release(memory_updates);
+        release(memory_target);
     }
 
-    Matrix operator==(Matrix& first, Matrix const& second) {
+    //the element type macros that specialise typedKernelCode() for one element type
+    std::string typedKernelPreamble(DType dtype) {
 
-        try {
+        switch (dtype) {
 
-            cl_int ret;
+            case DType::Float64:
+                return "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
+                       "#define ELEMENT double\n#define ACCUMULATOR double\n"
+                       "#define LOAD(p, i) (p)[i]\n#define STORE(p, i, v) (p)[i] = (v)\n";
 
-            float* output_a = nullptr, * output_b = nullptr;
-            long long int columns_highest = 0, rows_highest = 0;
+            case DType::Int32:
+                return "#define ELEMENT int\n#define ACCUMULATOR int\n"
+                       "#define LOAD(p, i) (p)[i]\n#define STORE(p, i, v) (p)[i] = (v)\n";
 
-            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+            case DType::Int8:
+                return "#define ELEMENT char\n#define ACCUMULATOR int\n"
+                       "#define LOAD(p, i) (p)[i]\n#define STORE(p, i, v) (p)[i] = convert_char_sat(v)\n";
 
-            if (flag == 0) {
+            case DType::Float16:
+                return "#define ELEMENT half\n#define ACCUMULATOR float\n"
+                       "#define LOAD(p, i) vload_half(i, p)\n#define STORE(p, i, v) vstore_half(v, i, p)\n";
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
-            else {
+            default:
+                return "#define ELEMENT float\n#define ACCUMULATOR float\n"
+                       "#define LOAD(p, i) (p)[i]\n#define STORE(p, i, v) (p)[i] = (v)\n";
+        }
+    }
 
-                output_a = new float[rows_highest * columns_highest];
-                output_b = new float[rows_highest * columns_highest];
-            }
+    //kernels of the typed operations, written against the ELEMENT, ACCUMULATOR, LOAD and STORE macros
+    std::string typedKernelCode(DType dtype) {
 
-            flag = broadcast2(&first, &second, output_a, output_b, flag);
+        return typedKernelPreamble(dtype) +
+               "kernel void typed_adder(const global ELEMENT* a, const global ELEMENT* b, global ELEMENT* results) {      const int i = get_global_id(0);      STORE(results, i, LOAD(a, i) + LOAD(b, i));  }  "
+               "kernel void typed_subtracter(const global ELEMENT* a, const global ELEMENT* b, global ELEMENT* results) {      const int i = get_global_id(0);      STORE(results, i, LOAD(a, i) - LOAD(b, i));  }  "
+               "kernel void typed_multiplier(const global ELEMENT* a, const global ELEMENT* b, global ELEMENT* results) {      const int i = get_global_id(0);      STORE(results, i, LOAD(a, i) * LOAD(b, i));  }  "
+               "kernel void typed_matrix_multiply(const int M, const int N, const int K, const global ELEMENT* A, const global ELEMENT* B, global ELEMENT* C) {      const int row = get_global_id(0);      const int col = get_global_id(1);        ACCUMULATOR sum = 0;      for (int k=0; k<K; k++) {          sum += (ACCUMULATOR)LOAD(A, row*K + k) * (ACCUMULATOR)LOAD(B, k*N + col);      }        STORE(C, row*N + col, sum);  }  "
+               "kernel void typed_transpose(const int M, const int N, const global ELEMENT* A, global ELEMENT* B) {      const int row = get_global_id(0);      const int col = get_global_id(1);        STORE(B, col*M + row, LOAD(A, row*N + col));  }  ";
+    }
 
-            if (flag == 0) {
+    //builds the program of an element type the first time one of its operations runs
+    TypedProgram& typed_program(DType dtype) {
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
+        auto found = typed_programs.find(dtype);
 
-            Matrix result(rows_highest, columns_highest);
+        if (found != typed_programs.end())
+            return found->second;
 
-            cl_mem memory_input_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_input_b = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float), CL_MEM_WRITE_ONLY);
+        cl_int ret;
+        TypedProgram typed{};
 
-            enqueue_write(memory_input_a, rows_highest * columns_highest * sizeof(float), output_a);
-            enqueue_write(memory_input_b, rows_highest * columns_highest * sizeof(float), output_b);
+        std::string source = typedKernelCode(dtype);
+        const char* source_code = source.c_str();
+        size_t source_size = source.size();
 
-            set_argument(kernel_equals, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(kernel_equals, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(kernel_equals, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        typed.program = clCreateProgramWithSource(context, 1, &source_code, &source_size, &ret);
 
-            size_t global_work_size = rows_highest * columns_highest;
-            size_t local_work_size = 1;
+        if (ret != 0) {
 
-            ret = clEnqueueNDRangeKernel(queue, kernel_equals, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+            throw MatrixStatus("Error creating kernel program from source.", 99);
+        }
 
-            if (ret != 0) {
+        ret = clBuildProgram(typed.program, 1, &deviceId, nullptr, nullptr, nullptr);
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+        if (ret != 0) {
 
-            synchronize();
+            clReleaseProgram(typed.program);
+            throw MatrixStatus("Error building kernel program. (Element type not supported by the device)", 100);
+        }
+
+        cl_kernel* kernels[5] = { &typed.add, &typed.subtract, &typed.multiply, &typed.multiply_matrix,
+                                  &typed.transpose };
+        const char* names[5] = { "typed_adder", "typed_subtracter", "typed_multiplier", "typed_matrix_multiply",
+                                 "typed_transpose" };
 
-            auto* output_final = new float[rows_highest * columns_highest];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      rows_highest * columns_highest * sizeof(float), output_final, 0, nullptr, nullptr);
+        for (int i = 0; i < 5; i++) {
+
+            *kernels[i] = clCreateKernel(typed.program, names[i], &ret);
 
             if (ret != 0) {
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
+                for (int created = 0; created < i; created++)
+                    clReleaseKernel(*kernels[created]);
+
+                clReleaseProgram(typed.program);
+                throw MatrixStatus("Error creating kernel program. (Typed Operations)", 101);
             }
+        }
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        return typed_programs[dtype] = typed;
+    }
 
-            result.set_matrix(output_final);
+    template<typename T>
+    BasicMatrix<T> typed_elementwise(cl_kernel kernel, BasicMatrix<T>& first, BasicMatrix<T> const& second) {
 
-            delete[] output_a;
-            delete[] output_b;
+        if (first.get_rows() != second.get_rows() || first.get_columns() != second.get_columns()) {
 
-            return result;
+            throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
         }
-        catch (MatrixStatus& status) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
-        }
-    }
+        size_t size = first.get_rows() * first.get_columns();
+        BasicMatrix<T> result(first.get_rows(), first.get_columns());
 
-    Matrix operator>=(Matrix& first, Matrix const& second) {
+        if (size == 0)
+            return result;
 
-        try {
+        cl_mem memory_input_a = get_memory_buffer(size * sizeof(T));
+        cl_mem memory_input_b = get_memory_buffer(size * sizeof(T));
+        cl_mem memory_output_a = get_memory_buffer(size * sizeof(T), CL_MEM_WRITE_ONLY);
 
-            cl_int ret;
+        write_view(queue, memory_input_a, first);
+        write_view(queue, memory_input_b, second);
 
-            float* output_a = nullptr, * output_b = nullptr;
-            long long int columns_highest = 0, rows_highest = 0;
+        set_argument(kernel, 0, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(kernel, 1, (void*)&memory_input_b, sizeof(cl_mem));
+        set_argument(kernel, 2, (void*)&memory_output_a, sizeof(cl_mem));
 
-            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+        enqueue_kernel(kernel, 1, &size);
 
-            if (flag == 0) {
+        synchronize();
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
-            else {
+        enqueue_read_bytes(memory_output_a, size * sizeof(T), result.get_matrix());
 
-                output_a = new float[rows_highest * columns_highest];
-                output_b = new float[rows_highest * columns_highest];
-            }
+        release(memory_input_a);
+        release(memory_input_b);
+        release(memory_output_a);
 
-            flag = broadcast2(&first, &second, output_a, output_b, flag);
+        return result;
+    }
 
-            if (flag == 0) {
+    template<typename T>
+    BasicMatrix<T> operator+(BasicMatrix<T>& first, BasicMatrix<T> const& second) {
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
+        return typed_elementwise(typed_program(DTypeOf<T>::value).add, first, second);
+    }
 
-            Matrix result(rows_highest, columns_highest);
+    template<typename T>
+    BasicMatrix<T> operator-(BasicMatrix<T>& first, BasicMatrix<T> const& second) {
 
-            cl_mem memory_input_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_input_b = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float), CL_MEM_WRITE_ONLY);
+        return typed_elementwise(typed_program(DTypeOf<T>::value).subtract, first, second);
+    }
 
-            enqueue_write(memory_input_a, rows_highest * columns_highest * sizeof(float), output_a);
-            enqueue_write(memory_input_b, rows_highest * columns_highest * sizeof(float), output_b);
+    template<typename T>
+    BasicMatrix<T> operator*(BasicMatrix<T>& first, BasicMatrix<T> const& second) {
 
-            set_argument(kernel_gte, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(kernel_gte, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(kernel_gte, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        return typed_elementwise(typed_program(DTypeOf<T>::value).multiply, first, second);
+    }
 
-            size_t global_work_size = rows_highest * columns_highest;
-            size_t local_work_size = 1;
+    template<typename T>
+    BasicMatrix<T> matmul(BasicMatrix<T> a, BasicMatrix<T> b) {
 
-            ret = clEnqueueNDRangeKernel(queue, kernel_gte, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+        if (a.get_columns() != b.get_rows()) {
 
-            if (ret != 0) {
+            throw MatrixStatus("Matrix dimensions are unmatchable for the product.", 21);
+        }
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+        cl_kernel kernel = typed_program(DTypeOf<T>::value).multiply_matrix;
+        BasicMatrix<T> result(a.get_rows(), b.get_columns());
 
-            synchronize();
+        if (a.get_rows() == 0 || b.get_columns() == 0)
+            return result;
 
-            auto* output_final = new float[rows_highest * columns_highest];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      rows_highest * columns_highest * sizeof(float), output_final, 0, nullptr, nullptr);
+        size_t size_a = std::max(a.get_rows() * a.get_columns(), (size_t)1) * sizeof(T);
+        size_t size_b = std::max(b.get_rows() * b.get_columns(), (size_t)1) * sizeof(T);
+        size_t size_c = a.get_rows() * b.get_columns() * sizeof(T);
 
-            if (ret != 0) {
+        cl_mem memory_input_a = get_memory_buffer(size_a);
+        cl_mem memory_input_b = get_memory_buffer(size_b);
+        cl_mem memory_output_a = get_memory_buffer(size_c, CL_MEM_WRITE_ONLY);
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+        write_view(queue, memory_input_a, a);
+        write_view(queue, memory_input_b, b);
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        int args[3] = { (int)a.get_rows(), (int)b.get_columns(), (int)a.get_columns() };
 
-            result.set_matrix(output_final);
+        set_argument(kernel, 0, (void*)&args[0]);
+        set_argument(kernel, 1, (void*)&args[1]);
+        set_argument(kernel, 2, (void*)&args[2]);
+        set_argument(kernel, 3, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(kernel, 4, (void*)&memory_input_b, sizeof(cl_mem));
+        set_argument(kernel, 5, (void*)&memory_output_a, sizeof(cl_mem));
 
-            delete[] output_a;
-            delete[] output_b;
+        const size_t global_work_size[2] = { a.get_rows(), b.get_columns() };
+        enqueue_kernel(kernel, 2, global_work_size);
 
-            return result;
-        }
-        catch (MatrixStatus& status) {
+        synchronize();
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
-        }
-    }
+        enqueue_read_bytes(memory_output_a, size_c, result.get_matrix());
 
-    Matrix operator<=(Matrix& first, Matrix const& second) {
+        release(memory_input_a);
+        release(memory_input_b);
+        release(memory_output_a);
 
-        try {
+        return result;
+    }
 
-            cl_int ret;
+    template<typename T>
+    BasicMatrix<T> transpose(BasicMatrix<T> a) {
 
-            float* output_a = nullptr, * output_b = nullptr;
-            long long int columns_highest = 0, rows_highest = 0;
+        cl_kernel kernel = typed_program(DTypeOf<T>::value).transpose;
+        size_t size = a.get_rows() * a.get_columns() * sizeof(T);
 
-            int flag = is_broadcast_possible(&first, &second, &columns_highest, &rows_highest);
+        BasicMatrix<T> result(a.get_columns(), a.get_rows());
 
-            if (flag == 0) {
+        if (size == 0)
+            return result;
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
-            else {
+        cl_mem memory_input_a = get_memory_buffer(size);
+        cl_mem memory_output_a = get_memory_buffer(size, CL_MEM_WRITE_ONLY);
 
-                output_a = new float[rows_highest * columns_highest];
-                output_b = new float[rows_highest * columns_highest];
-            }
+        write_view(queue, memory_input_a, a);
 
-            flag = broadcast2(&first, &second, output_a, output_b, flag);
+        int args[2] = { (int)a.get_rows(), (int)a.get_columns() };
 
-            if (flag == 0) {
+        set_argument(kernel, 0, (void*)&args[0]);
+        set_argument(kernel, 1, (void*)&args[1]);
+        set_argument(kernel, 2, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(kernel, 3, (void*)&memory_output_a, sizeof(cl_mem));
 
-                throw MatrixStatus("Matrix Dimensions are unmatchable and could not be broad-casted.", 10);
-            }
+        const size_t global_work_size[2] = { a.get_rows(), a.get_columns() };
+        enqueue_kernel(kernel, 2, global_work_size);
 
-            Matrix result(rows_highest, columns_highest);
+        synchronize();
 
-            cl_mem memory_input_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_input_b = get_memory_buffer(rows_highest * columns_highest * sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(rows_highest * columns_highest * sizeof(float), CL_MEM_WRITE_ONLY);
+        enqueue_read_bytes(memory_output_a, size, result.get_matrix());
 
-            enqueue_write(memory_input_a, rows_highest * columns_highest * sizeof(float), output_a);
-            enqueue_write(memory_input_b, rows_highest * columns_highest * sizeof(float), output_b);
+        release(memory_input_a);
+        release(memory_output_a);
 
-            set_argument(kernel_lte, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(kernel_lte, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(kernel_lte, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        return result;
+    }
 
-            size_t global_work_size = rows_highest * columns_highest;
-            size_t local_work_size = 1;
+    //floating point targets narrow like a static_cast
+    template<typename To>
+    To convert_element(double value, std::false_type) {
 
-            ret = clEnqueueNDRangeKernel(queue, kernel_lte, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+        return (To)value;
+    }
 
-            if (ret != 0) {
+    //integer targets saturate and take NaN to zero, a plain cast of an unrepresentable value is undefined
+    template<typename To>
+    To convert_element(double value, std::true_type) {
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+        if (value != value)
+            return 0;
 
-            synchronize();
+        if (value <= (double)std::numeric_limits<To>::min())
+            return std::numeric_limits<To>::min();
 
-            auto* output_final = new float[rows_highest * columns_highest];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      rows_highest * columns_highest * sizeof(float), output_final, 0, nullptr, nullptr);
+        if (value >= (double)std::numeric_limits<To>::max())
+            return std::numeric_limits<To>::max();
 
-            if (ret != 0) {
+        return (To)value;
+    }
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+    template<typename To, typename From>
+    BasicMatrix<To> astype(BasicMatrix<From> a) {
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        BasicMatrix<To> result(a.get_rows(), a.get_columns());
 
-            result.set_matrix(output_final);
+        //every element type converts exactly to double, which then narrows to the target
+        for (size_t i = 0; i < a.get_rows(); i++)
+            for (size_t j = 0; j < a.get_columns(); j++)
+                result.set_element(i, j, convert_element<To>((double)a.get_element(i, j), std::is_integral<To>()));
 
-            delete[] output_a;
-            delete[] output_b;
+        return result;
+    }
 
-            return result;
+    #define NUMCPP_TYPED_OPERATIONS(T) \
+        template BasicMatrix<T> operator+(BasicMatrix<T>& first, BasicMatrix<T> const& second); \
+        template BasicMatrix<T> operator-(BasicMatrix<T>& first, BasicMatrix<T> const& second); \
+        template BasicMatrix<T> operator*(BasicMatrix<T>& first, BasicMatrix<T> const& second); \
+        template BasicMatrix<T> matmul(BasicMatrix<T> a, BasicMatrix<T> b); \
+        template BasicMatrix<T> transpose(BasicMatrix<T> a);
+
+    NUMCPP_TYPED_OPERATIONS(double)
+    NUMCPP_TYPED_OPERATIONS(int32_t)
+    NUMCPP_TYPED_OPERATIONS(int8_t)
+    NUMCPP_TYPED_OPERATIONS(half)
+
+    #define NUMCPP_TYPED_CONVERSIONS(From) \
+        template BasicMatrix<float> astype(BasicMatrix<From> a); \
+        template BasicMatrix<double> astype(BasicMatrix<From> a); \
+        template BasicMatrix<int32_t> astype(BasicMatrix<From> a); \
+        template BasicMatrix<int8_t> astype(BasicMatrix<From> a); \
+        template BasicMatrix<half> astype(BasicMatrix<From> a);
+
+    NUMCPP_TYPED_CONVERSIONS(float)
+    NUMCPP_TYPED_CONVERSIONS(double)
+    NUMCPP_TYPED_CONVERSIONS(int32_t)
+    NUMCPP_TYPED_CONVERSIONS(int8_t)
+    NUMCPP_TYPED_CONVERSIONS(half)
+
+    //unary element-wise functions of x, each becomes a kernel named parallel_<name>
+    const char* const math_functions[][2] = {
+            { "exp", "exp(x)" },
+            { "log", "log(x)" },
+            { "log1p", "log1p(x)" },
+            { "sqrt", "sqrt(x)" },
+            { "rsqrt", "rsqrt(x)" },
+            { "abs", "fabs(x)" },
+            { "sin", "sin(x)" },
+            { "cos", "cos(x)" },
+            { "tanh", "tanh(x)" },
+            { "sigmoid", "1.0f / (1.0f + exp(-x))" },
+            { "relu", "fmax(x, 0.0f)" },
+            { "erf", "erf(x)" }
+    };
+
+    std::string mathKernelCode() {
+
+        std::string source;
+
+        for (auto& function : math_functions) {
+
+            source += std::string("kernel void parallel_") + function[0] + "(const global float* a, global float* results) {      const int i = get_global_id(0);      const float x = a[i];      results[i] = " + function[1] + ";  }  ";
         }
-        catch (MatrixStatus& status) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
-        }
+        return source + "kernel void parallel_clip(const float low, const float high, const global float* a, global float* results) {      const int i = get_global_id(0);      results[i] = clamp(a[i], low, high);  }  ";
     }
 
-//Scalar Operations
+    //builds the math program for the current fast math setting the first time a math function runs with it
+    MathProgram& math_program() {
 
-    Matrix operator*(Matrix& first, float const& second) {
+        auto found = math_programs.find(fast_math_enabled);
 
-        try {
+        if (found != math_programs.end())
+            return found->second;
 
-            cl_int ret;
+        cl_int ret;
+        MathProgram math{};
+
+        std::string source = mathKernelCode();
+        const char* source_code = source.c_str();
+        size_t source_size = source.size();
+
+        math.program = clCreateProgramWithSource(context, 1, &source_code, &source_size, &ret);
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error creating kernel program from source.", 99);
+        }
+
+        ret = clBuildProgram(math.program, 1, &deviceId, fast_math_enabled ? "-cl-fast-relaxed-math" : nullptr,
+                             nullptr, nullptr);
+
+        if (ret != 0) {
+
+            clReleaseProgram(math.program);
+            throw MatrixStatus("Error building kernel program.", 100);
+        }
+
+        std::vector<std::string> names;
+
+        for (auto& function : math_functions)
+            names.push_back(function[0]);
+
+        names.push_back("clip");
 
-            Matrix result(first.get_rows(), first.get_columns());
+        for (auto& name : names) {
 
-            cl_mem memory_input_a = clCreateBuffer(context, CL_MEM_READ_ONLY,
-                                                   first.get_rows() * first.get_columns() * sizeof(float), nullptr, &ret);
+            cl_kernel kernel = clCreateKernel(math.program, ("parallel_" + name).c_str(), &ret);
 
             if (ret != 0) {
 
-                throw MatrixStatus("Memory buffer could not be created.", 92);
+                for (auto& created : math.kernels)
+                    clReleaseKernel(created.second);
+
+                clReleaseProgram(math.program);
+                throw MatrixStatus("Error creating kernel program. (Math Functions)", 101);
             }
 
-            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(first.get_rows() * first.get_columns() * sizeof(float), CL_MEM_WRITE_ONLY);
+            math.kernels[name] = kernel;
+        }
 
-            enqueue_write(memory_input_a, first);
-            enqueue_write(memory_input_b, second);
+        return math_programs[fast_math_enabled] = math;
+    }
 
-            set_argument(scalar_kernel_multiply, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(scalar_kernel_multiply, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(scalar_kernel_multiply, 2, (void*)&memory_output_a, sizeof(cl_mem));
+    void set_fast_math(bool enabled) {
 
-            size_t global_work_size = first.get_columns() * first.get_rows();
-            size_t local_work_size = 1;
+        fast_math_enabled = enabled;
+    }
 
-            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_multiply, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+    void set_pinned_memory(bool enabled) {
 
-            if (ret != 0) {
+        pinned_enabled = enabled;
+    }
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+    bool is_zero_copy() {
 
-            synchronize();
+        return unified_memory == CL_TRUE;
+    }
 
-            auto* output_final = new float[first.get_columns() * first.get_rows()];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      first.get_columns() * first.get_rows() * sizeof(float), output_final, 0, nullptr, nullptr);
+    //runs one math kernel over every element of a, `arguments` holds the scalar arguments that precede the buffers
+    Matrix apply_math(const char* name, Matrix a, const std::vector<float>& arguments = {}) {
 
-            if (ret != 0) {
+        TraceSpan span(name);
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+        cl_kernel kernel = math_program().kernels[name];
+        size_t size = a.get_rows() * a.get_columns();
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        Matrix result(a.get_rows(), a.get_columns());
 
-            result.set_matrix(output_final);
+        if (size == 0)
             return result;
-        }
-        catch (MatrixStatus& status) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
-        }
-    }
+        cl_mem memory_input_a = get_memory_buffer(size * sizeof(float));
+        cl_mem memory_output_a = get_memory_buffer(size * sizeof(float), CL_MEM_WRITE_ONLY);
 
-    Matrix operator>(Matrix& first, float const& second) {
+        enqueue_write(memory_input_a, a);
 
-        try {
+        int position = 0;
 
-            cl_int ret;
+        for (const float& argument : arguments)
+            set_argument(kernel, position++, (void*)&argument, sizeof(float));
 
-            Matrix result(first.get_rows(), first.get_columns());
+        set_argument(kernel, position, (void*)&memory_input_a, sizeof(cl_mem));
+        set_argument(kernel, position + 1, (void*)&memory_output_a, sizeof(cl_mem));
 
-            cl_mem memory_input_a = clCreateBuffer(context, CL_MEM_READ_ONLY,
-                                                   first.get_rows() * first.get_columns() * sizeof(float), nullptr, &ret);
+        enqueue_kernel(kernel, 1, &size);
 
-            if (ret != 0) {
+        synchronize();
 
-                throw MatrixStatus("Memory buffer could not be created.", 92);
-            }
+        enqueue_read(memory_output_a, size * sizeof(float), result.get_matrix());
 
-            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(first.get_rows() * first.get_columns() * sizeof(float), CL_MEM_WRITE_ONLY);
+        release(memory_input_a);
+        release(memory_output_a);
 
-            enqueue_write(memory_input_a, first);
-            enqueue_write(memory_input_b, second);
+        return result;
+    }
 
-            set_argument(scalar_kernel_gt, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(scalar_kernel_gt, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(scalar_kernel_gt, 2, (void*)&memory_output_a, sizeof(cl_mem));
+    Matrix exp(Matrix a) {
 
-            size_t global_work_size = first.get_columns() * first.get_rows();
-            size_t local_work_size = 1;
+        return apply_math("exp", a);
+    }
 
-            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_gt, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+    Matrix log(Matrix a) {
 
-            if (ret != 0) {
+        return apply_math("log", a);
+    }
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+    Matrix log1p(Matrix a) {
 
-            synchronize();
+        return apply_math("log1p", a);
+    }
 
-            auto* output_final = new float[first.get_columns() * first.get_rows()];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      first.get_columns() * first.get_rows() * sizeof(float), output_final, 0, nullptr, nullptr);
+    Matrix sqrt(Matrix a) {
 
-            if (ret != 0) {
+        return apply_math("sqrt", a);
+    }
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+    Matrix rsqrt(Matrix a) {
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        return apply_math("rsqrt", a);
+    }
 
-            result.set_matrix(output_final);
-            return result;
-        }
-        catch (MatrixStatus& status) {
+    Matrix abs(Matrix a) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
-        }
+        return apply_math("abs", a);
     }
 
-    Matrix operator<(Matrix& first, float const& second) {
+    Matrix sin(Matrix a) {
 
-        try {
+        return apply_math("sin", a);
+    }
 
-            cl_int ret;
+    Matrix cos(Matrix a) {
 
-            Matrix result(first.get_rows(), first.get_columns());
+        return apply_math("cos", a);
+    }
 
-            cl_mem memory_input_a = clCreateBuffer(context, CL_MEM_READ_ONLY,
-                                                   first.get_rows() * first.get_columns() * sizeof(float), nullptr, &ret);
+    Matrix tanh(Matrix a) {
 
-            if (ret != 0) {
+        return apply_math("tanh", a);
+    }
 
-                throw MatrixStatus("Memory buffer could not be created.", 92);
-            }
+    Matrix sigmoid(Matrix a) {
 
-            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(first.get_rows() * first.get_columns() * sizeof(float), CL_MEM_WRITE_ONLY);
+        return apply_math("sigmoid", a);
+    }
 
-            enqueue_write(memory_input_a, first);
-            enqueue_write(memory_input_b, second);
+    Matrix relu(Matrix a) {
 
-            set_argument(scalar_kernel_lt, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(scalar_kernel_lt, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(scalar_kernel_lt, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        return apply_math("relu", a);
+    }
 
-            size_t global_work_size = first.get_columns() * first.get_rows();
-            size_t local_work_size = 1;
+    Matrix erf(Matrix a) {
 
-            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_lt, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+        return apply_math("erf", a);
+    }
 
-            if (ret != 0) {
+    Matrix clip(Matrix a, float low, float high) {
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+        return apply_math("clip", a, { low, high });
+    }
 
-            synchronize();
+    std::string kernelCode() {
+        return "kernel void parallel_adder(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] + b[i];  }    kernel void parallel_subtracter(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] - b[i];  }    kernel void parallel_multiplier(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] * b[i];  }    kernel void parallel_gt(global float* a, global float* b, global uchar* results) {      long long int i = get_global_id(0);      results[i] = a[i] > b[i];  }    kernel void parallel_lt(global float* a, global float* b, global uchar* results) {      long long int i = get_global_id(0);      results[i] = a[i] < b[i];  }    kernel void parallel_equals(global float* a, global float* b, global uchar* results) {      long long int i = get_global_id(0);      results[i] = a[i] == b[i];  }    kernel void parallel_gte(global float* a, global float* b, global uchar* results) {      long long int i = get_global_id(0);      results[i] = a[i] >= b[i];  }    kernel void parallel_lte(global float* a, global float* b, global uchar* results) {      long long int i = get_global_id(0);      results[i] = a[i] <= b[i];  }    kernel void scalar_parallel_multiplier(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] * b[0];  }    kernel void scalar_parallel_gt(global float* a, global float* b, global uchar* results) {      long long int i = get_global_id(0);      results[i] = a[i] > b[0];  }    kernel void scalar_parallel_lt(global float* a, global float* b, global uchar* results) {      long long int i = get_global_id(0);      results[i] = a[i] < b[0];  }    kernel void scalar_parallel_equals(global float* a, global float* b, global uchar* results) {      long long int i = get_global_id(0);      results[i] = a[i] == b[0];  }    kernel void scalar_parallel_gte(global float* a, global float* b, global uchar* results) {      long long int i = get_global_id(0);      results[i] = a[i] >= b[0];  }    kernel void scalar_parallel_lte(global float* a, global float* b, global uchar* results) {      long long int i = get_global_id(0);      results[i] = a[i] <= b[0];  }    kernel void scalar_parallel_power(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = pow(a[i],b[0]);  }    kernel void scalar_parallel_adder(global float* a, global float* b, global float* col_size, global float* results) {      int i = get_global_id(0);        int r = i/(int)col_size[0];      int c = i%(int)col_size[0];        results[i] = a[i];        if(r==c)          results[i] = results[i] + b[0];  }    kernel void scalar_parallel_subtracter(global float* a, global float* b, global float* col_size, global float* results) {      int i = get_global_id(0);        int r = i/(int)col_size[0];      int c = i%(int)col_size[0];        results[i] = a[i];        if(r==c)          results[i] = results[i] - b[0];  }    kernel void parallel_matrix_multiply(const int M, const int N, const int K, const global float* A, const global float* B, global float* C) {            const int row = get_global_id(0);      const int col = get_global_id(1);        float sum = 0.0f;      for (int k=0; k<K; k++) {          sum += A[row*K + k] * B[k*N + col];      }        C[row*N + col] = sum;  }    kernel void parallel_transpose(const int M, const int N, const global float* A, global float* B) {            const int row = get_global_id(0);      const int col = get_global_id(1);        B[col*M + row] = A[row*N + col];  }  "
+               "kernel void parallel_gemm(const int M, const int N, const int K, const int trans_a, const int trans_b, const float alpha, const global float* A, const global float* B, const float beta, global float* C) {      const int row = get_global_id(0);      const int col = get_global_id(1);      const int a_step = trans_a ? M : 1;      const int b_step = trans_b ? 1 : N;      const global float* a = A + (trans_a ? row : row*K);      const global float* b = B + (trans_b ? col*K : col);        float sum = 0.0f;      for (int k=0; k<K; k++) {          sum += a[k*a_step] * b[k*b_step];      }        if (beta == 0.0f)          C[row*N + col] = alpha * sum;      else          C[row*N + col] = alpha * sum + beta * C[row*N + col];  }  "
+               "kernel void parallel_block_update(const int M, const int N, const int K, const global float* A, const int offset_a, const int lda, const global float* B, const int offset_b, const int ldb, global float* C, const int offset_c, const int ldc, const float alpha) {      const int row = get_global_id(0);      const int col = get_global_id(1);        if (row >= M || col >= N)          return;        float sum = 0.0f;      for (int k=0; k<K; k++) {          sum += A[offset_a + row*lda + k] * B[offset_b + k*ldb + col];      }        C[offset_c + row*ldc + col] += alpha * sum;  }  "
+               "kernel void parallel_swap_rows(const int N, const int start, const int count, const int skip_start, const int skip_count, const global int* pivots, global float* A) {      const int col = get_global_id(0);        if (col >= N || (col >= skip_start && col < skip_start + skip_count))          return;        for (int i=start; i<start+count; i++) {          const int p = pivots[i];          if (p != i) {              float temp = A[i*N + col];              A[i*N + col] = A[p*N + col];              A[p*N + col] = temp;          }      }  }  "
+               "kernel void parallel_lower_solve(const int N, const int K, const int unit, const global float* L, const int offset_l, const int ldl, global float* B, const int offset_b, const int ldb) {      const int col = get_global_id(0);        if (col >= N)          return;        for (int i=0; i<K; i++) {          float sum = B[offset_b + i*ldb + col];          for (int p=0; p<i; p++) {              sum -= L[offset_l + i*ldl + p] * B[offset_b + p*ldb + col];          }          B[offset_b + i*ldb + col] = unit ? sum : sum / L[offset_l + i*ldl + i];      }  }  "
+               "kernel void parallel_upper_solve(const int N, const int K, const int unit, const global float* U, const int offset_u, const int ldu, global float* B, const int offset_b, const int ldb) {      const int col = get_global_id(0);        if (col >= N)          return;        for (int i=K-1; i>=0; i--) {          float sum = B[offset_b + i*ldb + col];          for (int p=i+1; p<K; p++) {              sum -= U[offset_u + i*ldu + p] * B[offset_b + p*ldb + col];          }          B[offset_b + i*ldb + col] = unit ? sum : sum / U[offset_u + i*ldu + i];      }  }  "
+               "kernel void parallel_right_lower_solve(const int M, const int K, const global float* L, const int offset_l, const int ldl, global float* B, const int offset_b, const int ldb) {      const int row = get_global_id(0);        if (row >= M)          return;        for (int j=0; j<K; j++) {          float sum = B[offset_b + row*ldb + j];          for (int p=0; p<j; p++) {              sum -= B[offset_b + row*ldb + p] * L[offset_l + j*ldl + p];          }          B[offset_b + row*ldb + j] = sum / L[offset_l + j*ldl + j];      }  }  "
+               "kernel void parallel_block_symmetric_update(const int N, const int K, const global float* A, const int offset_a, const int lda, global float* C, const int offset_c, const int ldc) {      const int row = get_global_id(0);      const int col = get_global_id(1);        if (row >= N || col > row)          return;        float sum = 0.0f;      for (int k=0; k<K; k++) {          sum += A[offset_a + row*lda + k] * A[offset_a + col*lda + k];      }        C[offset_c + row*ldc + col] -= sum;  }  "
+               "kernel void parallel_gemv(const int M, const int N, const global float* A, const int offset_a, const int lda, const global float* x, global float* y, local float* partial) {      const int row = get_group_id(0);      const int lane = get_local_id(0);      const int lanes = get_local_size(0);      const global float* a = A + offset_a + row*lda;        float sum = 0.0f;      for (int k=lane; k<N; k+=lanes) {          sum += a[k] * x[k];      }        partial[lane] = sum;      barrier(CLK_LOCAL_MEM_FENCE);        for (int stride=lanes/2; stride>0; stride/=2) {          if (lane < stride)              partial[lane] += partial[lane + stride];          barrier(CLK_LOCAL_MEM_FENCE);      }        if (lane == 0)          y[row] = partial[0];  }  "
+               "kernel void parallel_symmetric_rank2_update(const int N, const global float* v, const global float* w, global float* A, const int offset_a, const int lda) {      const int row = get_global_id(0);      const int col = get_global_id(1);        if (row >= N || col >= N)          return;        A[offset_a + row*lda + col] -= v[row] * w[col] + w[row] * v[col];  }  "
+               "kernel void parallel_batched_lstsq(const int M, const int N, const int K, global float* A, global float* B, global float* X, global int* S) {      const int problem = get_global_id(0);      global float* a = A + (long)problem*M*N;      global float* b = B + (long)problem*M*K;      global float* x = X + (long)problem*N*K;        for (int j=0; j<N; j++) {          float alpha = a[j*N + j];          float sigma = 0.0f;          for (int i=j+1; i<M; i++) {              sigma += a[i*N + j] * a[i*N + j];          }            if (sigma == 0.0f)              continue;            float norm = sqrt(alpha*alpha + sigma);          float beta = alpha <= 0.0f ? norm : -norm;          float tau = (beta - alpha) / beta;          float scale = 1.0f / (alpha - beta);          for (int i=j+1; i<M; i++) {              a[i*N + j] *= scale;          }          a[j*N + j] = beta;            for (int c=j+1; c<N; c++) {              float w = a[j*N + c];              for (int i=j+1; i<M; i++) {                  w += a[i*N + j] * a[i*N + c];              }              a[j*N + c] -= tau * w;              for (int i=j+1; i<M; i++) {                  a[i*N + c] -= tau * a[i*N + j] * w;              }          }            for (int c=0; c<K; c++) {              float w = b[j*K + c];              for (int i=j+1; i<M; i++) {                  w += a[i*N + j] * b[i*K + c];              }              b[j*K + c] -= tau * w;              for (int i=j+1; i<M; i++) {                  b[i*K + c] -= tau * a[i*N + j] * w;              }          }      }        float largest = 0.0f;      for (int i=0; i<N; i++) {          largest = max(largest, fabs(a[i*N + i]));      }        S[problem] = 0;      for (int i=0; i<N; i++) {          if (fabs(a[i*N + i]) <= largest * N * FLT_EPSILON || largest == 0.0f) {              S[problem] = 1;              return;          }      }        for (int i=N-1; i>=0; i--) {          for (int c=0; c<K; c++) {              float sum = b[i*K + c];              for (int p=i+1; p<N; p++) {                  sum -= a[i*N + p] * x[p*K + c];              }              x[i*K + c] = sum / a[i*N + i];          }      }  }  "
+               "kernel void parallel_batched_matmul(const int M, const int N, const int K, const global float* A, const int stride_a, const global float* B, const int stride_b, global float* C) {      const int batch = get_global_id(0);      const int row = get_global_id(1);      const int col = get_global_id(2);      const global float* a = A + batch*stride_a + row*K;      const global float* b = B + batch*stride_b + col;        float sum = 0.0f;      for (int k=0; k<K; k++) {          sum += a[k] * b[k*N];      }        C[(batch*M + row)*N + col] = sum;  }  "
+               "kernel void parallel_spmv(const global int* P, const global int* J, const global float* V, const global float* x, global float* y) {      const int row = get_global_id(0);        float sum = 0.0f;      for (int k=P[row]; k<P[row+1]; k++) {          sum += V[k] * x[J[k]];      }        y[row] = sum;  }  "
+               "kernel void parallel_spmm(const int N, const global int* P, const global int* J, const global float* V, const global float* B, global float* C) {      const int row = get_global_id(0);      const int col = get_global_id(1);        float sum = 0.0f;      for (int k=P[row]; k<P[row+1]; k++) {          sum += V[k] * B[J[k]*N + col];      }        C[row*N + col] = sum;  }  "
+               "kernel void parallel_sparse_count(const int op, const global int* PA, const global int* JA, const global int* PB, const global int* JB, global int* counts) {      const int row = get_global_id(0);      const int union_pattern = op != 2;      int i = PA[row], j = PB[row], count = 0;        while (i < PA[row+1] && j < PB[row+1]) {          if (JA[i] == JB[j]) {              count++; i++; j++;          }          else if (JA[i] < JB[j]) {              count += union_pattern; i++;          }          else {              count += union_pattern; j++;          }      }        if (union_pattern)          count += (PA[row+1] - i) + (PB[row+1] - j);        counts[row] = count;  }  "
+               "kernel void parallel_sparse_merge(const int op, const global int* PA, const global int* JA, const global float* VA, const global int* PB, const global int* JB, const global float* VB, const global int* PC, global int* JC, global float* VC) {      const int row = get_global_id(0);      const int union_pattern = op != 2;      const float sign = op == 1 ? -1.0f : 1.0f;      int i = PA[row], j = PB[row], k = PC[row];        while (i < PA[row+1] && j < PB[row+1]) {          if (JA[i] == JB[j]) {              JC[k] = JA[i];              VC[k++] = op == 2 ? VA[i] * VB[j] : VA[i] + sign * VB[j];              i++; j++;          }          else if (JA[i] < JB[j]) {              if (union_pattern) {                  JC[k] = JA[i]; VC[k++] = VA[i];              }              i++;          }          else {              if (union_pattern) {                  JC[k] = JB[j]; VC[k++] = sign * VB[j];              }              j++;          }      }        if (union_pattern) {          for (; i < PA[row+1]; i++) {              JC[k] = JA[i]; VC[k++] = VA[i];          }          for (; j < PB[row+1]; j++) {              JC[k] = JB[j]; VC[k++] = sign * VB[j];          }      }  }  "
+               "kernel void parallel_dense_count(const int N, const global float* A, global int* counts) {      const int row = get_global_id(0);        int count = 0;      for (int col=0; col<N; col++) {          count += A[row*N + col] != 0.0f;      }        counts[row] = count;  }  "
+               "kernel void parallel_dense_compress(const int N, const global float* A, const global int* P, global int* J, global float* V) {      const int row = get_global_id(0);        int k = P[row];      for (int col=0; col<N; col++) {          if (A[row*N + col] != 0.0f) {              J[k] = col;              V[k++] = A[row*N + col];          }      }  }  "
+               "kernel void parallel_sparse_expand(const int N, const global int* P, const global int* J, const global float* V, global float* A) {      const int row = get_global_id(0);        for (int k=P[row]; k<P[row+1]; k++) {          A[row*N + J[k]] = V[k];      }  }  "
+               "kernel void parallel_mask_count(const int N, const int chunk, const global uchar* mask, global int* counts) {      const int start = get_global_id(0) * chunk;      const int end = min(start + chunk, N);        int count = 0;      for (int i=start; i<end; i++) {          count += mask[i] != 0;      }        counts[get_global_id(0)] = count;  }  "
+               "kernel void parallel_masked_select(const int N, const int chunk, const global float* A, const global uchar* mask, const global int* offsets, global float* out) {      const int start = get_global_id(0) * chunk;      const int end = min(start + chunk, N);        int k = offsets[get_global_id(0)];      for (int i=start; i<end; i++) {          if (mask[i] != 0)              out[k++] = A[i];      }  }  "
+               "kernel void parallel_gather(const int op, const int N, const int K, const global int* I, const global float* A, global float* out) {      const int row = get_global_id(0);      const int col = get_global_id(1);        int source;      if (op == 0)          source = I[row]*N + col;      else if (op == 1)          source = row*N + I[col];      else if (op == 2)          source = I[row*K + col]*N + col;      else          source = row*N + I[row*K + col];        out[row*K + col] = A[source];  }  "
+               "kernel void parallel_scatter_add(const int N, const global int* targets, const global int* starts, const global int* order, const global float* U, global float* A) {      const int group = get_global_id(0);      const int col = get_global_id(1);        float sum = 0.0f;      for (int k=starts[group]; k<starts[group+1]; k++) {          sum += U[order[k]*N + col];      }        A[targets[group]*N + col] += sum;  }  ";
+    }
 
-            auto* output_final = new float[first.get_columns() * first.get_rows()];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      first.get_columns() * first.get_rows() * sizeof(float), output_final, 0, nullptr, nullptr);
+    //creates the context and builds the program shared by all host threads
+    void init_context() {
 
-            if (ret != 0) {
+        cl_int retP, retD, retC, retQ, ret;
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+        retP = clGetPlatformIDs(1, &platformId, &ret_num_platforms);
+        retD = clGetDeviceIDs(platformId, CL_DEVICE_TYPE_DEFAULT, 1, &deviceId, nullptr);
+        retD |= clGetDeviceIDs(platformId, CL_DEVICE_TYPE_ALL, 0, nullptr, &ret_num_devices);
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        if ((retP != 0) || (retD != 0) || ret_num_devices == 0) {
 
-            result.set_matrix(output_final);
-            return result;
+            throw MatrixStatus("Error detecting OpenCL supported platform.", 91);
         }
-        catch (MatrixStatus& status) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
-        }
-    }
+        devices.assign(ret_num_devices, nullptr);
+        retD = clGetDeviceIDs(platformId, CL_DEVICE_TYPE_ALL, ret_num_devices, devices.data(), nullptr);
 
-    Matrix operator==(Matrix& first, float const& second) {
+        //the default device stays first, single-device operations run on it
+        auto primary = std::find(devices.begin(), devices.end(), deviceId);
 
-        try {
+        if (primary != devices.end())
+            std::iter_swap(devices.begin(), primary);
+        else
+            devices.insert(devices.begin(), deviceId);
 
-            cl_int ret;
+        device_weights.assign(devices.size(), 1);
 
-            Matrix result(first.get_rows(), first.get_columns());
+        for (size_t i = 0; i < devices.size(); i++) {
 
-            cl_mem memory_input_a = clCreateBuffer(context, CL_MEM_READ_ONLY,
-                                                   first.get_rows() * first.get_columns() * sizeof(float), nullptr, &ret);
+            cl_uint compute_units = 1, clock_frequency = 1;
 
-            if (ret != 0) {
+            retD |= clGetDeviceInfo(devices[i], CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &compute_units, nullptr);
+            retD |= clGetDeviceInfo(devices[i], CL_DEVICE_MAX_CLOCK_FREQUENCY, sizeof(cl_uint), &clock_frequency,
+                                    nullptr);
 
-                throw MatrixStatus("Memory buffer could not be created.", 92);
-            }
+            device_weights[i] = (double)compute_units * clock_frequency;
+        }
 
-            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(first.get_rows() * first.get_columns() * sizeof(float), CL_MEM_WRITE_ONLY);
+        context = clCreateContext(nullptr, devices.size(), devices.data(), nullptr, nullptr, &retC);
 
-            enqueue_write(memory_input_a, first);
-            enqueue_write(memory_input_b, second);
+        if ((retC != 0) || (retD != 0)) {
 
-            set_argument(scalar_kernel_equals, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(scalar_kernel_equals, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(scalar_kernel_equals, 2, (void*)&memory_output_a, sizeof(cl_mem));
+            throw MatrixStatus("Error detecting OpenCL supported platform.", 91);
+        }
 
-            size_t global_work_size = first.get_columns() * first.get_rows();
-            size_t local_work_size = 1;
+        retD = clGetDeviceInfo(deviceId, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &device_memory_size, nullptr);
 
-            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_equals, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+        //devices that cannot tell are treated as discrete
+        if (clGetDeviceInfo(deviceId, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(cl_bool), &unified_memory, nullptr) != 0)
+            unified_memory = CL_FALSE;
+        retQ = clGetDeviceInfo(deviceId, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &device_max_allocation,
+                               nullptr);
 
-            if (ret != 0) {
+        if ((retD != 0) || (retQ != 0)) {
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+            throw MatrixStatus("Error detecting OpenCL supported platform.", 91);
+        }
 
-            synchronize();
+        std::string source_str = kernelCode();
+        size_t source_size = source_str.size();
 
-            auto* output_final = new float[first.get_columns() * first.get_rows()];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      first.get_columns() * first.get_rows() * sizeof(float), output_final, 0, nullptr, nullptr);
+        program = clCreateProgramWithSource(context, 1, (const char**)&source_str, (const size_t*)&source_size, &ret);
 
-            if (ret != 0) {
+        if (ret != 0) {
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+            throw MatrixStatus("Error creating kernel program from source.", 99);
+        }
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        //each device is built on its own, one the program does not build for is left out of the split operations
+        std::vector<cl_device_id> built_devices;
+        std::vector<double> built_weights;
 
-            result.set_matrix(output_final);
-            return result;
+        for (size_t i = 0; i < devices.size(); i++) {
+
+            if (clBuildProgram(program, 1, &devices[i], nullptr, nullptr, nullptr) != 0)
+                continue;
+
+            built_devices.push_back(devices[i]);
+            built_weights.push_back(device_weights[i]);
         }
-        catch (MatrixStatus& status) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
+        if (built_devices.empty() || built_devices[0] != deviceId) {
+
+            clReleaseProgram(program);
+            throw MatrixStatus("Error building kernel program.", 100);
         }
-    }
 
-    Matrix operator>=(Matrix& first, float const& second) {
+        devices = built_devices;
+        device_weights = built_weights;
 
-        try {
+        //pinned storage is mapped on its own queue, matrices outlive the threads that create them
+        std::lock_guard<std::mutex> lock(pinned_mutex);
+        pinned_queue = clCreateCommandQueueWithProperties(context, deviceId, nullptr, &ret);
 
-            cl_int ret;
+        if (ret != 0) {
 
-            Matrix result(first.get_rows(), first.get_columns());
+            throw MatrixStatus("Error detecting OpenCL supported platform.", 91);
+        }
+    }
 
-            cl_mem memory_input_a = clCreateBuffer(context, CL_MEM_READ_ONLY,
-                                                   first.get_rows() * first.get_columns() * sizeof(float), nullptr, &ret);
+    cl_command_queue create_queue(cl_device_id device, bool profiling, cl_int* ret) {
 
-            if (ret != 0) {
+        const cl_queue_properties properties[] = { CL_QUEUE_PROPERTIES, CL_QUEUE_PROFILING_ENABLE, 0 };
 
-                throw MatrixStatus("Memory buffer could not be created.", 92);
-            }
+        return clCreateCommandQueueWithProperties(context, device, profiling ? properties : nullptr, ret);
+    }
 
-            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(first.get_rows() * first.get_columns() * sizeof(float), CL_MEM_WRITE_ONLY);
+    //(Re)creates the calling thread's queues for the split operations. The kernel times of these operations steer the
+    //device weights, so the queues keep profiling on
+    cl_int create_device_queues() {
 
-            enqueue_write(memory_input_a, first);
-            enqueue_write(memory_input_b, second);
+        cl_int ret = 0;
 
-            set_argument(scalar_kernel_gte, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(scalar_kernel_gte, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(scalar_kernel_gte, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        for (cl_command_queue device_queue : device_queues)
+            ret |= clReleaseCommandQueue(device_queue);
 
-            size_t global_work_size = first.get_columns() * first.get_rows();
-            size_t local_work_size = 1;
+        device_queues.clear();
+        queue_devices.clear();
 
-            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_gte, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+        for (size_t i = 0; i < devices.size(); i++) {
 
-            if (ret != 0) {
+            for (size_t j = 0; j < queues_per_device; j++) {
 
-                throw MatrixStatus("Error launching kernel.", 95);
+                cl_int retP;
+                device_queues.push_back(create_queue(devices[i], true, &retP));
+                queue_devices.push_back(i);
+                ret |= retP;
             }
+        }
 
-            synchronize();
+        return ret;
+    }
 
-            auto* output_final = new float[first.get_columns() * first.get_rows()];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      first.get_columns() * first.get_rows() * sizeof(float), output_final, 0, nullptr, nullptr);
+    //creates the queue and the kernel objects of the calling thread
+    void init_thread() {
 
-            if (ret != 0) {
+        cl_int retQ, ret;
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+        queue = create_queue(deviceId, profiling_enabled, &retQ);
+        retQ |= create_device_queues();
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        if (retQ != 0) {
 
-            result.set_matrix(output_final);
-            return result;
+            throw MatrixStatus("Error detecting OpenCL supported platform.", 91);
         }
-        catch (MatrixStatus& status) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
+        typed_programs.clear();
+        math_programs.clear();
+
+        for (int i = 0; i < 3; i++) {
+
+            workspace_buffers[i] = nullptr;
+            workspace_sizes[i] = 0;
         }
-    }
 
-    Matrix operator<=(Matrix& first, float const& second) {
+        kernel_add = clCreateKernel(program, "parallel_adder", &ret);
 
-        try {
+        if (ret != 0) {
 
-            cl_int ret;
+            throw MatrixStatus("Error creating kernel program. (Adder)", 101);
+        }
 
-            Matrix result(first.get_rows(), first.get_columns());
+        kernel_subtract = clCreateKernel(program, "parallel_subtracter", &ret);
 
-            cl_mem memory_input_a = clCreateBuffer(context, CL_MEM_READ_ONLY,
-                                                   first.get_rows() * first.get_columns() * sizeof(float), nullptr, &ret);
+        if (ret != 0) {
 
-            if (ret != 0) {
+            throw MatrixStatus("Error creating kernel program. (Subtracter)", 101);
+        }
 
-                throw MatrixStatus("Memory buffer could not be created.", 92);
-            }
+        kernel_multiply = clCreateKernel(program, "parallel_multiplier", &ret);
 
-            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(first.get_rows() * first.get_columns() * sizeof(float), CL_MEM_WRITE_ONLY);
+        if (ret != 0) {
 
-            enqueue_write(memory_input_a, first);
-            enqueue_write(memory_input_b, second);
+            throw MatrixStatus("Error creating kernel program. (Multiplier)", 101);
+        }
 
-            set_argument(scalar_kernel_lte, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(scalar_kernel_lte, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(scalar_kernel_lte, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        kernel_gt = clCreateKernel(program, "parallel_gt", &ret);
 
-            size_t global_work_size = first.get_columns() * first.get_rows();
-            size_t local_work_size = 1;
+        if (ret != 0) {
 
-            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_lte, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+            throw MatrixStatus("Error creating kernel program. (Greater Than [gt])", 101);
+        }
 
-            if (ret != 0) {
+        kernel_lt = clCreateKernel(program, "parallel_lt", &ret);
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+        if (ret != 0) {
 
-            synchronize();
+            throw MatrixStatus("Error creating kernel program. (Less Than [lt])", 101);
+        }
 
-            auto* output_final = new float[first.get_columns() * first.get_rows()];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      first.get_columns() * first.get_rows() * sizeof(float), output_final, 0, nullptr, nullptr);
+        kernel_equals = clCreateKernel(program, "parallel_equals", &ret);
 
-            if (ret != 0) {
+        if (ret != 0) {
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+            throw MatrixStatus("Error creating kernel program. (Is Equal To [equals])", 101);
+        }
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        kernel_gte = clCreateKernel(program, "parallel_gte", &ret);
 
-            result.set_matrix(output_final);
-            return result;
+        if (ret != 0) {
+
+            throw MatrixStatus("Error creating kernel program. (Greater Than or Equal To [gte])", 101);
         }
-        catch (MatrixStatus& status) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
+        kernel_lte = clCreateKernel(program, "parallel_lte", &ret);
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error creating kernel program. (Less Than or Equal To [lte])", 101);
         }
-    }
 
-    Matrix operator^(Matrix& first, float const& second) {
+        scalar_kernel_multiply = clCreateKernel(program, "scalar_parallel_multiplier", &ret);
 
-        try {
+        if (ret != 0) {
 
-            cl_int ret;
+            throw MatrixStatus("Error creating kernel program. (Scalar Multiplier)", 101);
+        }
 
-            Matrix result(first.get_rows(), first.get_columns());
+        scalar_kernel_gt = clCreateKernel(program, "scalar_parallel_gt", &ret);
 
-            cl_mem memory_input_a = clCreateBuffer(context, CL_MEM_READ_ONLY,
-                                                   first.get_rows() * first.get_columns() * sizeof(float), nullptr, &ret);
+        if (ret != 0) {
 
-            if (ret != 0) {
+            throw MatrixStatus("Error creating kernel program. (Scalar Greater Than)", 101);
+        }
 
-                throw MatrixStatus("Memory buffer could not be created.", 92);
-            }
+        scalar_kernel_lt = clCreateKernel(program, "scalar_parallel_lt", &ret);
 
-            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(first.get_rows() * first.get_columns() * sizeof(float), CL_MEM_WRITE_ONLY);
+        if (ret != 0) {
 
-            enqueue_write(memory_input_a, first);
-            enqueue_write(memory_input_b, second);
+            throw MatrixStatus("Error creating kernel program. (Scalar Less Than)", 101);
+        }
 
-            set_argument(scalar_kernel_power, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(scalar_kernel_power, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(scalar_kernel_power, 2, (void*)&memory_output_a, sizeof(cl_mem));
+        scalar_kernel_equals = clCreateKernel(program, "scalar_parallel_equals", &ret);
 
-            size_t global_work_size = first.get_columns() * first.get_rows();
-            size_t local_work_size = 1;
+        if (ret != 0) {
+
+            throw MatrixStatus("Error creating kernel program. (Scalar Is Equal To)", 101);
+        }
+
+        scalar_kernel_gte = clCreateKernel(program, "scalar_parallel_gte", &ret);
+
+        if (ret != 0) {
 
-            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_power, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+            throw MatrixStatus("Error creating kernel program. (Scalar Greater Than or Equal To)", 101);
+        }
 
-            if (ret != 0) {
+        scalar_kernel_lte = clCreateKernel(program, "scalar_parallel_lte", &ret);
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+        if (ret != 0) {
 
-            synchronize();
+            throw MatrixStatus("Error creating kernel program. (Scalar Less Than or Equal To)", 101);
+        }
 
-            auto* output_final = new float[first.get_columns() * first.get_rows()];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      first.get_columns() * first.get_rows() * sizeof(float), output_final, 0, nullptr, nullptr);
+        scalar_kernel_power = clCreateKernel(program, "scalar_parallel_power", &ret);
 
-            if (ret != 0) {
+        if (ret != 0) {
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+            throw MatrixStatus("Error creating kernel program. (Scalar Power)", 101);
+        }
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        scalar_kernel_adder = clCreateKernel(program, "scalar_parallel_adder", &ret);
 
-            result.set_matrix(output_final);
-            return result;
+        if (ret != 0) {
+
+            throw MatrixStatus("Error creating kernel program. (Scalar Adder)", 101);
         }
-        catch (MatrixStatus& status) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
+        scalar_kernel_subtracter = clCreateKernel(program, "scalar_parallel_subtracter", &ret);
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error creating kernel program. (Scalar Subtracter)", 101);
         }
-    }
 
-    Matrix operator+(Matrix& first, float const& second) {
+        matrix_kernel_multiply = clCreateKernel(program, "parallel_matrix_multiply", &ret);
 
-        try {
+        if (ret != 0) {
 
-            cl_int ret;
+            throw MatrixStatus("Error creating kernel program. (Matrix Multiplier)", 101);
+        }
 
-            Matrix result(first.get_rows(), first.get_columns());
+        matrix_kernel_transpose = clCreateKernel(program, "parallel_transpose", &ret);
 
-            cl_mem memory_input_a = get_memory_buffer(first.get_rows() * first.get_columns() * sizeof(float));
-            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
-            cl_mem memory_input_c = get_memory_buffer(sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(first.get_rows() * first.get_columns() * sizeof(float), CL_MEM_WRITE_ONLY);
+        if (ret != 0) {
 
-            float num_columns = first.get_columns();
+            throw MatrixStatus("Error creating kernel program. (Matrix Tranpose)", 101);
+        }
 
-            enqueue_write(memory_input_a, first);
-            enqueue_write(memory_input_b, second);
-            enqueue_write(memory_input_c, num_columns);
+        matrix_kernel_gemm = clCreateKernel(program, "parallel_gemm", &ret);
 
-            set_argument(scalar_kernel_adder, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(scalar_kernel_adder, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(scalar_kernel_adder, 2, (void*)&memory_input_c, sizeof(cl_mem));
-            set_argument(scalar_kernel_adder, 3, (void*)&memory_output_a, sizeof(cl_mem));
+        if (ret != 0) {
 
-            size_t global_work_size = first.get_columns() * first.get_rows();
-            size_t local_work_size = 1;
+            throw MatrixStatus("Error creating kernel program. (General Matrix Multiplier)", 101);
+        }
 
-            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_adder, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+        block_kernel_update = clCreateKernel(program, "parallel_block_update", &ret);
 
-            if (ret != 0) {
+        if (ret != 0) {
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+            throw MatrixStatus("Error creating kernel program. (Block Update)", 101);
+        }
 
-            synchronize();
+        block_kernel_swap_rows = clCreateKernel(program, "parallel_swap_rows", &ret);
 
-            auto* output_final = new float[first.get_columns() * first.get_rows()];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      first.get_columns() * first.get_rows() * sizeof(float), output_final, 0, nullptr, nullptr);
+        if (ret != 0) {
 
-            if (ret != 0) {
+            throw MatrixStatus("Error creating kernel program. (Row Interchange)", 101);
+        }
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+        block_kernel_lower_solve = clCreateKernel(program, "parallel_lower_solve", &ret);
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        if (ret != 0) {
 
-            result.set_matrix(output_final);
-            return result;
+            throw MatrixStatus("Error creating kernel program. (Lower Triangular Solve)", 101);
         }
-        catch (MatrixStatus& status) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
+        block_kernel_upper_solve = clCreateKernel(program, "parallel_upper_solve", &ret);
+
+        if (ret != 0) {
+
+            throw MatrixStatus("Error creating kernel program. (Upper Triangular Solve)", 101);
         }
-    }
 
-    Matrix operator-(Matrix& first, float const& second) {
+        block_kernel_right_lower_solve = clCreateKernel(program, "parallel_right_lower_solve", &ret);
 
-        try {
+        if (ret != 0) {
 
-            cl_int ret;
+            throw MatrixStatus("Error creating kernel program. (Right Lower Triangular Solve)", 101);
+        }
 
-            Matrix result(first.get_rows(), first.get_columns());
+        block_kernel_symmetric_update = clCreateKernel(program, "parallel_block_symmetric_update", &ret);
 
-            cl_mem memory_input_a = get_memory_buffer(first.get_rows() * first.get_columns() * sizeof(float));
-            cl_mem memory_input_b = get_memory_buffer(sizeof(float));
-            cl_mem memory_input_c = get_memory_buffer(sizeof(float));
-            cl_mem memory_output_a = get_memory_buffer(first.get_rows() * first.get_columns() * sizeof(float), CL_MEM_WRITE_ONLY);
+        if (ret != 0) {
 
-            float num_columns = first.get_columns();
+            throw MatrixStatus("Error creating kernel program. (Block Symmetric Update)", 101);
+        }
 
-            enqueue_write(memory_input_a, first);
-            enqueue_write(memory_input_b, second);
-            enqueue_write(memory_input_c, num_columns);
+        batched_kernel_lstsq = clCreateKernel(program, "parallel_batched_lstsq", &ret);
 
-            set_argument(scalar_kernel_subtracter, 0, (void*)&memory_input_a, sizeof(cl_mem));
-            set_argument(scalar_kernel_subtracter, 1, (void*)&memory_input_b, sizeof(cl_mem));
-            set_argument(scalar_kernel_subtracter, 2, (void*)&memory_input_c, sizeof(cl_mem));
-            set_argument(scalar_kernel_subtracter, 3, (void*)&memory_output_a, sizeof(cl_mem));
+        if (ret != 0) {
 
-            size_t global_work_size = first.get_columns() * first.get_rows();
-            size_t local_work_size = 1;
+            throw MatrixStatus("Error creating kernel program. (Batched Least Squares)", 101);
+        }
 
-            ret = clEnqueueNDRangeKernel(queue, scalar_kernel_subtracter, 1, nullptr,
-                                         &global_work_size, &local_work_size, 0, nullptr, nullptr);
+        matrix_kernel_gemv = clCreateKernel(program, "parallel_gemv", &ret);
 
-            if (ret != 0) {
+        if (ret != 0) {
 
-                throw MatrixStatus("Error launching kernel.", 95);
-            }
+            throw MatrixStatus("Error creating kernel program. (Matrix Vector Multiplier)", 101);
+        }
 
-            synchronize();
+        //the largest power of two within both limits, the reduction in the kernel halves the lanes each step
+        size_t kernel_limit = gemv_group_size, device_limit = gemv_group_size;
 
-            auto* output_final = new float[first.get_columns() * first.get_rows()];
-            ret = clEnqueueReadBuffer(queue, memory_output_a, CL_TRUE, 0,
-                                      first.get_columns() * first.get_rows() * sizeof(float), output_final, 0, nullptr, nullptr);
+        clGetKernelWorkGroupInfo(matrix_kernel_gemv, deviceId, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t),
+                                 &kernel_limit, nullptr);
+        clGetDeviceInfo(deviceId, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &device_limit, nullptr);
 
-            if (ret != 0) {
+        gemv_lanes = gemv_group_size;
 
-                throw MatrixStatus("Error reading output from kernel.", 97);
-            }
+        while (gemv_lanes > 1 && (gemv_lanes > kernel_limit || gemv_lanes > device_limit))
+            gemv_lanes /= 2;
 
-            release(memory_input_a);
-            release(memory_input_b);
-            release(memory_output_a);
+        block_kernel_rank2_update = clCreateKernel(program, "parallel_symmetric_rank2_update", &ret);
 
-            result.set_matrix(output_final);
-            return result;
-        }
-        catch (MatrixStatus& status) {
+        if (ret != 0) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
+            throw MatrixStatus("Error creating kernel program. (Symmetric Rank 2 Update)", 101);
         }
-    }
 
-    float dominant_eigen(Matrix matrix, Matrix& eigen_vector, float tolerable_error = 0.0001) {
+        batched_kernel_multiply = clCreateKernel(program, "parallel_batched_matmul", &ret);
 
-        if (matrix.get_rows() != matrix.get_columns()) {
+        if (ret != 0) {
 
-            std::cerr << "108: ERROR: Eigen values supported only for square matrices.\n";
-            return 0.0f;
+            throw MatrixStatus("Error creating kernel program. (Batched Matrix Multiplier)", 101);
         }
 
-        float possible_eigen = 0.0f;
+        sparse_kernel_spmv = clCreateKernel(program, "parallel_spmv", &ret);
 
-        Matrix initialGuess = Matrix(matrix.get_rows(), 1);
-        Matrix newPossibleSolution = Matrix(matrix.get_rows(), 1);
+        if (ret != 0) {
 
-        initialGuess.ones();
-        newPossibleSolution.zeroes();
+            throw MatrixStatus("Error creating kernel program. (Sparse Matrix Vector Multiplier)", 101);
+        }
 
-        float lambda_old = 1, lambda_new = 1, temp;
-        up:
-        for (int i = 0; i < matrix.get_rows(); i++) {
-            temp = 0.0;
-            for (int j = 0; j < matrix.get_rows(); j++)
-            {
-                temp = temp + matrix.get_element(i, j) * initialGuess.get_element(j, 0);
-            }
+        sparse_kernel_spmm = clCreateKernel(program, "parallel_spmm", &ret);
 
-            newPossibleSolution.set_element(i, 0, temp);
-        }
+        if (ret != 0) {
 
-        for (int i = 0; i < matrix.get_rows(); i++) {
-            initialGuess.set_element(i, 0, newPossibleSolution.get_element(i, 0));
+            throw MatrixStatus("Error creating kernel program. (Sparse Matrix Multiplier)", 101);
         }
 
-        /* Finding Largest */
-        lambda_new = fabs(initialGuess.get_element(0, 0));
-        for (int i = 1; i < matrix.get_rows(); i++) {
-            if (fabs(initialGuess.get_element(i, 0)) > lambda_new)
-            {
-                lambda_new = fabs(initialGuess.get_element(i, 0));
-            }
-        }
+        sparse_kernel_count = clCreateKernel(program, "parallel_sparse_count", &ret);
 
-        /* Normalization */
-        for (int i = 0; i < matrix.get_rows(); i++) {
-            initialGuess.set_element(i, 0, initialGuess.get_element(i, 0) / lambda_new);
+        if (ret != 0) {
+
+            throw MatrixStatus("Error creating kernel program. (Sparse Pattern Counter)", 101);
         }
 
-        eigen_vector = Matrix(initialGuess);
+        sparse_kernel_merge = clCreateKernel(program, "parallel_sparse_merge", &ret);
 
-        possible_eigen = lambda_new;
+        if (ret != 0) {
 
-        /* Checking Accuracy */
-        if (fabs(lambda_new - lambda_old) > tolerable_error) {
-            lambda_old = lambda_new;
-            goto up;
+            throw MatrixStatus("Error creating kernel program. (Sparse Element-wise Merge)", 101);
         }
-        else {
-            return possible_eigen;
-        }
-    }
 
-    std::string kernelCode() {
-        return "kernel void parallel_adder(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] + b[i];  }    kernel void parallel_subtracter(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] - b[i];  }    kernel void parallel_multiplier(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] * b[i];  }    kernel void parallel_gt(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] > b[i];  }    kernel void parallel_lt(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] < b[i];  }    kernel void parallel_equals(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] == b[i];  }    kernel void parallel_gte(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] >= b[i];  }    kernel void parallel_lte(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] <= b[i];  }    kernel void scalar_parallel_multiplier(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] * b[0];  }    kernel void scalar_parallel_gt(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] > b[0];  }    kernel void scalar_parallel_lt(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] < b[0];  }    kernel void scalar_parallel_equals(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] == b[0];  }    kernel void scalar_parallel_gte(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] >= b[0];  }    kernel void scalar_parallel_lte(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = a[i] <= b[0];  }    kernel void scalar_parallel_power(global float* a, global float* b, global float* results) {      long long int i = get_global_id(0);      results[i] = pow(a[i],b[0]);  }    kernel void scalar_parallel_adder(global float* a, global float* b, global float* col_size, global float* results) {      int i = get_global_id(0);        int r = i/(int)col_size[0];      int c = i%(int)col_size[0];        results[i] = a[i];        if(r==c)          results[i] = results[i] + b[0];  }    kernel void scalar_parallel_subtracter(global float* a, global float* b, global float* col_size, global float* results) {      int i = get_global_id(0);        int r = i/(int)col_size[0];      int c = i%(int)col_size[0];        results[i] = a[i];        if(r==c)          results[i] = results[i] - b[0];  }    kernel void parallel_matrix_multiply(const int M, const int N, const int K, const global float* A, const global float* B, global float* C) {            const int row = get_global_id(0);      const int col = get_global_id(1);        float sum = 0.0f;      for (int k=0; k<K; k++) {          sum += A[k*M + row] * B[col*K + k];      }        C[col*M + row] = sum;  }    kernel void parallel_transpose(const int N, const global float* A, global float* B) {            const int row = get_global_id(0);      const int col = get_global_id(1);        B[col*N + row] = A[row*N + col];  }  ";
-    }
+        sparse_kernel_dense_count = clCreateKernel(program, "parallel_dense_count", &ret);
 
-    void init_parallel() {
+        if (ret != 0) {
 
-        try {
-            cl_int retP, retD, retC, retQ, ret;
+            throw MatrixStatus("Error creating kernel program. (Dense Non-zero Counter)", 101);
+        }
 
-            retP = clGetPlatformIDs(1, &platformId, &ret_num_platforms);
-            retD = clGetDeviceIDs(platformId, CL_DEVICE_TYPE_DEFAULT, 1, &deviceId, &ret_num_devices);
-            context = clCreateContext(nullptr, 1, &deviceId, nullptr, nullptr, &retC);
-            queue = clCreateCommandQueueWithProperties(context, deviceId, nullptr, &retQ);
+        sparse_kernel_compress = clCreateKernel(program, "parallel_dense_compress", &ret);
 
-            if ((retC != 0) || (retP != 0) || (retQ != 0) || (retD != 0)) {
+        if (ret != 0) {
 
-                throw MatrixStatus("Error detecting OpenCL supported platform.", 91);
-            }
+            throw MatrixStatus("Error creating kernel program. (Dense to Sparse)", 101);
+        }
 
-            std::string source_str = kernelCode();
-            size_t source_size = source_str.size();
+        sparse_kernel_expand = clCreateKernel(program, "parallel_sparse_expand", &ret);
 
-            program = clCreateProgramWithSource(context, 1, (const char**)&source_str, (const size_t*)&source_size, &ret);
+        if (ret != 0) {
 
-            if (ret != 0) {
+            throw MatrixStatus("Error creating kernel program. (Sparse to Dense)", 101);
+        }
 
-                throw MatrixStatus("Error creating kernel program from source.", 99);
-            }
+        mask_kernel_count = clCreateKernel(program, "parallel_mask_count", &ret);
 
-            ret = clBuildProgram(program, 1, &deviceId, nullptr, nullptr, nullptr);
+        if (ret != 0) {
 
-            if (ret != 0) {
+            throw MatrixStatus("Error creating kernel program. (Mask Counter)", 101);
+        }
 
-                throw MatrixStatus("Error building kernel program.", 100);
-            }
+        mask_kernel_select = clCreateKernel(program, "parallel_masked_select", &ret);
 
-            kernel_add = clCreateKernel(program, "parallel_adder", &ret);
+        if (ret != 0) {
 
-            if (ret != 0) {
+            throw MatrixStatus("Error creating kernel program. (Masked Select)", 101);
+        }
 
-                throw MatrixStatus("Error creating kernel program. (Adder)", 101);
-            }
+        gather_kernel = clCreateKernel(program, "parallel_gather", &ret);
 
-            kernel_subtract = clCreateKernel(program, "parallel_subtracter", &ret);
+        if (ret != 0) {
 
-            if (ret != 0) {
+            throw MatrixStatus("Error creating kernel program. (Gather)", 101);
+        }
 
-                throw MatrixStatus("Error creating kernel program. (Subtracter)", 101);
-            }
+        scatter_kernel_add = clCreateKernel(program, "parallel_scatter_add", &ret);
 
-            kernel_multiply = clCreateKernel(program, "parallel_multiplier", &ret);
+        if (ret != 0) {
 
-            if (ret != 0) {
+            throw MatrixStatus("Error creating kernel program. (Scatter Add)", 101);
+        }
+    }
 
-                throw MatrixStatus("Error creating kernel program. (Multiplier)", 101);
-            }
+    void init_parallel() {
 
-            kernel_gt = clCreateKernel(program, "parallel_gt", &ret);
+        if (thread_initialized)
+            return;
 
-            if (ret != 0) {
+        try {
+            {
+                std::lock_guard<std::mutex> lock(parallel_mutex);
+
+                if (parallel_threads == 0)
+                    init_context();
 
-                throw MatrixStatus("Error creating kernel program. (Greater Than [gt])", 101);
+                parallel_threads++;
             }
 
-            kernel_lt = clCreateKernel(program, "parallel_lt", &ret);
+            init_thread();
+            thread_initialized = true;
+        }
+        catch (MatrixStatus status) {
 
-            if (ret != 0) {
+            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
+                      << "Aborting..." << std::endl;
+            exit(0);
+        }
+    }
 
-                throw MatrixStatus("Error creating kernel program. (Less Than [lt])", 101);
-            }
+    void set_profiling(bool enabled) {
 
-            kernel_equals = clCreateKernel(program, "parallel_equals", &ret);
+        profiling_enabled = enabled;
 
-            if (ret != 0) {
+        if (!thread_initialized)
+            return;
 
-                throw MatrixStatus("Error creating kernel program. (Is Equal To [equals])", 101);
-            }
+        //the calling thread's queue is recreated with the new setting
+        synchronize();
+        collect_profile();
 
-            kernel_gte = clCreateKernel(program, "parallel_gte", &ret);
+        cl_int ret = clReleaseCommandQueue(queue);
+        queue = create_queue(deviceId, enabled, &ret);
 
-            if (ret != 0) {
+        if (ret != 0) {
 
-                throw MatrixStatus("Error creating kernel program. (Greater Than or Equal To [gte])", 101);
-            }
+            throw MatrixStatus("Error detecting OpenCL supported platform.", 91);
+        }
+    }
 
-            kernel_lte = clCreateKernel(program, "parallel_lte", &ret);
+    void set_partition_queues(size_t count) {
 
-            if (ret != 0) {
+        queues_per_device = std::max(count, (size_t)1);
 
-                throw MatrixStatus("Error creating kernel program. (Less Than or Equal To [lte])", 101);
-            }
+        if (!thread_initialized)
+            return;
 
-            scalar_kernel_multiply = clCreateKernel(program, "scalar_parallel_multiplier", &ret);
+        //the split operations wait for their queues before returning, so the old ones are idle
+        if (create_device_queues() != 0) {
 
-            if (ret != 0) {
+            throw MatrixStatus("Error detecting OpenCL supported platform.", 91);
+        }
+    }
 
-                throw MatrixStatus("Error creating kernel program. (Scalar Multiplier)", 101);
-            }
+    std::vector<ProfileStats> get_profiling_stats() {
 
-            scalar_kernel_gt = clCreateKernel(program, "scalar_parallel_gt", &ret);
+        collect_profile();
 
-            if (ret != 0) {
+        std::vector<ProfileStats> stats;
+        std::lock_guard<std::mutex> lock(profile_mutex);
 
-                throw MatrixStatus("Error creating kernel program. (Scalar Greater Than)", 101);
-            }
+        for (auto& totals : profile_totals)
+            stats.push_back(totals.second);
 
-            scalar_kernel_lt = clCreateKernel(program, "scalar_parallel_lt", &ret);
+        return stats;
+    }
 
-            if (ret != 0) {
+    void reset_profiling() {
 
-                throw MatrixStatus("Error creating kernel program. (Scalar Less Than)", 101);
-            }
+        collect_profile();
 
-            scalar_kernel_equals = clCreateKernel(program, "scalar_parallel_equals", &ret);
+        std::lock_guard<std::mutex> lock(profile_mutex);
+        profile_totals.clear();
+    }
 
-            if (ret != 0) {
+    void set_tracing(bool enabled) {
 
-                throw MatrixStatus("Error creating kernel program. (Scalar Is Equal To)", 101);
+        if (enabled && !tracing_enabled) {
+
+            set_profiling(true);
+
+            {
+                std::lock_guard<std::mutex> lock(profile_mutex);
+                trace_events.clear();
+                trace_device_offsets.clear();
             }
 
-            scalar_kernel_gte = clCreateKernel(program, "scalar_parallel_gte", &ret);
+            trace_start = host_time();
 
-            if (ret != 0) {
+            //the other devices are measured when their first command is traced
+            if (thread_initialized) {
 
-                throw MatrixStatus("Error creating kernel program. (Scalar Greater Than or Equal To)", 101);
+                cl_long offset = measure_device_offset(queue);
+
+                std::lock_guard<std::mutex> lock(profile_mutex);
+                trace_device_offsets[deviceId] = offset;
             }
+        }
 
-            scalar_kernel_lte = clCreateKernel(program, "scalar_parallel_lte", &ret);
+        tracing_enabled = enabled;
+    }
 
-            if (ret != 0) {
+    std::string escape_json(const std::string& text) {
 
-                throw MatrixStatus("Error creating kernel program. (Scalar Less Than or Equal To)", 101);
-            }
+        std::string escaped;
 
-            scalar_kernel_power = clCreateKernel(program, "scalar_parallel_power", &ret);
+        for (char c : text) {
 
-            if (ret != 0) {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
 
-                throw MatrixStatus("Error creating kernel program. (Scalar Power)", 101);
-            }
+            escaped += c;
+        }
 
-            scalar_kernel_adder = clCreateKernel(program, "scalar_parallel_adder", &ret);
+        return escaped;
+    }
 
-            if (ret != 0) {
+    void write_trace(std::ostream& out) {
 
-                throw MatrixStatus("Error creating kernel program. (Scalar Adder)", 101);
-            }
+        collect_profile();
 
-            scalar_kernel_subtracter = clCreateKernel(program, "scalar_parallel_subtracter", &ret);
+        std::lock_guard<std::mutex> lock(profile_mutex);
 
-            if (ret != 0) {
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl
+            << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"host\"}}," << std::endl
+            << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"device\"}}";
 
-                throw MatrixStatus("Error creating kernel program. (Scalar Subtracter)", 101);
-            }
+        //host spans on process 0 and device commands on process 1, one track per host thread, in microseconds
+        for (const TraceEvent& event : trace_events) {
 
-            matrix_kernel_multiply = clCreateKernel(program, "parallel_matrix_multiply", &ret);
+            double start = ((double)event.start - (double)trace_start) / 1e3;
+            double duration = ((double)event.end - (double)event.start) / 1e3;
 
-            if (ret != 0) {
+            out << "," << std::endl << "{\"name\": \"" << escape_json(event.name) << "\", \"cat\": \""
+                << (event.device ? "device" : "host") << "\", \"ph\": \"X\", \"pid\": " << (event.device ? 1 : 0)
+                << ", \"tid\": " << event.thread << std::fixed << std::setprecision(3) << ", \"ts\": " << start
+                << ", \"dur\": " << duration << "}";
+        }
 
-                throw MatrixStatus("Error creating kernel program. (Matrix Multiplier)", 101);
-            }
+        out << std::endl << "]}" << std::endl;
+    }
 
-            matrix_kernel_transpose = clCreateKernel(program, "parallel_transpose", &ret);
+    void print_profiling(std::ostream& out) {
 
-            if (ret != 0) {
+        std::vector<ProfileStats> stats = get_profiling_stats();
 
-                throw MatrixStatus("Error creating kernel program. (Matrix Tranpose)", 101);
-            }
+        out << "Profile (times in ms):" << std::endl
+            << std::left << std::setw(36) << "command" << std::right << std::setw(10) << "count" << std::setw(14)
+            << "bytes" << std::setw(12) << "queued" << std::setw(12) << "submitted" << std::setw(12) << "executed"
+            << std::endl;
 
-        }
-        catch (MatrixStatus status) {
+        for (const ProfileStats& entry : stats) {
 
-            std::cout << std::endl << status.get_error_code() << ": " << status.get_error_message() << std::endl
-                      << "Aborting..." << std::endl;
-            exit(0);
+            out << std::left << std::setw(36) << entry.command << std::right << std::setw(10) << entry.count
+                << std::setw(14) << entry.bytes << std::fixed << std::setprecision(3)
+                << std::setw(12) << entry.queued_ns / 1e6 << std::setw(12) << entry.submitted_ns / 1e6
+                << std::setw(12) << entry.executed_ns / 1e6 << std::endl;
         }
     }
 
     void finish_parallel() {
-        cl_int reta = clFlush(queue);
+
+        if (!thread_initialized)
+            return;
+
+        cl_int reta = clFinish(queue);
+        collect_profile();
+
         cl_int retb = clReleaseKernel(kernel_add);
         cl_int retd = clReleaseKernel(kernel_multiply);
         cl_int rete = clReleaseKernel(kernel_subtract);
@@ -2023,11 +7389,101 @@ namespace numcpp {
         cl_int retj = clReleaseKernel(kernel_equals);
         cl_int retk = clReleaseKernel(kernel_gte);
         cl_int retl = clReleaseKernel(kernel_lte);
-        cl_int retc = clReleaseProgram(program);
+        cl_int retm = clReleaseKernel(block_kernel_update);
+        cl_int retn = clReleaseKernel(block_kernel_swap_rows);
+        cl_int reto = clReleaseKernel(block_kernel_lower_solve);
+        cl_int retp = clReleaseKernel(block_kernel_upper_solve);
+        cl_int retq = clReleaseKernel(block_kernel_right_lower_solve);
+        cl_int retr = clReleaseKernel(block_kernel_symmetric_update);
+        cl_int rets = clReleaseKernel(batched_kernel_lstsq);
+        cl_int rett = clReleaseKernel(matrix_kernel_gemv);
+        cl_int retu = clReleaseKernel(block_kernel_rank2_update);
+        cl_int retv = clReleaseKernel(batched_kernel_multiply);
+        cl_int retw = clReleaseKernel(matrix_kernel_gemm);
+        cl_int retx = clReleaseKernel(sparse_kernel_spmv);
+        cl_int rety = clReleaseKernel(sparse_kernel_spmm);
+        cl_int retz = clReleaseKernel(sparse_kernel_count);
+        cl_int retA = clReleaseKernel(sparse_kernel_merge);
+        cl_int retB = clReleaseKernel(sparse_kernel_dense_count);
+        cl_int retC = clReleaseKernel(sparse_kernel_compress);
+        cl_int retD = clReleaseKernel(sparse_kernel_expand);
+        cl_int retF = clReleaseKernel(mask_kernel_count);
+        cl_int retG = clReleaseKernel(mask_kernel_select);
+        cl_int retH = clReleaseKernel(gather_kernel);
+        cl_int retI = clReleaseKernel(scatter_kernel_add);
+        cl_int retE = 0;
+
+        for (auto& typed : typed_programs) {
+
+            retE |= clReleaseKernel(typed.second.add);
+            retE |= clReleaseKernel(typed.second.subtract);
+            retE |= clReleaseKernel(typed.second.multiply);
+            retE |= clReleaseKernel(typed.second.multiply_matrix);
+            retE |= clReleaseKernel(typed.second.transpose);
+            retE |= clReleaseProgram(typed.second.program);
+        }
+
+        typed_programs.clear();
+
+        for (auto& math : math_programs) {
+
+            for (auto& kernel : math.second.kernels)
+                retE |= clReleaseKernel(kernel.second);
+
+            retE |= clReleaseProgram(math.second.program);
+        }
+
+        math_programs.clear();
+
+        for (int i = 0; i < 3; i++) {
+
+            if (workspace_buffers[i] != nullptr) {
+
+                account_device(workspace_sizes[i], false);
+                retE |= clReleaseMemObject(workspace_buffers[i]);
+            }
+
+            workspace_buffers[i] = nullptr;
+            workspace_sizes[i] = 0;
+        }
+
+        release_staging();
+
+        for (cl_command_queue device_queue : device_queues)
+            retE |= clReleaseCommandQueue(device_queue);
+
+        device_queues.clear();
+        queue_devices.clear();
+
         cl_int retg = clReleaseCommandQueue(queue);
-        cl_int reth = clReleaseContext(context);
+        cl_int retc = 0, reth = 0;
+
+        thread_initialized = false;
+
+        {
+            std::lock_guard<std::mutex> lock(parallel_mutex);
+
+            //the last thread to finish releases the shared program and context
+            if (--parallel_threads == 0) {
+
+                if (profiling_enabled)
+                    print_profiling(std::cout);
+
+                retc = clReleaseProgram(program);
+                reth = clReleaseContext(context);
+
+                //pinned blocks still held keep their own reference to the queue
+                std::lock_guard<std::mutex> pinned_lock(pinned_mutex);
+                retE |= clReleaseCommandQueue(pinned_queue);
+                pinned_queue = nullptr;
+            }
+        }
 
-        if (reta != 0 || retb != 0 || retc != 0 || retg != 0 || reth != 0 || retd != 0 || rete != 0 || retf != 0 || reti != 0 || retj != 0 || retk != 0 || retl != 0) {
+        if (reta != 0 || retb != 0 || retc != 0 || retg != 0 || reth != 0 || retd != 0 || rete != 0 || retf != 0 || reti != 0 || retj != 0 || retk != 0 || retl != 0
+            || retm != 0 || retn != 0 || reto != 0 || retp != 0 || retq != 0 || retr != 0 || rets != 0
+            || rett != 0 || retu != 0 || retv != 0 || retw != 0 || retx != 0 || rety != 0 || retz != 0
+            || retA != 0 || retB != 0 || retC != 0 || retD != 0 || retE != 0 || retF != 0
+            || retG != 0 || retH != 0 || retI != 0) {
 
             std::cerr << "98: WARNING: Error clearing kernel space. Memory leaks may happen.\n";
         }
@@ -4,6 +4,8 @@
 #include "parallel.h"
 #include "matrix.h"
 
+#include <vector>
+
 namespace numcpp {
 
     /**
@@ -17,29 +19,29 @@ namespace numcpp {
 
     Matrix operator*(Matrix &first, Matrix const &second);
 
-    Matrix operator>(Matrix &first, Matrix const &second);
+    Mask operator>(Matrix &first, Matrix const &second);
 
-    Matrix operator<(Matrix &first, Matrix const &second);
+    Mask operator<(Matrix &first, Matrix const &second);
 
-    Matrix operator==(Matrix &first, Matrix const &second);
+    Mask operator==(Matrix &first, Matrix const &second);
 
-    Matrix operator<=(Matrix &first, Matrix const &second);
+    Mask operator<=(Matrix &first, Matrix const &second);
 
-    Matrix operator>=(Matrix &first, Matrix const &second);
+    Mask operator>=(Matrix &first, Matrix const &second);
 
 
     //all matrix-on-scalar operations here
     Matrix operator*(Matrix &first, float const &second);
 
-    Matrix operator>(Matrix &first, float const &second);
+    Mask operator>(Matrix &first, float const &second);
 
-    Matrix operator<(Matrix &first, float const &second);
+    Mask operator<(Matrix &first, float const &second);
 
-    Matrix operator==(Matrix &first, float const &second);
+    Mask operator==(Matrix &first, float const &second);
 
-    Matrix operator>=(Matrix &first, float const &second);
+    Mask operator>=(Matrix &first, float const &second);
 
-    Matrix operator<=(Matrix &first, float const &second);
+    Mask operator<=(Matrix &first, float const &second);
 
     Matrix operator^(Matrix &first, float const &second);
 
@@ -47,13 +49,220 @@ namespace numcpp {
 
     Matrix operator-(Matrix &first, float const &second);
 
+    //in-place operations, they write into the storage of `first`
+    Matrix &operator+=(Matrix &first, Matrix const &second);
+
+    Matrix &operator-=(Matrix &first, Matrix const &second);
+
+    Matrix &operator*=(Matrix &first, Matrix const &second);
+
+    Matrix &operator*=(Matrix &first, float const &second);
+
+    Matrix &operator^=(Matrix &first, float const &second);
+
+    //output-parameter operations, they write into the storage of `out`, which may be one of the operands
+    //operands and out must have the same dimensions, the device buffers are reused from call to call
+    void add(Matrix a, Matrix b, Matrix &out);
+
+    void subtract(Matrix a, Matrix b, Matrix &out);
+
+    void multiply(Matrix a, Matrix b, Matrix &out);
+
+    void multiply(Matrix a, float b, Matrix &out);
+
+    void power(Matrix a, float b, Matrix &out);
+
     /**
      * all non-overloaded operators implemented as functions are here
      */
     Matrix matmul(Matrix a, Matrix b);
 
+    //stacked products: a holds batch (m x k) matrices one below the other, b either batch (k x n) matrices or a
+    //single one shared by all of them, the result stacks the batch (m x n) products
+    Matrix matmul_batched(Matrix a, Matrix b, size_t batch);
+
+    //c = alpha * op(a) * op(b) + beta * c in place, where op transposes its operand when the matching flag is set
+    void gemm(bool trans_a, bool trans_b, float alpha, Matrix a, Matrix b, float beta, Matrix& c);
+
     Matrix transpose(Matrix a);
 
+    /**
+     * linear algebra routines, built on a blocked LU decomposition with partial pivoting
+     */
+
+    //factors a square matrix as P*A = L*U, with the unit lower L and upper U packed together in the result
+    //row i was interchanged with row pivots[i] during elimination
+    Matrix lu(Matrix a, std::vector<int>& pivots);
+
+    //solves A*X = B for X, B may hold any number of right hand side columns
+    Matrix solve(Matrix a, Matrix b);
+
+    float det(Matrix a);
+
+    Matrix inverse(Matrix a);
+
+    //factors a symmetric positive-definite matrix as A = L*L^T and returns the lower triangular L
+    Matrix cholesky(Matrix a);
+
+    //solves A*X = B for X, given the Cholesky factor L of A
+    Matrix cho_solve(Matrix l, Matrix b);
+
+    //Householder QR decomposition A = Q*R, Q has orthonormal columns and R is upper triangular
+    void qr(Matrix a, Matrix& q, Matrix& r);
+
+    //least squares solution of A*X = B for a tall, full rank A, through the QR decomposition of A
+    Matrix lstsq(Matrix a, Matrix b);
+
+    //solves `batch` independent small least squares problems in a single kernel launch
+    //a stacks the (m x n) matrices vertically and b stacks their right hand sides the same way,
+    //a rank deficient problem anywhere in the batch throws code 16 like lstsq
+    Matrix lstsq_batched(Matrix a, Matrix b, size_t batch);
+
+    /**
+     * eigensolvers
+     */
+
+    //largest magnitude eigenvalue of a square matrix by power iteration, stops after max_iterations regardless
+    float dominant_eigen(Matrix matrix, Matrix& eigen_vector, float tolerable_error = 0.0001,
+                         size_t max_iterations = 1000, EigenStatus* status = nullptr);
+
+    //all eigenvalues (ascending, as an (n x 1) matrix) of a symmetric matrix, eigenvectors are returned as columns
+    Matrix eigh(Matrix a, Matrix& eigen_vectors);
+
+    //k largest magnitude eigenvalues of a symmetric matrix by Lanczos iteration with full reorthogonalization
+    //the matrix stays on the device and every iteration costs a single matrix-vector product
+    Matrix eigsh(Matrix a, size_t k, Matrix& eigen_vectors, size_t max_iterations = 300, float tolerance = 0.0001,
+                 EigenStatus* status = nullptr);
+
+    //rank k truncated SVD A ~ U * diag(S) * Vt by randomized range finding with power iterations, returns S
+    //A is streamed through the device in blocks of block_rows rows (sized from device memory when 0),
+    //so it may be larger than the device memory
+    Matrix svd_randomized(Matrix a, size_t k, Matrix& u, Matrix& vt, size_t power_iterations = 2,
+                          size_t oversampling = 10, size_t block_rows = 0);
+
+    /**
+     * element-wise math functions are here, see set_fast_math for their accuracy
+     */
+    Matrix exp(Matrix a);
+
+    Matrix log(Matrix a);
+
+    Matrix log1p(Matrix a);
+
+    Matrix sqrt(Matrix a);
+
+    Matrix rsqrt(Matrix a);
+
+    Matrix abs(Matrix a);
+
+    Matrix sin(Matrix a);
+
+    Matrix cos(Matrix a);
+
+    Matrix tanh(Matrix a);
+
+    //1 / (1 + e^-x)
+    Matrix sigmoid(Matrix a);
+
+    //max(x, 0)
+    Matrix relu(Matrix a);
+
+    Matrix erf(Matrix a);
+
+    //limits every element to [low, high]
+    Matrix clip(Matrix a, float low, float high);
+
+    /**
+     * operations on the masks produced by the comparison operators are here
+     */
+    size_t count_nonzero(Mask mask);
+
+    bool any(Mask mask);
+
+    bool all(Mask mask);
+
+    //the elements of a where the mask is set, in row-major order, as a column vector
+    Matrix masked_select(Matrix a, Mask mask);
+
+    /**
+     * assembling matrices from parts and taking them apart are here, see BasicMatrix::reshape for reshaping
+     */
+
+    //the parts one below the other (axis 0) or side by side (axis 1), copied into a single new matrix
+    Matrix concatenate(const std::vector<Matrix>& parts, size_t axis = 0);
+
+    Matrix vstack(const std::vector<Matrix>& parts);
+
+    Matrix hstack(const std::vector<Matrix>& parts);
+
+    //views of `sections` equal parts along the axis, nothing is copied
+    std::vector<Matrix> split(Matrix a, size_t sections, size_t axis = 0);
+
+    //views of the parts before, between and after the indices along the axis, as numpy.split cuts them
+    std::vector<Matrix> split(Matrix a, const std::vector<size_t>& indices, size_t axis = 0);
+
+    /**
+     * gathers and scatters by index lists are here, an index out of the bounds of the matrix throws code 28
+     */
+
+    //the rows (axis 0) or columns (axis 1) of a at the indices, in their order and repeated as often as they are
+    Matrix take(Matrix a, const std::vector<int>& indices, size_t axis = 0);
+
+    //as numpy.compress, the rows (axis 0) or columns (axis 1) of a where the mask, one element per row or column, is set
+    Matrix compress(Matrix a, Mask mask, size_t axis = 0);
+
+    //as numpy.take_along_axis, a(indices(i, j), j) for axis 0 and a(i, indices(i, j)) for axis 1
+    Matrix take_along_axis(Matrix a, const BasicMatrix<int32_t>& indices, size_t axis);
+
+    //adds row i of updates to the row of target at indices[i], repeated indices accumulate
+    void scatter_add(Matrix& target, const std::vector<int>& indices, Matrix updates);
+
+    /**
+     * typed operations on the non-float element types (double, int32_t, int8_t and half) are here
+     * int8_t results saturate, half is computed in float and double requires a device with cl_khr_fp64
+     */
+    template<typename T>
+    BasicMatrix<T> operator+(BasicMatrix<T> &first, BasicMatrix<T> const &second);
+
+    template<typename T>
+    BasicMatrix<T> operator-(BasicMatrix<T> &first, BasicMatrix<T> const &second);
+
+    template<typename T>
+    BasicMatrix<T> operator*(BasicMatrix<T> &first, BasicMatrix<T> const &second);
+
+    //products accumulate in double, int or float for double, int32_t/int8_t and half elements respectively
+    template<typename T>
+    BasicMatrix<T> matmul(BasicMatrix<T> a, BasicMatrix<T> b);
+
+    template<typename T>
+    BasicMatrix<T> transpose(BasicMatrix<T> a);
+
+    //element type conversion between any two element types, float included
+    template<typename To, typename From>
+    BasicMatrix<To> astype(BasicMatrix<From> a);
+
+    /**
+     * sparse (CSR) matrix operations are here
+     */
+    SparseMatrix operator+(SparseMatrix const &first, SparseMatrix const &second);
+
+    SparseMatrix operator-(SparseMatrix const &first, SparseMatrix const &second);
+
+    SparseMatrix operator*(SparseMatrix const &first, SparseMatrix const &second);
+
+    SparseMatrix operator*(SparseMatrix const &first, float const &second);
+
+    //conversions between the dense and the compressed layout, explicit zeros are dropped on the way in
+    SparseMatrix to_sparse(Matrix a);
+
+    Matrix to_dense(SparseMatrix const &a);
+
+    //sparse matrix times a dense column vector
+    Matrix spmv(SparseMatrix const &a, Matrix x);
+
+    //sparse matrix times a dense matrix, the result is dense
+    Matrix spmm(SparseMatrix const &a, Matrix b);
+
 }
 
 #endif //NUMCPP_NUMCPP_H
\ No newline at end of file
@@ -1,16 +1,141 @@
 #ifndef NUMCPP_PARALLEL_H
 #define NUMCPP_PARALLEL_H
 
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
 namespace numcpp {
+
+/**
+ * Aggregated timings of one kind of command: "create buffer", "write", "read", "fill", "map" or a kernel's name
+ * Times are in nanoseconds summed over all the commands: waiting in the queue until submitted,
+ * submitted until started on the device, and running on the device
+ */
+    struct ProfileStats {
+
+        std::string command;
+        size_t count = 0;
+        size_t bytes = 0;
+        uint64_t queued_ns = 0;
+        uint64_t submitted_ns = 0;
+        uint64_t executed_ns = 0;
+    };
+
+/**
+ * Bytes of host storage the library allocated (matrices and operator temporaries) and of device buffers held now, the
+ * most held at once, and the allocations and frees since the last reset_memory_stats()
+ */
+    struct MemoryStats {
+
+        size_t host_bytes = 0;
+        size_t host_peak = 0;
+        size_t host_allocations = 0;
+        size_t host_frees = 0;
+        size_t device_bytes = 0;
+        size_t device_peak = 0;
+        size_t device_allocations = 0;
+        size_t device_frees = 0;
+    };
+
+/**
+ * Allocations made while one public operation ran (nested operations count under the outermost one)
+ */
+    struct OperationMemory {
+
+        std::string operation;
+        size_t host_allocations = 0;
+        size_t host_bytes = 0;
+        size_t device_allocations = 0;
+        size_t device_bytes = 0;
+    };
+
 /**
  * Initializes all the kernels so they can be used as and when needed by Matrix class
+ * Every host thread that uses the library calls it once: the first call creates the shared context and program,
+ * each thread gets its own command queue and kernel objects so threads can run operations concurrently
  */
     void init_parallel();
 
+/**
+ * Builds the element-wise math functions with -cl-fast-relaxed-math (enabled = true) or with full precision (the default)
+ * Applies to the math functions called from then on
+ */
+    void set_fast_math(bool enabled);
+
+/**
+ * Backs the storage of the matrices created from then on with pinned (page-locked) host memory, which devices transfer
+ * at full speed, and stages large transfers of other host memory through a ring of pinned buffers (off by default)
+ * Takes effect once init_parallel() has been called
+ */
+    void set_pinned_memory(bool enabled);
+
+/**
+ * True when the default device shares host memory, operators then run on the matrix storage in place without copies
+ * Known once init_parallel() has been called
+ */
+    bool is_zero_copy();
+
+/**
+ * Turns per-command profiling on or off (off by default)
+ * While on, every command the library enqueues is timed, and finish_parallel() prints a summary
+ */
+    void set_profiling(bool enabled);
+
+/**
+ * Number of queues each device gets for the operations split in row blocks across devices (1 by default)
+ * With more than one, a single device runs those operations in row blocks too, and the transfers of one block overlap
+ * the kernels of another. Applies to the calling thread
+ */
+    void set_partition_queues(size_t count);
+
+/**
+ * Profiling totals so far, one entry per kind of command
+ */
+    std::vector<ProfileStats> get_profiling_stats();
+
+/**
+ * Clears the profiling totals
+ */
+    void reset_profiling();
+
+/**
+ * Writes the profiling totals as a table
+ */
+    void print_profiling(std::ostream& out);
+
+/**
+ * Turns tracing on or off (off by default), turning it on also turns profiling on and drops any earlier trace
+ * While on, operator calls and synchronize() waits are recorded as host spans, and every profiled command as a device span
+ */
+    void set_tracing(bool enabled);
+
+/**
+ * Writes the recorded spans in the Chrome trace JSON format, which chrome://tracing and Perfetto load
+ */
+    void write_trace(std::ostream& out);
+
+/**
+ * Memory held by the library now and at its peak
+ */
+    MemoryStats get_memory_stats();
+
+/**
+ * Allocations per operation, one entry per operation that allocated
+ */
+    std::vector<OperationMemory> get_operation_memory();
+
+/**
+ * Starts the peaks from the bytes held now and clears the allocation counts
+ */
+    void reset_memory_stats();
+
 /**
  * Releases all kernel memory allocations -> to be called at the end of any program that uses Matrix class
+ * Releases the calling thread's queue and kernels, the shared context is released by the last thread to finish
  */
-    void static finish_parallel();
+    void finish_parallel();
 }
 
 
@@ -1,3 +1,7 @@
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
 #include "gtest/gtest.h"
 #include "numcpp.h"
 
@@ -16,4 +20,1190 @@ TEST(MatrixOps, transpose_dim_check) {
 
     auto mat1 = numcpp::Matrix(1, 2, 10);
     EXPECT_TRUE(numcpp::transpose(mat1).get_columns() == 1 && numcpp::transpose(mat1).get_rows() == 2);
-}
\ No newline at end of file
+}
+
+class ArrayReader: public numcpp::Reader {
+
+    const float* values;
+    size_t index = 0;
+
+public:
+    explicit ArrayReader(const float* values) : values(values) {}
+
+    float read() override {
+        return values[index++];
+    }
+};
+
+TEST(MatrixOps, matmul_vector_check) {
+
+    numcpp::init_parallel();
+
+    const float a_values[] = { 1, 2, 3, 4, 5, 6 };
+    const float x_values[] = { 1, 0, -1 };
+    ArrayReader a_reader(a_values), x_reader(x_values);
+
+    auto y = numcpp::matmul(numcpp::Matrix(2, 3, &a_reader), numcpp::Matrix(3, 1, &x_reader));
+
+    EXPECT_EQ(y.get_rows(), 2);
+    EXPECT_EQ(y.get_columns(), 1);
+    EXPECT_FLOAT_EQ(y.get_element(0, 0), -2);
+    EXPECT_FLOAT_EQ(y.get_element(1, 0), -2);
+}
+
+TEST(MatrixOps, gemm_check) {
+
+    numcpp::init_parallel();
+
+    auto a = numcpp::Matrix(4, 3, 10);
+    auto b = numcpp::Matrix(2, 4, 10);
+    auto c = numcpp::Matrix(3, 2, 10);
+    auto initial = numcpp::Matrix(3, 2);
+
+    for (size_t i = 0; i < 3; i++)
+        for (size_t j = 0; j < 2; j++)
+            initial.set_element(i, j, c.get_element(i, j));
+
+    //c = 2 * a^T * b^T - c
+    numcpp::gemm(true, true, 2, a, b, -1, c);
+
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t j = 0; j < 2; j++) {
+
+            float expected = -initial.get_element(i, j);
+
+            for (size_t k = 0; k < 4; k++)
+                expected += 2 * a.get_element(k, i) * b.get_element(j, k);
+
+            EXPECT_FLOAT_EQ(c.get_element(i, j), expected);
+        }
+    }
+
+    EXPECT_THROW(numcpp::gemm(false, false, 1, a, b, 0, c), numcpp::MatrixStatus);
+}
+
+TEST(MatrixOps, mask_check) {
+
+    numcpp::init_parallel();
+
+    auto a = numcpp::Matrix(40, 30, 10);
+    auto mask = a > 4.0f;
+
+    EXPECT_EQ(sizeof(*mask.get_matrix()), 1);
+
+    size_t expected = 0;
+
+    for (size_t i = 0; i < 40; i++)
+        for (size_t j = 0; j < 30; j++)
+            expected += a.get_element(i, j) > 4 ? 1 : 0;
+
+    EXPECT_EQ(numcpp::count_nonzero(mask), expected);
+    EXPECT_TRUE(numcpp::any(a >= 0.0f));
+    EXPECT_TRUE(numcpp::all(a >= 0.0f));
+    EXPECT_FALSE(numcpp::any(a < 0.0f));
+
+    auto selected = numcpp::masked_select(a, mask);
+    size_t k = 0;
+
+    EXPECT_EQ(selected.get_rows(), expected);
+
+    for (size_t i = 0; i < 40; i++)
+        for (size_t j = 0; j < 30; j++)
+            if (a.get_element(i, j) > 4)
+                EXPECT_EQ(selected.get_element(k++, 0), a.get_element(i, j));
+
+    auto equal = a == a;
+    EXPECT_EQ(numcpp::count_nonzero(equal), 40 * 30);
+}
+
+TEST(MatrixOps, math_check) {
+
+    numcpp::init_parallel();
+
+    const float a_values[] = { -2, -0.5, 0, 0.25, 1, 3 };
+    ArrayReader a_reader(a_values);
+
+    auto a = numcpp::Matrix(2, 3, &a_reader);
+    auto exp = numcpp::exp(a);
+    auto sigmoid = numcpp::sigmoid(a);
+    auto relu = numcpp::relu(a);
+    auto clip = numcpp::clip(a, -1, 1);
+    auto tanh = numcpp::tanh(a);
+    auto erf = numcpp::erf(a);
+
+    for (size_t i = 0; i < 6; i++) {
+
+        float x = a_values[i];
+
+        EXPECT_NEAR(exp.get_matrix()[i], std::exp(x), 1e-5 * std::exp(x));
+        EXPECT_NEAR(sigmoid.get_matrix()[i], 1 / (1 + std::exp(-x)), 1e-6);
+        EXPECT_EQ(relu.get_matrix()[i], x > 0 ? x : 0);
+        EXPECT_EQ(clip.get_matrix()[i], std::min(1.0f, std::max(-1.0f, x)));
+        EXPECT_NEAR(tanh.get_matrix()[i], std::tanh(x), 1e-6);
+        EXPECT_NEAR(erf.get_matrix()[i], std::erf(x), 1e-6);
+    }
+
+    auto positive = numcpp::abs(a);
+
+    EXPECT_NEAR(numcpp::sqrt(positive).get_element(1, 2), std::sqrt(3.0f), 1e-6);
+    EXPECT_NEAR(numcpp::rsqrt(positive).get_element(1, 1), 1, 1e-6);
+    EXPECT_NEAR(numcpp::log(positive).get_element(0, 0), std::log(2.0f), 1e-6);
+    EXPECT_NEAR(numcpp::log1p(positive).get_element(1, 0), std::log1p(0.25f), 1e-6);
+    EXPECT_NEAR(numcpp::sin(a).get_element(1, 2), std::sin(3.0f), 1e-6);
+    EXPECT_NEAR(numcpp::cos(a).get_element(1, 2), std::cos(3.0f), 1e-6);
+
+    numcpp::set_fast_math(true);
+    EXPECT_NEAR(numcpp::exp(a).get_element(1, 2), std::exp(3.0f), 1e-3);
+    numcpp::set_fast_math(false);
+}
+
+TEST(MatrixOps, in_place_check) {
+
+    numcpp::init_parallel();
+
+    auto x = numcpp::Matrix(3, 4, 10);
+    auto g = numcpp::Matrix(3, 4, 10);
+    auto step = numcpp::Matrix(3, 4);
+    auto expected = numcpp::Matrix(3, 4);
+
+    for (size_t i = 0; i < 12; i++)
+        expected.get_matrix()[i] = x.get_matrix()[i];
+
+    float* storage = x.get_matrix();
+
+    //x = x - lr * g without allocating a new matrix per step
+    for (int iteration = 0; iteration < 3; iteration++) {
+
+        numcpp::multiply(g, 0.5f, step);
+        x -= step;
+
+        for (size_t i = 0; i < 12; i++)
+            expected.get_matrix()[i] -= 0.5f * g.get_matrix()[i];
+    }
+
+    EXPECT_EQ(x.get_matrix(), storage);
+
+    for (size_t i = 0; i < 12; i++)
+        EXPECT_FLOAT_EQ(x.get_matrix()[i], expected.get_matrix()[i]);
+
+    x *= 2.0f;
+    EXPECT_FLOAT_EQ(x.get_element(2, 3), 2 * expected.get_element(2, 3));
+
+    numcpp::add(g, g, step);
+    step ^= 2;
+    EXPECT_FLOAT_EQ(step.get_element(1, 1), 4 * g.get_element(1, 1) * g.get_element(1, 1));
+
+    step *= g;
+    step += g;
+    EXPECT_FLOAT_EQ(step.get_element(0, 2), 4 * powf(g.get_element(0, 2), 3) + g.get_element(0, 2));
+
+    EXPECT_THROW(numcpp::add(g, numcpp::Matrix(2, 2), step), numcpp::MatrixStatus);
+}
+
+TEST(MatrixOps, typed_check) {
+
+    numcpp::init_parallel();
+
+    const float a_values[] = { 1, 2, 3, 4, 5, 6 };
+    const float b_values[] = { 100, 100, 100, 100, 100, 100 };
+    ArrayReader a_reader(a_values), b_reader(b_values);
+
+    auto a = numcpp::astype<double>(numcpp::Matrix(2, 3, &a_reader));
+    auto b = numcpp::astype<double>(numcpp::Matrix(3, 2, &b_reader));
+    auto product = numcpp::matmul(a, b);
+
+    EXPECT_DOUBLE_EQ(product.get_element(1, 1), 1500);
+    EXPECT_DOUBLE_EQ(numcpp::transpose(a).get_element(2, 1), 6);
+
+    //int8 sums saturate instead of wrapping
+    auto narrow = numcpp::astype<int8_t>(b);
+    auto sum = narrow + narrow;
+
+    EXPECT_EQ(sum.get_element(0, 0), 127);
+
+    auto half_a = numcpp::astype<numcpp::half>(a);
+    auto half_sum = half_a + half_a;
+
+    EXPECT_FLOAT_EQ(half_sum.get_element(1, 2), 12);
+    EXPECT_FLOAT_EQ(numcpp::matmul(half_a, numcpp::astype<numcpp::half>(b)).get_element(0, 0), 600);
+    EXPECT_FLOAT_EQ(numcpp::transpose(half_a).get_element(2, 1), 6);
+
+    auto wide = numcpp::astype<int32_t>(a);
+    EXPECT_EQ((wide * wide).get_element(1, 0), 16);
+    EXPECT_THROW(wide - numcpp::astype<int32_t>(b), numcpp::MatrixStatus);
+
+    //conversions to integers saturate and take NaN to zero
+    const float extreme_values[] = { 1e10f, -1e10f, NAN, -3.7f };
+    ArrayReader extreme_reader(extreme_values);
+    auto extreme = numcpp::Matrix(1, 4, &extreme_reader);
+    auto extreme_narrow = numcpp::astype<int8_t>(extreme);
+    auto extreme_wide = numcpp::astype<int32_t>(extreme);
+
+    EXPECT_EQ(extreme_narrow.get_element(0, 0), 127);
+    EXPECT_EQ(extreme_narrow.get_element(0, 1), -128);
+    EXPECT_EQ(extreme_narrow.get_element(0, 2), 0);
+    EXPECT_EQ(extreme_narrow.get_element(0, 3), -3);
+    EXPECT_EQ(extreme_wide.get_element(0, 0), 2147483647);
+    EXPECT_EQ(extreme_wide.get_element(0, 1), -2147483647 - 1);
+    EXPECT_EQ(extreme_wide.get_element(0, 2), 0);
+}
+
+TEST(MatrixOps, matmul_batched_check) {
+
+    numcpp::init_parallel();
+
+    auto a = numcpp::Matrix(3 * 4, 5, 10);
+    auto b = numcpp::Matrix(3 * 5, 2, 10);
+    auto shared = numcpp::Matrix(5, 2, 10);
+    auto c = numcpp::matmul_batched(a, b, 3);
+    auto d = numcpp::matmul_batched(a, shared, 3);
+
+    EXPECT_EQ(c.get_rows(), 12);
+    EXPECT_EQ(c.get_columns(), 2);
+
+    for (size_t p = 0; p < 3; p++) {
+        for (size_t i = 0; i < 4; i++) {
+            for (size_t j = 0; j < 2; j++) {
+
+                float expected = 0, expected_shared = 0;
+
+                for (size_t k = 0; k < 5; k++) {
+                    expected += a.get_element(p * 4 + i, k) * b.get_element(p * 5 + k, j);
+                    expected_shared += a.get_element(p * 4 + i, k) * shared.get_element(k, j);
+                }
+
+                EXPECT_FLOAT_EQ(c.get_element(p * 4 + i, j), expected);
+                EXPECT_FLOAT_EQ(d.get_element(p * 4 + i, j), expected_shared);
+            }
+        }
+    }
+
+    try {
+        numcpp::matmul_batched(a, numcpp::Matrix(4, 2, 10), 3);
+        FAIL();
+    }
+    catch (numcpp::MatrixStatus status) {
+        EXPECT_EQ(status.get_error_code(), 20);
+    }
+}
+
+TEST(MatrixOps, solve_check) {
+
+    numcpp::init_parallel();
+
+    const float a_values[] = { 2, 1, 1, 4, 3, 3, 8, 7, 9 };
+    const float b_values[] = { 4, 10, 24 };
+    ArrayReader a_reader(a_values), b_reader(b_values);
+
+    auto a = numcpp::Matrix(3, 3, &a_reader);
+    auto b = numcpp::Matrix(3, 1, &b_reader);
+    auto x = numcpp::solve(a, b);
+
+    EXPECT_NEAR(x.get_element(0, 0), 1, 1e-4);
+    EXPECT_NEAR(x.get_element(1, 0), 1, 1e-4);
+    EXPECT_NEAR(x.get_element(2, 0), 1, 1e-4);
+}
+
+TEST(MatrixOps, det_inverse_check) {
+
+    numcpp::init_parallel();
+
+    const float a_values[] = { 2, 1, 1, 4, 3, 3, 8, 7, 9 };
+    ArrayReader a_reader(a_values);
+
+    auto a = numcpp::Matrix(3, 3, &a_reader);
+    auto product = numcpp::matmul(a, numcpp::inverse(a));
+
+    EXPECT_NEAR(numcpp::det(a), 4, 1e-4);
+
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t j = 0; j < 3; j++) {
+            EXPECT_NEAR(product.get_element(i, j), i == j ? 1 : 0, 1e-4);
+        }
+    }
+}
+
+//n spans three panels of the blocked factorization, so the trailing updates between panels run too
+TEST(MatrixOps, lu_blocked_check) {
+
+    numcpp::init_parallel();
+
+    const size_t n = 150;
+
+    auto a = numcpp::Matrix(n, n, 10);
+    auto b = numcpp::Matrix(n, 2, 10);
+    std::vector<int> pivots;
+    auto factors = numcpp::lu(a, pivots);
+
+    //P*A, with the interchanges applied in the order elimination made them
+    std::vector<double> permuted(n * n);
+
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+            permuted[i * n + j] = a.get_element(i, j);
+
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+            std::swap(permuted[i * n + j], permuted[pivots[i] * n + j]);
+
+    double residual = 0, largest = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+
+            double sum = 0;
+
+            for (size_t k = 0; k <= std::min(i, j); k++)
+                sum += (k == i ? 1.0 : factors.get_element(i, k)) * factors.get_element(k, j);
+
+            residual = std::max(residual, fabs(sum - permuted[i * n + j]));
+            largest = std::max(largest, fabs(permuted[i * n + j]));
+        }
+    }
+
+    EXPECT_LT(residual / largest, 1e-4);
+
+    auto x = numcpp::solve(a, b);
+    auto product = numcpp::matmul(a, x);
+
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < 2; j++)
+            EXPECT_NEAR(product.get_element(i, j), b.get_element(i, j), 1e-2);
+
+    for (auto matrix : { a, b, factors, x, product })
+        matrix.clean_up();
+}
+
+TEST(MatrixOps, solve_singular_check) {
+
+    numcpp::init_parallel();
+
+    const float a_values[] = { 1, 2, 2, 4 };
+    ArrayReader a_reader(a_values);
+
+    auto a = numcpp::Matrix(2, 2, &a_reader);
+
+    EXPECT_THROW(numcpp::solve(a, a), numcpp::MatrixStatus);
+    EXPECT_EQ(numcpp::det(a), 0);
+}
+
+TEST(MatrixOps, cholesky_check) {
+
+    numcpp::init_parallel();
+
+    const float a_values[] = { 4, 12, -16, 12, 37, -43, -16, -43, 98 };
+    const float b_values[] = { 0, 6, 39 };
+    ArrayReader a_reader(a_values), b_reader(b_values);
+
+    auto a = numcpp::Matrix(3, 3, &a_reader);
+    auto b = numcpp::Matrix(3, 1, &b_reader);
+    auto l = numcpp::cholesky(a);
+
+    EXPECT_NEAR(l.get_element(0, 0), 2, 1e-4);
+    EXPECT_NEAR(l.get_element(1, 0), 6, 1e-4);
+    EXPECT_NEAR(l.get_element(2, 2), 3, 1e-4);
+    EXPECT_EQ(l.get_element(0, 2), 0);
+
+    auto x = numcpp::cho_solve(l, b);
+
+    EXPECT_NEAR(x.get_element(0, 0), 1, 1e-3);
+    EXPECT_NEAR(x.get_element(1, 0), 1, 1e-3);
+    EXPECT_NEAR(x.get_element(2, 0), 1, 1e-3);
+}
+
+TEST(MatrixOps, cholesky_blocked_check) {
+
+    numcpp::init_parallel();
+
+    const size_t n = 150;
+
+    //M*M^T + n*I is symmetric positive-definite and well conditioned
+    auto m = numcpp::Matrix(n, n, 10);
+    auto a = numcpp::Matrix(n, n);
+
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+
+            double sum = i == j ? n : 0;
+
+            for (size_t k = 0; k < n; k++)
+                sum += m.get_element(i, k) * m.get_element(j, k);
+
+            a.set_element(i, j, (float)sum);
+        }
+    }
+
+    auto l = numcpp::cholesky(a);
+    double residual = 0, largest = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+
+            double sum = 0;
+
+            for (size_t k = 0; k <= std::min(i, j); k++)
+                sum += (double)l.get_element(i, k) * l.get_element(j, k);
+
+            residual = std::max(residual, fabs(sum - a.get_element(i, j)));
+            largest = std::max(largest, (double)fabs(a.get_element(i, j)));
+        }
+    }
+
+    EXPECT_EQ(l.get_element(0, n - 1), 0);
+    EXPECT_LT(residual / largest, 1e-5);
+
+    for (auto matrix : { m, a, l })
+        matrix.clean_up();
+}
+
+TEST(MatrixOps, qr_check) {
+
+    numcpp::init_parallel();
+
+    const float a_values[] = { 12, -51, 4, 6, 167, -68, -4, 24, -41 };
+    ArrayReader a_reader(a_values);
+
+    auto a = numcpp::Matrix(3, 3, &a_reader);
+    auto q = numcpp::Matrix(1, 1);
+    auto r = numcpp::Matrix(1, 1);
+    numcpp::qr(a, q, r);
+
+    EXPECT_NEAR(fabs(r.get_element(0, 0)), 14, 1e-3);
+    EXPECT_NEAR(fabs(r.get_element(1, 1)), 175, 1e-2);
+    EXPECT_NEAR(fabs(r.get_element(2, 2)), 35, 1e-2);
+    EXPECT_EQ(r.get_element(2, 0), 0);
+
+    auto product = numcpp::matmul(q, r);
+
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t j = 0; j < 3; j++) {
+            EXPECT_NEAR(product.get_element(i, j), a.get_element(i, j), 1e-2);
+        }
+    }
+}
+
+TEST(MatrixOps, qr_blocked_check) {
+
+    numcpp::init_parallel();
+
+    const size_t m = 180, n = 150;
+
+    auto a = numcpp::Matrix(m, n, 10);
+    auto q = numcpp::Matrix(1, 1);
+    auto r = numcpp::Matrix(1, 1);
+    numcpp::qr(a, q, r);
+
+    ASSERT_EQ(q.get_rows(), m);
+    ASSERT_EQ(q.get_columns(), r.get_rows());
+
+    double residual = 0, orthogonality = 0, largest = 0;
+
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+
+            double sum = 0;
+
+            for (size_t k = 0; k <= std::min(j, r.get_rows() - 1); k++)
+                sum += (double)q.get_element(i, k) * r.get_element(k, j);
+
+            residual = std::max(residual, fabs(sum - a.get_element(i, j)));
+            largest = std::max(largest, (double)fabs(a.get_element(i, j)));
+        }
+    }
+
+    for (size_t i = 0; i < q.get_columns(); i++) {
+        for (size_t j = 0; j < q.get_columns(); j++) {
+
+            double sum = 0;
+
+            for (size_t k = 0; k < m; k++)
+                sum += (double)q.get_element(k, i) * q.get_element(k, j);
+
+            orthogonality = std::max(orthogonality, fabs(sum - (i == j ? 1 : 0)));
+        }
+    }
+
+    EXPECT_LT(residual / largest, 1e-4);
+    EXPECT_LT(orthogonality, 1e-4);
+
+    //the normal equations hold at the least squares solution: A^T (A x - b) = 0
+    auto b = numcpp::Matrix(m, 1, 10);
+    auto x = numcpp::lstsq(a, b);
+    auto fitted = numcpp::matmul(a, x);
+    double gradient = 0;
+
+    for (size_t j = 0; j < n; j++) {
+
+        double sum = 0;
+
+        for (size_t i = 0; i < m; i++)
+            sum += (double)a.get_element(i, j) * (fitted.get_element(i, 0) - b.get_element(i, 0));
+
+        gradient = std::max(gradient, fabs(sum));
+    }
+
+    EXPECT_LT(gradient / (largest * largest * m), 1e-5);
+
+    for (auto matrix : { a, q, r, b, x, fitted })
+        matrix.clean_up();
+}
+
+TEST(MatrixOps, lstsq_check) {
+
+    numcpp::init_parallel();
+
+    //y = 2x + 1 sampled twice, stacked as a batch of two identical regressions
+    const float a_values[] = { 1, 0, 1, 1, 1, 2, 1, 3, 1, 0, 1, 1, 1, 2, 1, 3 };
+    const float b_values[] = { 1, 3, 5, 7, 1, 3, 5, 7 };
+    ArrayReader a_reader(a_values), b_reader(b_values), a_single(a_values), b_single(b_values);
+
+    auto a = numcpp::Matrix(8, 2, &a_reader);
+    auto b = numcpp::Matrix(8, 1, &b_reader);
+    auto x = numcpp::lstsq(numcpp::Matrix(4, 2, &a_single), numcpp::Matrix(4, 1, &b_single));
+    auto batched = numcpp::lstsq_batched(a, b, 2);
+
+    EXPECT_NEAR(x.get_element(0, 0), 1, 1e-4);
+    EXPECT_NEAR(x.get_element(1, 0), 2, 1e-4);
+    EXPECT_EQ(batched.get_rows(), 4);
+    EXPECT_NEAR(batched.get_element(2, 0), 1, 1e-4);
+    EXPECT_NEAR(batched.get_element(3, 0), 2, 1e-4);
+
+    //the second problem has a zero column, the third two equal columns
+    const float singular_values[] = { 1, 0, 1, 1, 1, 2, 1, 3, 1, 0, 1, 0, 1, 0, 1, 0, 1, 1, 2, 2, 3, 3, 4, 4 };
+    const float rhs_values[] = { 1, 3, 5, 7, 1, 3, 5, 7, 1, 3, 5, 7 };
+    ArrayReader singular_reader(singular_values), rhs_reader(rhs_values);
+
+    auto singular = numcpp::Matrix(12, 2, &singular_reader);
+    auto rhs = numcpp::Matrix(12, 1, &rhs_reader);
+
+    EXPECT_THROW(numcpp::lstsq_batched(singular, rhs, 3), numcpp::MatrixStatus);
+    EXPECT_THROW(numcpp::lstsq_batched(singular.row_range(8, 12), rhs.row_range(8, 12), 1), numcpp::MatrixStatus);
+    EXPECT_NO_THROW(numcpp::lstsq_batched(singular.row_range(0, 4), rhs.row_range(0, 4), 1).clean_up());
+}
+
+TEST(MatrixOps, eigen_check) {
+
+    numcpp::init_parallel();
+
+    const float a_values[] = { 2, 1, 0, 1, 2, 0, 0, 0, 5 };
+    ArrayReader a_reader(a_values);
+
+    auto a = numcpp::Matrix(3, 3, &a_reader);
+    auto vectors = numcpp::Matrix(1, 1);
+    auto values = numcpp::eigh(a, vectors);
+
+    EXPECT_NEAR(values.get_element(0, 0), 1, 1e-4);
+    EXPECT_NEAR(values.get_element(1, 0), 3, 1e-4);
+    EXPECT_NEAR(values.get_element(2, 0), 5, 1e-4);
+    EXPECT_NEAR(fabs(vectors.get_element(2, 2)), 1, 1e-4);
+
+    numcpp::EigenStatus status{};
+    auto top = numcpp::eigsh(a, 2, vectors, 300, 0.0001, &status);
+
+    EXPECT_TRUE(status.converged);
+    EXPECT_NEAR(top.get_element(0, 0), 5, 1e-3);
+    EXPECT_NEAR(top.get_element(1, 0), 3, 1e-3);
+
+    EXPECT_NEAR(numcpp::dominant_eigen(a, vectors, 0.0001, 1000, &status), 5, 1e-3);
+    EXPECT_TRUE(status.converged);
+    EXPECT_LE(status.iterations, 1000);
+}
+
+TEST(MatrixOps, svd_randomized_check) {
+
+    numcpp::init_parallel();
+
+    //rank 2 matrix, streamed two rows at a time
+    const float a_values[] = { 3, 0, 0, 0, 0, 2, 0, 0, 3, 0, 0, 0, 0, 2, 0, 0, 3, 0, 0, 0, 0, 2, 0, 0 };
+    ArrayReader a_reader(a_values);
+
+    auto a = numcpp::Matrix(6, 4, &a_reader);
+    auto u = numcpp::Matrix(1, 1);
+    auto vt = numcpp::Matrix(1, 1);
+    auto s = numcpp::svd_randomized(a, 2, u, vt, 2, 2, 2);
+
+    EXPECT_NEAR(s.get_element(0, 0), 3 * sqrtf(3), 1e-3);
+    EXPECT_NEAR(s.get_element(1, 0), 2 * sqrtf(3), 1e-3);
+    EXPECT_EQ(u.get_rows(), 6);
+    EXPECT_EQ(vt.get_columns(), 4);
+
+    for (size_t i = 0; i < 6; i++) {
+        for (size_t j = 0; j < 4; j++) {
+
+            float value = 0;
+
+            for (size_t p = 0; p < 2; p++)
+                value += u.get_element(i, p) * s.get_element(p, 0) * vt.get_element(p, j);
+
+            EXPECT_NEAR(value, a.get_element(i, j), 1e-3);
+        }
+    }
+}
+
+TEST(MatrixOps, svd_randomized_spread_check) {
+
+    numcpp::init_parallel();
+
+    //A = U * S * V^T from orthonormal cosine bases with singular values spanning five decades, well past where
+    //Cholesky QR of the sketch or the eigenvalues of B * B^T lose the smallest ones in float
+    const size_t m = 120, n = 80, rank = 6;
+    const float spectrum[rank] = { 1e2f, 1e1f, 1e0f, 1e-1f, 1e-2f, 1e-3f };
+    const double pi = 3.14159265358979323846;
+
+    auto basis = [pi](size_t size, size_t i, size_t j) {
+        return (j == 0 ? sqrt(1.0 / size) : sqrt(2.0 / size)) * cos(pi * (i + 0.5) * j / size);
+    };
+
+    auto a = numcpp::Matrix(m, n);
+
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+
+            double value = 0;
+
+            for (size_t p = 0; p < rank; p++)
+                value += basis(m, i, p) * spectrum[p] * basis(n, j, p + 1);
+
+            a.set_element(i, j, (float)value);
+        }
+    }
+
+    auto u = numcpp::Matrix(1, 1);
+    auto vt = numcpp::Matrix(1, 1);
+    auto s = numcpp::svd_randomized(a, rank, u, vt, 2, 4, 16);
+
+    for (size_t p = 0; p < rank; p++)
+        EXPECT_NEAR(s.get_element(p, 0) / spectrum[p], 1, 1e-2);
+
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+
+            float value = 0;
+
+            for (size_t p = 0; p < rank; p++)
+                value += u.get_element(i, p) * s.get_element(p, 0) * vt.get_element(p, j);
+
+            EXPECT_NEAR(value, a.get_element(i, j), 1e-3);
+        }
+    }
+}
+
+TEST(MatrixOps, concurrent_check) {
+
+    numcpp::init_parallel();
+
+    const int thread_count = 4;
+    bool correct[thread_count];
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < thread_count; t++) {
+
+        threads.emplace_back([t, &correct]() {
+
+            numcpp::init_parallel();
+
+            auto a = numcpp::Matrix(8, 8);
+            auto b = numcpp::Matrix(8, 8);
+            a.ones((float)t);
+            b.ones();
+            correct[t] = true;
+
+            for (int i = 0; i < 20; i++) {
+
+                auto sum = a + b;
+                auto product = numcpp::matmul(a, b);
+
+                correct[t] = correct[t] && sum.get_element(3, 5) == t + 1 && product.get_element(5, 3) == 8 * t;
+            }
+
+            numcpp::finish_parallel();
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (int t = 0; t < thread_count; t++)
+        EXPECT_TRUE(correct[t]);
+}
+
+TEST(MatrixOps, partitioned_check) {
+
+    numcpp::init_parallel();
+
+    //three queues per device split the operations in uneven row blocks even on a single device
+    numcpp::set_partition_queues(3);
+    numcpp::set_profiling(true);
+    numcpp::reset_profiling();
+
+    auto a = numcpp::Matrix(256, 12, 10);
+    auto b = numcpp::Matrix(12, 5, 10);
+    auto c = numcpp::Matrix(256, 12, 10);
+
+    auto product = numcpp::matmul(a, b);
+    auto sum = a + c;
+
+    std::map<std::string, numcpp::ProfileStats> by_command;
+
+    for (auto& entry : numcpp::get_profiling_stats())
+        by_command[entry.command] = entry;
+
+    numcpp::set_profiling(false);
+    numcpp::set_partition_queues(1);
+
+    EXPECT_GE(by_command["parallel_matrix_multiply"].count, 3);
+    EXPECT_GE(by_command["parallel_adder"].count, 3);
+
+    for (size_t i = 0; i < 256; i++) {
+
+        for (size_t j = 0; j < 5; j++) {
+
+            float value = 0;
+
+            for (size_t k = 0; k < 12; k++)
+                value += a.get_element(i, k) * b.get_element(k, j);
+
+            EXPECT_FLOAT_EQ(product.get_element(i, j), value);
+        }
+
+        for (size_t j = 0; j < 12; j++)
+            EXPECT_FLOAT_EQ(sum.get_element(i, j), a.get_element(i, j) + c.get_element(i, j));
+    }
+}
+
+TEST(MatrixOps, profiling_check) {
+
+    numcpp::init_parallel();
+    numcpp::set_profiling(true);
+    numcpp::reset_profiling();
+
+    auto a = numcpp::Matrix(4, 8, 10);
+    auto b = numcpp::Matrix(4, 8, 10);
+    auto sum = a + b;
+
+    auto stats = numcpp::get_profiling_stats();
+    numcpp::set_profiling(false);
+
+    std::map<std::string, numcpp::ProfileStats> by_command;
+
+    for (auto& entry : stats)
+        by_command[entry.command] = entry;
+
+    EXPECT_EQ(by_command["parallel_adder"].count, 1);
+
+    if (numcpp::is_zero_copy()) {
+
+        EXPECT_EQ(by_command.count("write"), 0);
+        EXPECT_EQ(by_command["map"].bytes, 4 * 8 * sizeof(float));
+    }
+    else {
+
+        EXPECT_EQ(by_command["write"].bytes, 2 * 4 * 8 * sizeof(float));
+        EXPECT_EQ(by_command["read"].bytes, 4 * 8 * sizeof(float));
+        EXPECT_EQ(by_command["create buffer"].count, 3);
+    }
+}
+
+TEST(MatrixOps, trace_check) {
+
+    numcpp::init_parallel();
+    numcpp::set_tracing(true);
+
+    auto a = numcpp::Matrix(4, 8, 10);
+    auto b = numcpp::Matrix(4, 8, 10);
+    auto sum = a + b;
+
+    std::ostringstream trace;
+    numcpp::write_trace(trace);
+
+    numcpp::set_tracing(false);
+    numcpp::set_profiling(false);
+
+    EXPECT_NE(trace.str().find("\"traceEvents\""), std::string::npos);
+    EXPECT_NE(trace.str().find("\"name\": \"operator+\", \"cat\": \"host\""), std::string::npos);
+    EXPECT_NE(trace.str().find("\"name\": \"parallel_adder\", \"cat\": \"device\""), std::string::npos);
+    EXPECT_NE(trace.str().find("\"name\": \"synchronize\""), std::string::npos);
+}
+
+TEST(MatrixOps, memory_check) {
+
+    numcpp::init_parallel();
+    numcpp::reset_memory_stats();
+
+    auto before = numcpp::get_memory_stats();
+    auto a = numcpp::Matrix(4, 4, 10);
+    auto b = numcpp::Matrix(4, 4, 10);
+
+    EXPECT_EQ(numcpp::get_memory_stats().host_bytes, before.host_bytes + 2 * 16 * sizeof(float));
+
+    auto sum = a + b;
+    auto after = numcpp::get_memory_stats();
+
+    //operator buffers are released before it returns, only its result stays on the host
+    EXPECT_EQ(after.device_bytes, before.device_bytes);
+
+    std::map<std::string, numcpp::OperationMemory> by_operation;
+
+    for (auto& entry : numcpp::get_operation_memory())
+        by_operation[entry.operation] = entry;
+
+    //zero-copy buffers wrap host storage and hold no device memory of their own
+    size_t device_buffers = numcpp::is_zero_copy() ? 0 : 3;
+
+    EXPECT_GE(after.device_peak, before.device_bytes + device_buffers * 16 * sizeof(float));
+    EXPECT_EQ(by_operation["operator+"].device_allocations, device_buffers);
+    EXPECT_EQ(by_operation["operator+"].device_bytes, device_buffers * 16 * sizeof(float));
+    EXPECT_EQ(by_operation["(outside operations)"].host_allocations, 2);
+
+    //the two broadcast buffers are held next to the result while the operator runs
+    EXPECT_EQ(by_operation["operator+"].host_allocations, 3);
+    EXPECT_GE(after.host_peak, before.host_bytes + 5 * 16 * sizeof(float));
+
+    a.clean_up();
+    b.clean_up();
+    sum.clean_up();
+
+    EXPECT_EQ(numcpp::get_memory_stats().host_bytes, after.host_bytes - 3 * 16 * sizeof(float));
+}
+
+TEST(MatrixOps, zero_copy_check) {
+
+    numcpp::init_parallel();
+
+    auto a = numcpp::Matrix(16, 256, 10);
+    auto b = numcpp::Matrix(16, 256, 10);
+
+    //storage spanning pages is page aligned so runtimes can wrap it in place
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a.get_matrix()) % 4096, 0);
+
+    numcpp::set_profiling(true);
+    numcpp::reset_profiling();
+
+    auto product = a * b;
+    auto scaled = a * 2.0f;
+
+    std::map<std::string, numcpp::ProfileStats> by_command;
+
+    for (auto& entry : numcpp::get_profiling_stats())
+        by_command[entry.command] = entry;
+
+    numcpp::set_profiling(false);
+
+    if (numcpp::is_zero_copy()) {
+
+        //only the scalar operand is written, matrices are neither written nor read back
+        EXPECT_EQ(by_command["write"].bytes, sizeof(float));
+        EXPECT_EQ(by_command.count("read"), 0);
+    }
+
+    for (size_t i = 0; i < 16; i++) {
+
+        for (size_t j = 0; j < 256; j++) {
+
+            EXPECT_FLOAT_EQ(product.get_element(i, j), a.get_element(i, j) * b.get_element(i, j));
+            EXPECT_FLOAT_EQ(scaled.get_element(i, j), a.get_element(i, j) * 2);
+        }
+    }
+}
+
+TEST(MatrixOps, pinned_check) {
+
+    numcpp::init_parallel();
+
+    //6 MB of pageable storage, staged in chunks on discrete devices
+    auto a = numcpp::Matrix(1536, 1024, 10);
+
+    numcpp::set_pinned_memory(true);
+
+    auto b = numcpp::Matrix(1536, 1024, 10);
+    auto sum = a + b;
+    auto flipped = numcpp::transpose(a);
+
+    numcpp::set_pinned_memory(false);
+
+    for (size_t i = 0; i < 1536; i += 97) {
+
+        for (size_t j = 0; j < 1024; j += 31) {
+
+            EXPECT_FLOAT_EQ(sum.get_element(i, j), a.get_element(i, j) + b.get_element(i, j));
+            EXPECT_FLOAT_EQ(flipped.get_element(j, i), a.get_element(i, j));
+        }
+    }
+
+    a.clean_up();
+    b.clean_up();
+    sum.clean_up();
+    flipped.clean_up();
+}
+
+//hands out 64-byte aligned slices of one buffer and counts the calls
+class CountingAllocator: public numcpp::Allocator {
+
+public:
+    std::vector<char> pool = std::vector<char>(1 << 20);
+    size_t used = 0, allocations = 0, deallocations = 0;
+
+    void* allocate(size_t size) override {
+
+        void* data = pool.data() + used;
+        size_t space = pool.size() - used;
+
+        std::align(64, size, data, space);
+        used = pool.size() - space + size;
+        allocations++;
+
+        return data;
+    }
+
+    void deallocate(void*, size_t) override {
+
+        deallocations++;
+    }
+};
+
+TEST(MatrixOps, allocator_check) {
+
+    numcpp::init_parallel();
+
+    auto small = numcpp::Matrix(3, 5, 10);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(small.get_matrix()) % 64, 0);
+
+    CountingAllocator counting;
+    numcpp::set_allocator(&counting);
+
+    auto a = numcpp::Matrix(4, 4, 10);
+    numcpp::set_allocator(nullptr);
+
+    //storage goes back to the allocator it came from, whichever is set now
+    a.clean_up();
+    EXPECT_EQ(counting.allocations, 1);
+    EXPECT_EQ(counting.deallocations, 1);
+
+    auto before = numcpp::get_memory_stats().host_bytes;
+    auto outlived = small.row_range(0, 1);
+
+    {
+        numcpp::Arena arena;
+
+        auto b = numcpp::Matrix(32, 16, 10);
+        auto c = numcpp::Matrix(32, 16, 10);
+        auto sum = b + c;
+
+        EXPECT_EQ(numcpp::get_allocator(), &arena);
+        EXPECT_FLOAT_EQ(sum.get_element(7, 3), b.get_element(7, 3) + c.get_element(7, 3));
+
+        c.clean_up();
+        outlived = sum;
+    }
+
+    //the arena freed its matrices and temporaries in one go, cleaning one up afterwards does nothing
+    outlived.clean_up();
+
+    EXPECT_EQ(numcpp::get_allocator(), nullptr);
+    EXPECT_EQ(numcpp::get_memory_stats().host_bytes, before);
+
+    //storage handed out again after an arena ended belongs to the new matrix alone, even at the same address
+    auto stale = small.row_range(0, 1);
+
+    {
+        numcpp::Arena arena(4096);
+        stale = numcpp::Matrix(8, 8, 10);
+    }
+
+    auto fresh = numcpp::Matrix(32, 32, 10);
+
+    stale.clean_up();
+    fresh.clean_up();
+
+    EXPECT_EQ(numcpp::get_memory_stats().host_bytes, before);
+
+    small.clean_up();
+}
+
+TEST(MatrixOps, view_check) {
+
+    numcpp::init_parallel();
+
+    auto a = numcpp::Matrix(8, 12, 10);
+
+    auto tile = a.block(2, 3, 4, 5);
+    auto rows = a.row_range(4, 8);
+    auto columns = a.column_range(0, 4);
+    auto every_other = a.strided(2, 3);
+
+    EXPECT_TRUE(tile.is_view());
+    EXPECT_FALSE(tile.is_contiguous());
+    EXPECT_TRUE(rows.is_contiguous());
+    EXPECT_EQ(every_other.get_rows(), 4);
+    EXPECT_EQ(every_other.get_columns(), 4);
+    EXPECT_EQ(tile.get_element(1, 2), a.get_element(3, 5));
+    EXPECT_EQ(every_other.get_element(3, 1), a.get_element(6, 3));
+
+    auto scaled = tile * 2.0f;
+    auto flipped = numcpp::transpose(every_other);
+    auto product = numcpp::matmul(a.block(0, 0, 4, 8), columns);
+    auto sum = tile + a.block(0, 0, 4, 5);
+
+    for (size_t i = 0; i < 4; i++) {
+
+        for (size_t j = 0; j < 5; j++) {
+
+            EXPECT_FLOAT_EQ(scaled.get_element(i, j), 2 * a.get_element(i + 2, j + 3));
+            EXPECT_FLOAT_EQ(sum.get_element(i, j), a.get_element(i + 2, j + 3) + a.get_element(i, j));
+        }
+
+        for (size_t j = 0; j < 4; j++) {
+
+            float expected = 0;
+
+            for (size_t k = 0; k < 8; k++)
+                expected += a.get_element(i, k) * a.get_element(k, j);
+
+            EXPECT_FLOAT_EQ(product.get_element(i, j), expected);
+            EXPECT_FLOAT_EQ(flipped.get_element(j, i), a.get_element(2 * i, 3 * j));
+        }
+    }
+
+    //results written into a view land in the matrix, around it nothing changes
+    float before = a.get_element(1, 3);
+    numcpp::add(rows.block(0, 0, 4, 5), sum, tile);
+
+    EXPECT_FLOAT_EQ(a.get_element(2, 3), a.get_element(4, 0) + sum.get_element(0, 0));
+    EXPECT_FLOAT_EQ(a.get_element(1, 3), before);
+
+    tile.clean_up();
+    a.clean_up();
+    scaled.clean_up();
+    flipped.clean_up();
+    product.clean_up();
+    sum.clean_up();
+}
+
+TEST(MatrixOps, assembly_check) {
+
+    numcpp::init_parallel();
+
+    auto a = numcpp::Matrix(4, 6, 10);
+    auto b = numcpp::Matrix(3, 6, 10);
+
+    auto reshaped = a.reshape(3, 8);
+    auto packed = a.block(0, 1, 2, 3).reshape(3, 2);
+
+    EXPECT_TRUE(reshaped.is_view());
+    EXPECT_FALSE(packed.is_view());
+    EXPECT_EQ(reshaped.get_element(1, 0), a.get_element(1, 2));
+    EXPECT_EQ(packed.get_element(2, 0), a.get_element(1, 2));
+    EXPECT_THROW(a.reshape(5, 5), numcpp::MatrixStatus);
+
+    auto tall = numcpp::vstack({ a.row_range(0, 2), b });
+    auto wide = numcpp::hstack({ a, a.column_range(4, 6) });
+
+    ASSERT_EQ(tall.get_rows(), 5);
+    ASSERT_EQ(wide.get_columns(), 8);
+    EXPECT_EQ(tall.get_element(1, 5), a.get_element(1, 5));
+    EXPECT_EQ(tall.get_element(4, 2), b.get_element(2, 2));
+    EXPECT_EQ(wide.get_element(3, 5), a.get_element(3, 5));
+    EXPECT_EQ(wide.get_element(3, 7), a.get_element(3, 5));
+    EXPECT_THROW(numcpp::hstack({ a, b }), numcpp::MatrixStatus);
+
+    //the result is the only storage a concatenation allocates
+    numcpp::reset_memory_stats();
+    auto joined = numcpp::vstack({ a, b });
+
+    EXPECT_EQ(numcpp::get_memory_stats().host_allocations, 1);
+
+    auto halves = numcpp::split(a, 2);
+    auto thirds = numcpp::split(a, std::vector<size_t>{ 1, 4 }, 1);
+
+    ASSERT_EQ(halves.size(), 2);
+    ASSERT_EQ(thirds.size(), 3);
+    EXPECT_TRUE(halves[1].is_view());
+    EXPECT_EQ(halves[1].get_element(0, 0), a.get_element(2, 0));
+    EXPECT_EQ(thirds[1].get_columns(), 3);
+    EXPECT_EQ(thirds[2].get_element(3, 1), a.get_element(3, 5));
+
+    //large enough to be copied by several host threads
+    auto big = numcpp::Matrix(1024, 1024, 10);
+    auto stacked = numcpp::vstack({ big, big.block(0, 0, 512, 1024) });
+
+    EXPECT_EQ(stacked.get_element(1023, 1023), big.get_element(1023, 1023));
+    EXPECT_EQ(stacked.get_element(1535, 7), big.get_element(511, 7));
+
+    for (auto matrix : { a, b, packed, tall, wide, joined, big, stacked })
+        matrix.clean_up();
+}
+
+TEST(MatrixOps, gather_check) {
+
+    numcpp::init_parallel();
+
+    auto a = numcpp::Matrix(6, 5, 10);
+
+    auto rows = numcpp::take(a, { 4, 0, 4 });
+    auto columns = numcpp::take(a.block(1, 0, 4, 5), { 3, 1 }, 1);
+
+    ASSERT_EQ(rows.get_rows(), 3);
+    ASSERT_EQ(columns.get_columns(), 2);
+    EXPECT_EQ(rows.get_element(0, 2), a.get_element(4, 2));
+    EXPECT_EQ(rows.get_element(2, 4), a.get_element(4, 4));
+    EXPECT_EQ(columns.get_element(3, 0), a.get_element(4, 3));
+    EXPECT_EQ(columns.get_element(0, 1), a.get_element(1, 1));
+    EXPECT_THROW(numcpp::take(a, { 6 }), numcpp::MatrixStatus);
+
+    auto first = a.column_range(0, 1);
+    auto mask = first > 4.0f;
+    auto selected = numcpp::compress(a, mask);
+    size_t k = 0;
+
+    for (size_t i = 0; i < 6; i++) {
+
+        if (a.get_element(i, 0) > 4)
+            EXPECT_EQ(selected.get_element(k++, 3), a.get_element(i, 3));
+    }
+
+    EXPECT_EQ(selected.get_rows(), k);
+
+    numcpp::BasicMatrix<int32_t> indices(2, 5);
+
+    for (size_t j = 0; j < 5; j++) {
+
+        indices.set_element(0, j, (int32_t)j);
+        indices.set_element(1, j, (int32_t)(4 - j));
+    }
+
+    auto along_rows = numcpp::take_along_axis(a, indices, 0);
+    auto along_columns = numcpp::take_along_axis(a.row_range(0, 2), indices, 1);
+
+    EXPECT_EQ(along_rows.get_element(0, 3), a.get_element(3, 3));
+    EXPECT_EQ(along_rows.get_element(1, 1), a.get_element(3, 1));
+    EXPECT_EQ(along_columns.get_element(1, 4), a.get_element(1, 0));
+    EXPECT_THROW(numcpp::take_along_axis(a.row_range(0, 2), indices, 0), numcpp::MatrixStatus);
+
+    auto target = numcpp::Matrix(4, 5);
+    target.zeroes();
+
+    numcpp::scatter_add(target, { 1, 3, 1 }, a.row_range(0, 3));
+
+    EXPECT_EQ(target.get_element(0, 2), 0.0f);
+    EXPECT_FLOAT_EQ(target.get_element(1, 2), a.get_element(0, 2) + a.get_element(2, 2));
+    EXPECT_EQ(target.get_element(3, 4), a.get_element(1, 4));
+    EXPECT_THROW(numcpp::scatter_add(target, { 0, 4, 1 }, a.row_range(0, 3)), numcpp::MatrixStatus);
+
+    //large enough to be gathered by several host threads
+    auto big = numcpp::Matrix(1024, 1024, 10);
+    std::vector<int> order;
+
+    for (int i = 2047; i >= 0; i--)
+        order.push_back(i % 1024);
+
+    auto shuffled = numcpp::take(big, order);
+
+    EXPECT_EQ(shuffled.get_element(0, 9), big.get_element(1023, 9));
+    EXPECT_EQ(shuffled.get_element(2047, 1023), big.get_element(0, 1023));
+
+    for (auto matrix : { a, rows, columns, selected, along_rows, along_columns, target, big, shuffled })
+        matrix.clean_up();
+
+    mask.clean_up();
+    indices.clean_up();
+}
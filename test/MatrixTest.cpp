@@ -29,4 +29,22 @@ TEST(Matrix, init_mat_wreader) {
 
     auto mat = new numcpp::Matrix(1, 1, new ConsoleReader());
     mat->get_element(1, 1);
-}
\ No newline at end of file
+}
+
+TEST(Matrix, half_conversion) {
+    EXPECT_EQ((float)numcpp::half(1.5f), 1.5f);
+    EXPECT_EQ((float)numcpp::half(-2.0f), -2.0f);
+    EXPECT_EQ((float)numcpp::half(65504.0f), 65504.0f);
+    EXPECT_EQ(numcpp::half(1.0f + 1.0f / 4096).bits, numcpp::half(1.0f).bits);
+    EXPECT_TRUE(std::isinf((float)numcpp::half(1e6f)));
+}
+
+TEST(Matrix, init_typed) {
+    auto mat = numcpp::BasicMatrix<int8_t>(2, 3);
+
+    mat.zeroes();
+    mat.set_element(1, 2, -7);
+
+    EXPECT_EQ(mat.get_element(1, 2), -7);
+    EXPECT_EQ(mat.get_element(0, 0), 0);
+}
@@ -0,0 +1,111 @@
+#include "gtest/gtest.h"
+#include "numcpp.h"
+
+static numcpp::SparseMatrix sample_pattern() {
+
+    //[1 0 2]
+    //[0 0 0]
+    //[0 3 4]
+    numcpp::CooBuilder builder(3, 3);
+
+    builder.add(2, 2, 4);
+    builder.add(0, 2, 2);
+    builder.add(2, 1, 3);
+    builder.add(0, 0, 1);
+
+    return builder.build();
+}
+
+TEST(SparseMatrix, coo_build) {
+
+    numcpp::CooBuilder builder(2, 2);
+
+    builder.add(1, 0, 1);
+    builder.add(1, 0, 2);
+    builder.add(0, 1, 5);
+
+    auto a = builder.build();
+
+    EXPECT_EQ(a.get_nonzeros(), 2);
+    EXPECT_EQ(a.get_element(1, 0), 3);
+    EXPECT_EQ(a.get_element(0, 1), 5);
+    EXPECT_EQ(a.get_element(0, 0), 0);
+    EXPECT_THROW(builder.add(2, 0, 1), numcpp::MatrixStatus);
+}
+
+TEST(SparseMatrix, invalid_structure) {
+
+    EXPECT_THROW(numcpp::SparseMatrix(2, 2, { 0, 1 }, { 0 }, { 1 }), numcpp::MatrixStatus);
+    EXPECT_THROW(numcpp::SparseMatrix(1, 2, { 0, 2 }, { 1, 0 }, { 1, 1 }), numcpp::MatrixStatus);
+    EXPECT_THROW(numcpp::SparseMatrix(2, 3, { 0, 5, 2 }, { 0, 1 }, { 1, 1 }), numcpp::MatrixStatus);
+    EXPECT_THROW(numcpp::SparseMatrix(2, 3, { 0, -1, 2 }, { 0, 1 }, { 1, 1 }), numcpp::MatrixStatus);
+}
+
+TEST(SparseMatrix, dense_round_trip) {
+
+    numcpp::init_parallel();
+
+    auto a = sample_pattern();
+    auto dense = numcpp::to_dense(a);
+
+    EXPECT_EQ(dense.get_element(0, 2), 2);
+    EXPECT_EQ(dense.get_element(1, 1), 0);
+    EXPECT_EQ(dense.get_element(2, 1), 3);
+
+    auto back = numcpp::to_sparse(dense);
+
+    EXPECT_EQ(back.get_nonzeros(), 4);
+    EXPECT_EQ(back.get_row_pointers(), a.get_row_pointers());
+    EXPECT_EQ(back.get_column_indices(), a.get_column_indices());
+    EXPECT_EQ(back.get_values(), a.get_values());
+}
+
+TEST(SparseMatrix, spmv_spmm) {
+
+    numcpp::init_parallel();
+
+    auto a = sample_pattern();
+    auto b = numcpp::Matrix(3, 2, 10);
+    auto x = numcpp::Matrix(3, 1, 10);
+
+    auto y = numcpp::spmv(a, x);
+    auto c = numcpp::spmm(a, b);
+    auto expected = numcpp::matmul(numcpp::to_dense(a), b);
+
+    EXPECT_FLOAT_EQ(y.get_element(0, 0), x.get_element(0, 0) + 2 * x.get_element(2, 0));
+    EXPECT_FLOAT_EQ(y.get_element(1, 0), 0);
+    EXPECT_FLOAT_EQ(y.get_element(2, 0), 3 * x.get_element(1, 0) + 4 * x.get_element(2, 0));
+
+    for (size_t i = 0; i < 3; i++)
+        for (size_t j = 0; j < 2; j++)
+            EXPECT_FLOAT_EQ(c.get_element(i, j), expected.get_element(i, j));
+
+    EXPECT_THROW(numcpp::spmm(a, numcpp::Matrix(2, 2, 10)), numcpp::MatrixStatus);
+}
+
+TEST(SparseMatrix, elementwise) {
+
+    numcpp::init_parallel();
+
+    auto a = sample_pattern();
+
+    numcpp::CooBuilder builder(3, 3);
+    builder.add(0, 0, 5);
+    builder.add(1, 1, 6);
+    auto b = builder.build();
+
+    auto sum = a + b;
+    auto difference = a - b;
+    auto product = a * b;
+    auto scaled = a * 2.0f;
+
+    EXPECT_EQ(sum.get_nonzeros(), 5);
+    EXPECT_EQ(sum.get_element(0, 0), 6);
+    EXPECT_EQ(sum.get_element(1, 1), 6);
+    EXPECT_EQ(difference.get_element(0, 0), -4);
+    EXPECT_EQ(difference.get_element(1, 1), -6);
+    EXPECT_EQ(product.get_nonzeros(), 1);
+    EXPECT_EQ(product.get_element(0, 0), 5);
+    EXPECT_EQ(scaled.get_element(2, 2), 8);
+    EXPECT_EQ(scaled.get_nonzeros(), 4);
+}
@@ -0,0 +1,339 @@
+/**
+ * Roofline report: measures the peak bandwidth and floating point rate of the default OpenCL device with two
+ * microbenchmarks, then runs every kernel of the library through the operation that launches it and prints
+ * the fraction of the roofline each one achieves next to the time the operation spends in transfers.
+ * Routines that keep part of their arithmetic on the host (the panels of the factorizations, the tridiagonal
+ * eigensolver) are shown as n/a: their operation counts over the kernel time alone would overstate the rate.
+ *
+ * usage: NumCPP_roofline [n]    (n: side of the square matrices, 512 by default)
+ */
+
+#include "numcpp.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <CL/cl2.hpp>
+
+struct Peak {
+
+    double bandwidth = 0;  //bytes per second
+    double flops = 0;      //floating point operations per second
+};
+
+//one operation of the library: the work its kernels do per run, by the usual operation counts, and the bytes they
+//must at least touch in device memory. all_kernel is false when part of that work runs on the host
+struct Workload {
+
+    std::string name;
+    double flops;
+    double bytes;
+    std::function<void()> run;
+    bool all_kernel = true;
+};
+
+const char* peak_kernels =
+        "kernel void stream_copy(const global float* a, global float* b) {"
+        "    b[get_global_id(0)] = a[get_global_id(0)];"
+        "}"
+        "kernel void fma_chain(const int n, global float* out) {"
+        "    float x = get_global_id(0), y = 1.0f, z = 0.5f, w = 2.0f;"
+        "    for (int i = 0; i < n; i++) {"
+        "        x = mad(x, 0.999f, 0.001f); y = mad(y, 0.999f, 0.001f);"
+        "        z = mad(z, 0.999f, 0.001f); w = mad(w, 0.999f, 0.001f);"
+        "    }"
+        "    out[get_global_id(0)] = x + y + z + w;"
+        "}";
+
+//best of three timed launches, in seconds
+double time_kernel(cl_command_queue queue, cl_kernel kernel, size_t global_work_size) {
+
+    double best = 1e30;
+
+    for (int i = 0; i < 3; i++) {
+
+        cl_event event;
+        cl_ulong start = 0, end = 0;
+
+        clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &global_work_size, nullptr, 0, nullptr, &event);
+        clWaitForEvents(1, &event);
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, nullptr);
+        clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, nullptr);
+        clReleaseEvent(event);
+
+        best = std::min(best, std::max<double>(end - start, 1) / 1e9);
+    }
+
+    return best;
+}
+
+Peak measure_peak() {
+
+    Peak peak;
+    cl_platform_id platform;
+    cl_device_id device;
+    cl_int ret;
+
+    if (clGetPlatformIDs(1, &platform, nullptr) != 0 ||
+        clGetDeviceIDs(platform, CL_DEVICE_TYPE_DEFAULT, 1, &device, nullptr) != 0) {
+
+        std::cerr << "No OpenCL device found." << std::endl;
+        exit(1);
+    }
+
+    cl_uint compute_units = 1;
+    clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &compute_units, nullptr);
+
+    cl_context context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &ret);
+    const cl_queue_properties properties[] = { CL_QUEUE_PROPERTIES, CL_QUEUE_PROFILING_ENABLE, 0 };
+    cl_command_queue queue = clCreateCommandQueueWithProperties(context, device, properties, &ret);
+
+    cl_program program = clCreateProgramWithSource(context, 1, &peak_kernels, nullptr, &ret);
+
+    if (clBuildProgram(program, 1, &device, nullptr, nullptr, nullptr) != 0) {
+
+        std::cerr << "Could not build the microbenchmarks." << std::endl;
+        exit(1);
+    }
+
+    //bandwidth: a 64 MB copy, read once and written once
+    const size_t words = (size_t)1 << 24;
+    cl_mem source = clCreateBuffer(context, CL_MEM_READ_ONLY, words * sizeof(float), nullptr, &ret);
+    cl_mem destination = clCreateBuffer(context, CL_MEM_WRITE_ONLY, words * sizeof(float), nullptr, &ret);
+
+    cl_kernel copy = clCreateKernel(program, "stream_copy", &ret);
+    clSetKernelArg(copy, 0, sizeof(cl_mem), &source);
+    clSetKernelArg(copy, 1, sizeof(cl_mem), &destination);
+
+    peak.bandwidth = 2.0 * words * sizeof(float) / time_kernel(queue, copy, words);
+
+    //floating point rate: four independent multiply-add chains per work-item
+    const int chain = 4096;
+    const size_t items = compute_units * 1024;
+    cl_mem out = clCreateBuffer(context, CL_MEM_WRITE_ONLY, items * sizeof(float), nullptr, &ret);
+
+    cl_kernel fma = clCreateKernel(program, "fma_chain", &ret);
+    clSetKernelArg(fma, 0, sizeof(int), &chain);
+    clSetKernelArg(fma, 1, sizeof(cl_mem), &out);
+
+    peak.flops = 2.0 * 4 * chain * items / time_kernel(queue, fma, items);
+
+    clReleaseKernel(copy);
+    clReleaseKernel(fma);
+    clReleaseMemObject(source);
+    clReleaseMemObject(destination);
+    clReleaseMemObject(out);
+    clReleaseProgram(program);
+    clReleaseCommandQueue(queue);
+    clReleaseContext(context);
+
+    return peak;
+}
+
+numcpp::Matrix symmetric_positive_definite(size_t n) {
+
+    auto m = numcpp::Matrix(n, n, 10);
+    auto a = numcpp::Matrix(n, n);
+
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+
+            float value = i == j ? (float)n * 100 : 0;
+
+            for (size_t k = 0; k < n; k++)
+                value += m.get_element(i, k) * m.get_element(j, k);
+
+            a.set_element(i, j, value / (n * 100));
+        }
+    }
+
+    return a;
+}
+
+//about one element in a hundred is non-zero
+numcpp::SparseMatrix random_sparse(size_t n) {
+
+    numcpp::CooBuilder builder(n, n);
+
+    for (size_t i = 0; i < n; i++)
+        for (size_t k = 0; k < std::max<size_t>(n / 100, 1); k++)
+            builder.add(i, rand() % n, 1 + rand() % 10);
+
+    return builder.build();
+}
+
+std::vector<Workload> workloads(size_t n) {
+
+    const double elements = (double)n * n, word = sizeof(float);
+    std::vector<Workload> list;
+
+    auto a = numcpp::Matrix(n, n, 100);
+    auto b = numcpp::Matrix(n, n, 100);
+    auto x = numcpp::Matrix(n, 1, 100);
+    auto c = numcpp::Matrix(n, n, 100);
+    auto spd = symmetric_positive_definite(n);
+    auto sparse = random_sparse(n);
+    auto mask = a > b;
+    double nonzeros = sparse.get_nonzeros();
+
+    //matrix-on-matrix and matrix-on-scalar operators: one operation per element
+    list.push_back({ "a + b", elements, 3 * elements * word, [=]() mutable { (a + b).clean_up(); } });
+    list.push_back({ "a - b", elements, 3 * elements * word, [=]() mutable { (a - b).clean_up(); } });
+    list.push_back({ "a * b", elements, 3 * elements * word, [=]() mutable { (a * b).clean_up(); } });
+    list.push_back({ "a > b", elements, elements * (2 * word + 1), [=]() mutable { (a > b).clean_up(); } });
+    list.push_back({ "a < b", elements, elements * (2 * word + 1), [=]() mutable { (a < b).clean_up(); } });
+    list.push_back({ "a == b", elements, elements * (2 * word + 1), [=]() mutable { (a == b).clean_up(); } });
+    list.push_back({ "a >= b", elements, elements * (2 * word + 1), [=]() mutable { (a >= b).clean_up(); } });
+    list.push_back({ "a <= b", elements, elements * (2 * word + 1), [=]() mutable { (a <= b).clean_up(); } });
+    list.push_back({ "a * s", elements, 2 * elements * word, [=]() mutable { (a * 0.5f).clean_up(); } });
+    list.push_back({ "a ^ s", elements, 2 * elements * word, [=]() mutable { (a ^ 2.0f).clean_up(); } });
+    list.push_back({ "a + s", elements, 2 * elements * word, [=]() mutable { (a + 0.5f).clean_up(); } });
+    list.push_back({ "a - s", elements, 2 * elements * word, [=]() mutable { (a - 0.5f).clean_up(); } });
+    list.push_back({ "a > s", elements, elements * (word + 1), [=]() mutable { (a > 0.5f).clean_up(); } });
+    list.push_back({ "a < s", elements, elements * (word + 1), [=]() mutable { (a < 0.5f).clean_up(); } });
+    list.push_back({ "a == s", elements, elements * (word + 1), [=]() mutable { (a == 0.5f).clean_up(); } });
+    list.push_back({ "a >= s", elements, elements * (word + 1), [=]() mutable { (a >= 0.5f).clean_up(); } });
+    list.push_back({ "a <= s", elements, elements * (word + 1), [=]() mutable { (a <= 0.5f).clean_up(); } });
+
+    //products and transposition
+    list.push_back({ "matmul", 2 * elements * n, 3 * elements * word,
+                     [=]() { numcpp::matmul(a, b).clean_up(); } });
+    list.push_back({ "matmul (vector)", 2 * elements, (elements + 2.0 * n) * word,
+                     [=]() { numcpp::matmul(a, x).clean_up(); } });
+    list.push_back({ "gemm", 2 * elements * n, 4 * elements * word,
+                     [=]() mutable { numcpp::gemm(false, true, 1, a, b, 1, c); } });
+    list.push_back({ "transpose", 0, 2 * elements * word, [=]() { numcpp::transpose(a).clean_up(); } });
+
+    size_t batch = 16, side = std::max<size_t>(n / 4, 1);
+    auto stacked_a = numcpp::Matrix(batch * side, side, 100);
+    auto stacked_b = numcpp::Matrix(batch * side, side, 100);
+    list.push_back({ "matmul_batched", 2.0 * batch * side * side * side, 3.0 * batch * side * side * word,
+                     [=]() { numcpp::matmul_batched(stacked_a, stacked_b, batch).clean_up(); } });
+
+    //factorizations, by their leading operation counts, the panels and the tridiagonal solve run on the host
+    std::vector<int> pivots;
+    list.push_back({ "lu", 2.0 / 3 * elements * n, 2 * elements * word,
+                     [=]() mutable { numcpp::lu(a, pivots).clean_up(); }, false });
+    list.push_back({ "solve", 2.0 / 3 * elements * n + 2 * elements, 2 * elements * word,
+                     [=]() { numcpp::solve(a, x).clean_up(); }, false });
+    list.push_back({ "cholesky", 1.0 / 3 * elements * n, 2 * elements * word,
+                     [=]() { numcpp::cholesky(spd).clean_up(); }, false });
+    list.push_back({ "eigh", 4.0 / 3 * elements * n, 3 * elements * word,
+                     [=]() { numcpp::Matrix vectors(1, 1); numcpp::eigh(spd, vectors).clean_up(); }, false });
+
+    size_t problems = 64, rows = 32, columns = 16;
+    auto problems_a = numcpp::Matrix(problems * rows, columns, 100);
+    auto problems_b = numcpp::Matrix(problems * rows, 1, 100);
+    double problem_flops = 2.0 * rows * columns * columns - 2.0 / 3 * columns * columns * columns;
+    list.push_back({ "lstsq_batched", problems * problem_flops, problems * (rows * (columns + 1.0) + columns) * word,
+                     [=]() { numcpp::lstsq_batched(problems_a, problems_b, problems).clean_up(); } });
+
+    //sparse kernels: a value and a column index per non-zero
+    list.push_back({ "spmv", 2 * nonzeros, nonzeros * 2 * word + 3.0 * n * word,
+                     [=]() { numcpp::spmv(sparse, x).clean_up(); } });
+    list.push_back({ "spmm", 2 * nonzeros * n, nonzeros * 2 * word + 2 * elements * word,
+                     [=]() { numcpp::spmm(sparse, b).clean_up(); } });
+    list.push_back({ "sparse a + b", 2 * nonzeros, 6 * nonzeros * word, [=]() { auto sum = sparse + sparse; } });
+    list.push_back({ "to_sparse", elements, elements * word + nonzeros * 2 * word,
+                     [=]() { numcpp::to_sparse(c); } });
+    list.push_back({ "to_dense", 0, nonzeros * 2 * word + elements * word,
+                     [=]() { numcpp::to_dense(sparse).clean_up(); } });
+
+    //mask reductions
+    list.push_back({ "count_nonzero", elements, elements, [=]() { numcpp::count_nonzero(mask); } });
+    list.push_back({ "masked_select", 0, elements * (2 * word + 1),
+                     [=]() { numcpp::masked_select(a, mask).clean_up(); } });
+
+    return list;
+}
+
+int main(int argc, char** argv) {
+
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 512;
+    const int runs = 3;
+
+    Peak peak = measure_peak();
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "Peak bandwidth: " << peak.bandwidth / 1e9 << " GB/s, peak rate: " << peak.flops / 1e9 << " GFLOP/s"
+              << ", ridge point: " << peak.flops / peak.bandwidth << " FLOP/byte" << std::endl << std::endl;
+
+    numcpp::init_parallel();
+    numcpp::set_profiling(true);
+
+    std::cout << std::left << std::setw(18) << "operation" << std::setw(34) << "kernel" << std::right
+              << std::setw(10) << "FLOP/B" << std::setw(12) << "GFLOP/s" << std::setw(10) << "GB/s"
+              << std::setw(10) << "roofline" << std::setw(9) << "bound" << std::setw(12) << "kernel ms"
+              << std::setw(12) << "write ms" << std::setw(12) << "read ms" << std::setw(12) << "alloc ms" << std::endl;
+
+    for (Workload& workload : workloads(n)) {
+
+        //one untimed run builds anything built on first use
+        workload.run();
+        numcpp::reset_profiling();
+
+        for (int i = 0; i < runs; i++)
+            workload.run();
+
+        double kernel = 0, write = 0, read = 0, allocate = 0;
+        std::string kernels;
+
+        for (const numcpp::ProfileStats& stats : numcpp::get_profiling_stats()) {
+
+            double seconds = stats.executed_ns / 1e9 / runs;
+
+            if (stats.command == "write")
+                write += seconds;
+            else if (stats.command == "read")
+                read += seconds;
+            else if (stats.command == "create buffer")
+                allocate += seconds;
+            else if (stats.command != "fill") {
+
+                kernel += seconds;
+                kernels += (kernels.empty() ? "" : "+") + stats.command;
+            }
+        }
+
+        double intensity = workload.flops / workload.bytes;
+
+        if (kernels.size() > 33)
+            kernels = kernels.substr(0, 30) + "...";
+
+        std::cout << std::left << std::setw(18) << workload.name << std::setw(34) << kernels << std::right
+                  << std::setw(10) << intensity;
+
+        //at small sizes some routines stay on the host entirely, there is no kernel time to rate, and the routines
+        //that share their work with the host cannot be rated on the kernel time alone
+        if (kernel > 0 && workload.all_kernel) {
+
+            //attainable rate is capped by the compute peak or by bandwidth times arithmetic intensity,
+            //kernels without floating point work are measured against the bandwidth alone
+            double attainable = std::min(peak.flops, intensity * peak.bandwidth);
+            double fraction = workload.flops > 0 ? workload.flops / kernel / attainable
+                                                 : workload.bytes / kernel / peak.bandwidth;
+
+            std::cout << std::setw(12) << workload.flops / kernel / 1e9 << std::setw(10)
+                      << workload.bytes / kernel / 1e9 << std::setw(9) << fraction * 100 << "%";
+        }
+        else {
+
+            const char* missing = kernel > 0 ? "n/a" : "-";
+
+            std::cout << std::setw(12) << missing << std::setw(10) << missing << std::setw(10) << missing;
+        }
+
+        std::cout << std::setw(9) << (intensity * peak.bandwidth < peak.flops ? "memory" : "compute")
+                  << std::setw(12) << kernel * 1e3 << std::setw(12) << write * 1e3 << std::setw(12) << read * 1e3
+                  << std::setw(12) << allocate * 1e3 << std::endl;
+    }
+
+    numcpp::set_profiling(false);
+    numcpp::finish_parallel();
+
+    return 0;
+}